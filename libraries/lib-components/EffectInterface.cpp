@@ -63,4 +63,9 @@ bool EffectDefinitionInterface::IsHiddenFromMenus()
 
 EffectProcessor::~EffectProcessor() = default;
 
+bool EffectProcessor::SupportsParallelProcessing()
+{
+   return false;
+}
+
 EffectUIClientInterface::~EffectUIClientInterface() = default;
@@ -236,6 +236,17 @@ public:
    virtual bool RealtimeProcessStart() = 0;
    virtual size_t RealtimeProcess(int group, float **inBuf, float **outBuf, size_t numSamples) = 0;
    virtual bool RealtimeProcessEnd() noexcept = 0;
+
+   //! Whether destructive processing may use one realtime processor per group
+   //! of channels, and call RealtimeProcess() for different groups on
+   //! different threads at once
+   /*!
+    That requires that RealtimeProcess() only reads the state that the
+    groups share, that the effect has no latency, and that its processing
+    does not depend on the channel, which RealtimeAddProcessor() is not
+    told.  Default is false.
+    */
+   virtual bool SupportsParallelProcessing();
 };
 
 /*************************************************************************************//**
@@ -39,6 +39,7 @@ and get deterministic behaviour.
 
 #include "Internat.h"
 #include "Prefs.h"
+#include "SampleFormatSIMD.h"
 
 // Erik de Castro Lopo's header file that
 // makes sure that we have lrint and lrintf
@@ -48,6 +49,7 @@ and get deterministic behaviour.
 #include <stdlib.h>
 #include <cmath>
 #include <string.h>
+#include <algorithm>
 #include <cassert>
 //#include <sys/types.h>
 //#include <memory.h>
@@ -301,6 +303,13 @@ void Dither::Apply(enum DitherType ditherType,
         // No clipping should be necessary.
         auto d = (float*)dest;
 
+        if (destStride == 1 && sourceStride == 1 && (
+            sourceFormat == int16Sample
+               ? SampleFormatSIMD::Int16ToFloat((const short*)source, d, len)
+               : sourceFormat == int24Sample &&
+                 SampleFormatSIMD::Int24ToFloat((const int*)source, d, len)))
+            return;
+
         if (sourceFormat == int16Sample)
         {
             auto s = (const short*)source;
@@ -321,10 +330,18 @@ void Dither::Apply(enum DitherType ditherType,
         // Special case when promoting 16 bit to 24 bit
         auto d = (int*)dest;
         auto s = (const short*)source;
+        if (destStride == 1 && sourceStride == 1 &&
+            SampleFormatSIMD::Int16ToInt24(s, d, len))
+            return;
         for (i = 0; i < len; i++, d += destStride, s += sourceStride)
             *d = ((int)*s) << 8;
     } else
     {
+        if (destStride == 1 && sourceStride == 1 &&
+            sourceFormat == floatSample &&
+            ApplyVectorized(ditherType, (const float*)source, dest, destFormat, len))
+            return;
+
         // We must do dithering
         switch (ditherType)
         {
@@ -348,6 +365,64 @@ void Dither::Apply(enum DitherType ditherType,
     }
 }
 
+// Float to integer conversion of contiguous samples with the vector kernels,
+// for the dithers that do not feed back the rounding error.  The noise comes
+// from the same calls of rand() in the same order as in the DITHER loops, so
+// the results do not change.
+bool Dither::ApplyVectorized(DitherType ditherType,
+                             const float *source,
+                             samplePtr dest, sampleFormat destFormat,
+                             unsigned int len)
+{
+    if (GetConversionKernels() == ConversionKernels::Scalar)
+        return false;
+
+    const auto convert = [&](unsigned offset, unsigned count,
+                             const float *add, const float *sub) {
+        if (destFormat == int16Sample)
+            return SampleFormatSIMD::FloatToInt16(
+                source + offset, (short*)dest + offset, count, add, sub);
+        else if (destFormat == int24Sample)
+            return SampleFormatSIMD::FloatToInt24(
+                source + offset, (int*)dest + offset, count, add, sub);
+        return false;
+    };
+
+    switch (ditherType)
+    {
+    case DitherType::none:
+        return convert(0, len, nullptr, nullptr);
+    case DitherType::rectangle:
+    case DitherType::triangle:
+    {
+        if (ditherType == DitherType::triangle)
+            Reset(); // reset dither filter for this NEW conversion
+
+        // noise[0] holds the previous noise value for the triangle dither
+        constexpr unsigned NoiseChunk = 1024;
+        float noise[NoiseChunk + 1];
+        for (unsigned offset = 0; offset < len; offset += NoiseChunk)
+        {
+            const auto count = std::min(NoiseChunk, len - offset);
+            noise[0] = mTriangleState;
+            for (unsigned ii = 1; ii <= count; ++ii)
+                noise[ii] = DITHER_NOISE;
+            if (ditherType == DitherType::rectangle)
+                convert(offset, count, nullptr, noise + 1);
+            else
+            {
+                convert(offset, count, noise + 1, noise);
+                mTriangleState = noise[count];
+            }
+        }
+        return true;
+    }
+    default:
+        // Shaped dither feeds each rounding error into the next sample
+        return false;
+    }
+}
+
 // Dither implementations
 
 // No dither, just return sample
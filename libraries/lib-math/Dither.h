@@ -46,6 +46,13 @@ public:
                unsigned int destStride = 1);
 
 private:
+    //! Conversion of contiguous float samples with the vector kernels
+    /*! @return false if the caller must use the scalar loops */
+    bool ApplyVectorized(DitherType ditherType,
+                         const float *source,
+                         samplePtr dest, sampleFormat destFormat,
+                         unsigned int len);
+
     // Dither methods
     float NoDither(float sample);
     float RectangleDither(float sample);
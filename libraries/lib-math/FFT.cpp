@@ -232,12 +232,20 @@ void RealFFT(size_t NumSamples, const float *RealIn, float *RealOut, float *Imag
 {
    auto hFFT = GetFFT(NumSamples);
    Floats pFFT{ NumSamples };
+   RealFFT(*hFFT, RealIn, RealOut, ImagOut, pFFT.get());
+}
+
+void RealFFT(const FFTParam &fft,
+             const float *RealIn, float *RealOut, float *ImagOut, float *pFFT)
+{
+   const auto NumSamples = 2 * fft.Points;
+   const auto hFFT = &fft;
    // Copy the data into the processing buffer
    for(size_t i = 0; i < NumSamples; i++)
       pFFT[i] = RealIn[i];
 
    // Perform the FFT
-   RealFFTf(pFFT.get(), hFFT.get());
+   RealFFTf(pFFT, hFFT);
 
    // Copy the data into the real and imaginary outputs
    for (size_t i = 1; i<(NumSamples / 2); i++) {
@@ -271,6 +279,15 @@ void InverseRealFFT(size_t NumSamples, const float *RealIn, const float *ImagIn,
 {
    auto hFFT = GetFFT(NumSamples);
    Floats pFFT{ NumSamples };
+   InverseRealFFT(*hFFT, RealIn, ImagIn, RealOut, pFFT.get());
+}
+
+void InverseRealFFT(const FFTParam &fft,
+                    const float *RealIn, const float *ImagIn, float *RealOut,
+                    float *pFFT)
+{
+   const auto NumSamples = 2 * fft.Points;
+   const auto hFFT = &fft;
    // Copy the data into the processing buffer
    for (size_t i = 0; i < (NumSamples / 2); i++)
       pFFT[2*i  ] = RealIn[i];
@@ -285,10 +302,10 @@ void InverseRealFFT(size_t NumSamples, const float *RealIn, const float *ImagIn,
    pFFT[1] = RealIn[NumSamples / 2];
 
    // Perform the FFT
-   InverseRealFFTf(pFFT.get(), hFFT.get());
+   InverseRealFFTf(pFFT, hFFT);
 
    // Copy the data to the (purely real) output buffer
-   ReorderToTime(hFFT.get(), pFFT.get(), RealOut);
+   ReorderToTime(hFFT, pFFT, RealOut);
 }
 
 /*
@@ -306,12 +323,20 @@ void PowerSpectrum(size_t NumSamples, const float *In, float *Out)
 {
    auto hFFT = GetFFT(NumSamples);
    Floats pFFT{ NumSamples };
+   PowerSpectrum(*hFFT, In, Out, pFFT.get());
+}
+
+void PowerSpectrum(const FFTParam &fft,
+                   const float *In, float *Out, float *pFFT)
+{
+   const auto NumSamples = 2 * fft.Points;
+   const auto hFFT = &fft;
    // Copy the data into the processing buffer
    for (size_t i = 0; i<NumSamples; i++)
       pFFT[i] = In[i];
 
    // Perform the FFT
-   RealFFTf(pFFT.get(), hFFT.get());
+   RealFFTf(pFFT, hFFT);
 
    // Copy the data into the real and imaginary outputs
    for (size_t i = 1; i<NumSamples / 2; i++) {
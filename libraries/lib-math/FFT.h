@@ -35,6 +35,7 @@
 #include <wx/defs.h>
 
 class TranslatableString;
+struct FFTParam;
 
 /*
   Salvo Ventura - November 2006
@@ -86,6 +87,25 @@ MATH_API
 void InverseRealFFT(size_t NumSamples,
 		    const float *RealIn, const float *ImagIn, float *RealOut);
 
+/*
+ * The same three transforms, for callers that do many of one size and must
+ * not allocate for each.  fft is from GetFFT(NumSamples), and Work is a
+ * buffer of NumSamples floats, whose contents are overwritten.
+ */
+
+MATH_API
+void PowerSpectrum(const FFTParam &fft,
+                   const float *In, float *Out, float *Work);
+
+MATH_API
+void RealFFT(const FFTParam &fft,
+             const float *RealIn, float *RealOut, float *ImagOut, float *Work);
+
+MATH_API
+void InverseRealFFT(const FFTParam &fft,
+                    const float *RealIn, const float *ImagIn, float *RealOut,
+                    float *Work);
+
 /*
  * Computes a FFT of complex input and returns complex output.
  * Currently this is the only function here that supports the
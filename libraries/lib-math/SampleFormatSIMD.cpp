@@ -0,0 +1,469 @@
+/**********************************************************************
+
+  Tenacity: A Digital Audio Editor
+
+  @file SampleFormatSIMD.cpp
+
+  Vectorized inner loops for the sample format conversions in Dither,
+  and for the summaries of sample blocks
+
+  The kernels are compiled for their instruction sets with function target
+  attributes and chosen at run time, so the library still runs on any
+  processor of the architecture.  Every kernel finishes the samples that do
+  not fill a whole vector with the scalar formula, and the scalar formulas
+  are those of the loops in Dither.cpp, so the results agree bit for bit.
+
+**********************************************************************/
+#include "SampleFormatSIMD.h"
+
+// Erik de Castro Lopo's header file that
+// makes sure that we have lrint and lrintf
+// (Note: this file should be included first)
+#include "float_cast.h"
+
+#include <algorithm>
+#include <atomic>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+   #define SAMPLE_FORMAT_SIMD_X86
+   #include <immintrin.h>
+   #if defined(_MSC_VER)
+      #include <intrin.h>
+      // MSVC allows the intrinsics of any instruction set anywhere
+      #define TARGET_SSE41
+      #define TARGET_AVX2
+   #else
+      #define TARGET_SSE41 __attribute__((target("sse4.1")))
+      #define TARGET_AVX2 __attribute__((target("avx2")))
+   #endif
+#endif
+
+namespace {
+
+constexpr float Div16 = float(1 << 15);
+constexpr float Div24 = float(1 << 23);
+
+ConversionKernels Detect()
+{
+#if defined(SAMPLE_FORMAT_SIMD_X86)
+#if defined(_MSC_VER)
+   int info[4];
+   __cpuid(info, 0);
+   const int maxLeaf = info[0];
+   __cpuid(info, 1);
+   const bool sse41 = info[2] & (1 << 19);
+   const bool osxsave = info[2] & (1 << 27);
+   const bool avx = info[2] & (1 << 28);
+   bool avx2 = false;
+   // The operating system must also save the upper halves of the registers
+   if (maxLeaf >= 7 && osxsave && avx && (_xgetbv(0) & 6) == 6) {
+      __cpuidex(info, 7, 0);
+      avx2 = info[1] & (1 << 5);
+   }
+#else
+   __builtin_cpu_init();
+   const bool sse41 = __builtin_cpu_supports("sse4.1");
+   const bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+   if (avx2)
+      return ConversionKernels::AVX2;
+   if (sse41)
+      return ConversionKernels::SSE41;
+#endif
+   return ConversionKernels::Scalar;
+}
+
+std::atomic<ConversionKernels> &CurrentKernels()
+{
+   static std::atomic<ConversionKernels> kernels{ BestConversionKernels() };
+   return kernels;
+}
+
+// Scalar remainders, written as in the DITHER loops of Dither.cpp
+
+inline void Int16ToFloatScalar(
+   const short *src, float *dst, size_t ii, size_t len)
+{
+   for (; ii < len; ++ii)
+      dst[ii] = src[ii] / Div16;
+}
+
+inline void Int24ToFloatScalar(
+   const int *src, float *dst, size_t ii, size_t len)
+{
+   for (; ii < len; ++ii)
+      dst[ii] = src[ii] / Div24;
+}
+
+inline void Int16ToInt24Scalar(
+   const short *src, int *dst, size_t ii, size_t len)
+{
+   for (; ii < len; ++ii)
+      dst[ii] = int(src[ii]) << 8;
+}
+
+template< typename Sample, int MinBound, int MaxBound >
+inline void FloatToIntScalar(const float *src, Sample *dst,
+   size_t ii, size_t len, float scale, const float *add, const float *sub)
+{
+   for (; ii < len; ++ii) {
+      float sample = src[ii];
+      if (sample != sample) // NaN
+         sample = 0;
+      sample = sample > 1.0f ? 1.0f : sample < -1.0f ? -1.0f : sample;
+      sample *= scale;
+      if (add)
+         sample += add[ii];
+      if (sub)
+         sample -= sub[ii];
+      const int x = lrintf(sample);
+      dst[ii] = x > MaxBound ? MaxBound : x < MinBound ? MinBound : Sample(x);
+   }
+}
+
+//! Continue the summary of a group from sample ii
+inline void SummarizeScalar(const float *src, size_t ii, size_t len,
+   float &min, float &max, float &sumsq)
+{
+   for (; ii < len; ++ii) {
+      const float f1 = src[ii];
+      sumsq += f1 * f1;
+      if (f1 < min)
+         min = f1;
+      else if (f1 > max)
+         max = f1;
+   }
+}
+
+#if defined(SAMPLE_FORMAT_SIMD_X86)
+
+// SSE4.1, four samples at a time
+
+TARGET_SSE41 void Int16ToFloatSSE41(const short *src, float *dst, size_t len)
+{
+   const auto scale = _mm_set1_ps(1.0f / Div16);
+   size_t ii = 0;
+   for (; ii + 4 <= len; ii += 4) {
+      const auto ints = _mm_cvtepi16_epi32(
+         _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + ii)));
+      _mm_storeu_ps(dst + ii, _mm_mul_ps(_mm_cvtepi32_ps(ints), scale));
+   }
+   Int16ToFloatScalar(src, dst, ii, len);
+}
+
+TARGET_SSE41 void Int24ToFloatSSE41(const int *src, float *dst, size_t len)
+{
+   const auto scale = _mm_set1_ps(1.0f / Div24);
+   size_t ii = 0;
+   for (; ii + 4 <= len; ii += 4) {
+      const auto ints =
+         _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + ii));
+      _mm_storeu_ps(dst + ii, _mm_mul_ps(_mm_cvtepi32_ps(ints), scale));
+   }
+   Int24ToFloatScalar(src, dst, ii, len);
+}
+
+TARGET_SSE41 void Int16ToInt24SSE41(const short *src, int *dst, size_t len)
+{
+   size_t ii = 0;
+   for (; ii + 4 <= len; ii += 4) {
+      const auto ints = _mm_cvtepi16_epi32(
+         _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + ii)));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + ii),
+         _mm_slli_epi32(ints, 8));
+   }
+   Int16ToInt24Scalar(src, dst, ii, len);
+}
+
+//! Clip, scale, apply noise and round four samples
+TARGET_SSE41 inline __m128i RoundSSE41(const float *src,
+   size_t ii, __m128 scale, const float *add, const float *sub)
+{
+   auto x = _mm_loadu_ps(src + ii);
+   x = _mm_and_ps(x, _mm_cmpord_ps(x, x)); // NaN to 0
+   x = _mm_max_ps(_mm_min_ps(x, _mm_set1_ps(1.0f)), _mm_set1_ps(-1.0f));
+   x = _mm_mul_ps(x, scale);
+   if (add)
+      x = _mm_add_ps(x, _mm_loadu_ps(add + ii));
+   if (sub)
+      x = _mm_sub_ps(x, _mm_loadu_ps(sub + ii));
+   return _mm_cvtps_epi32(x);
+}
+
+TARGET_SSE41 void FloatToInt16SSE41(const float *src, short *dst, size_t len,
+   const float *add, const float *sub)
+{
+   const auto scale = _mm_set1_ps(Div16);
+   size_t ii = 0;
+   for (; ii + 8 <= len; ii += 8) {
+      const auto lo = RoundSSE41(src, ii, scale, add, sub);
+      const auto hi = RoundSSE41(src, ii + 4, scale, add, sub);
+      // Saturating pack does the clipping
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + ii),
+         _mm_packs_epi32(lo, hi));
+   }
+   FloatToIntScalar<short, -32768, 32767>(
+      src, dst, ii, len, Div16, add, sub);
+}
+
+TARGET_SSE41 void FloatToInt24SSE41(const float *src, int *dst, size_t len,
+   const float *add, const float *sub)
+{
+   const auto scale = _mm_set1_ps(Div24);
+   const auto minBound = _mm_set1_epi32(-8388608);
+   const auto maxBound = _mm_set1_epi32(8388607);
+   size_t ii = 0;
+   for (; ii + 4 <= len; ii += 4) {
+      const auto x = RoundSSE41(src, ii, scale, add, sub);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + ii),
+         _mm_max_epi32(_mm_min_epi32(x, maxBound), minBound));
+   }
+   FloatToIntScalar<int, -8388608, 8388607>(
+      src, dst, ii, len, Div24, add, sub);
+}
+
+TARGET_SSE41 void SummarizeGroupsSSE41(
+   const float *src, size_t len, size_t group, float *dst)
+{
+   for (size_t start = 0; start < len; start += group, dst += 3) {
+      const auto pSrc = src + start;
+      const auto count = std::min(group, len - start);
+      // Minimum and maximum take the other operand when the sample is NaN
+      auto min = _mm_set1_ps(pSrc[0]);
+      auto max = min;
+      auto sumsq = _mm_setzero_ps();
+      size_t ii = 0;
+      for (; ii + 4 <= count; ii += 4) {
+         const auto x = _mm_loadu_ps(pSrc + ii);
+         min = _mm_min_ps(x, min);
+         max = _mm_max_ps(x, max);
+         sumsq = _mm_add_ps(sumsq, _mm_mul_ps(x, x));
+      }
+      alignas(16) float mins[4], maxes[4], sums[4];
+      _mm_store_ps(mins, min);
+      _mm_store_ps(maxes, max);
+      _mm_store_ps(sums, sumsq);
+      float groupMin = std::min({ mins[0], mins[1], mins[2], mins[3] });
+      float groupMax = std::max({ maxes[0], maxes[1], maxes[2], maxes[3] });
+      float groupSumsq = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+      SummarizeScalar(pSrc, ii, count, groupMin, groupMax, groupSumsq);
+      dst[0] = groupMin;
+      dst[1] = groupMax;
+      dst[2] = groupSumsq;
+   }
+}
+
+// AVX2, eight samples at a time
+
+TARGET_AVX2 void Int16ToFloatAVX2(const short *src, float *dst, size_t len)
+{
+   const auto scale = _mm256_set1_ps(1.0f / Div16);
+   size_t ii = 0;
+   for (; ii + 8 <= len; ii += 8) {
+      const auto ints = _mm256_cvtepi16_epi32(
+         _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + ii)));
+      _mm256_storeu_ps(dst + ii,
+         _mm256_mul_ps(_mm256_cvtepi32_ps(ints), scale));
+   }
+   Int16ToFloatScalar(src, dst, ii, len);
+}
+
+TARGET_AVX2 void Int24ToFloatAVX2(const int *src, float *dst, size_t len)
+{
+   const auto scale = _mm256_set1_ps(1.0f / Div24);
+   size_t ii = 0;
+   for (; ii + 8 <= len; ii += 8) {
+      const auto ints =
+         _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + ii));
+      _mm256_storeu_ps(dst + ii,
+         _mm256_mul_ps(_mm256_cvtepi32_ps(ints), scale));
+   }
+   Int24ToFloatScalar(src, dst, ii, len);
+}
+
+TARGET_AVX2 void Int16ToInt24AVX2(const short *src, int *dst, size_t len)
+{
+   size_t ii = 0;
+   for (; ii + 8 <= len; ii += 8) {
+      const auto ints = _mm256_cvtepi16_epi32(
+         _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + ii)));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + ii),
+         _mm256_slli_epi32(ints, 8));
+   }
+   Int16ToInt24Scalar(src, dst, ii, len);
+}
+
+//! Clip, scale, apply noise and round eight samples
+TARGET_AVX2 inline __m256i RoundAVX2(const float *src,
+   size_t ii, __m256 scale, const float *add, const float *sub)
+{
+   auto x = _mm256_loadu_ps(src + ii);
+   x = _mm256_and_ps(x, _mm256_cmp_ps(x, x, _CMP_ORD_Q)); // NaN to 0
+   x = _mm256_max_ps(
+      _mm256_min_ps(x, _mm256_set1_ps(1.0f)), _mm256_set1_ps(-1.0f));
+   x = _mm256_mul_ps(x, scale);
+   if (add)
+      x = _mm256_add_ps(x, _mm256_loadu_ps(add + ii));
+   if (sub)
+      x = _mm256_sub_ps(x, _mm256_loadu_ps(sub + ii));
+   return _mm256_cvtps_epi32(x);
+}
+
+TARGET_AVX2 void FloatToInt16AVX2(const float *src, short *dst, size_t len,
+   const float *add, const float *sub)
+{
+   const auto scale = _mm256_set1_ps(Div16);
+   size_t ii = 0;
+   for (; ii + 8 <= len; ii += 8) {
+      const auto x = RoundAVX2(src, ii, scale, add, sub);
+      // Pack the two 128 bit halves; the 256 bit pack would interleave them
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + ii),
+         _mm_packs_epi32(
+            _mm256_castsi256_si128(x), _mm256_extracti128_si256(x, 1)));
+   }
+   FloatToIntScalar<short, -32768, 32767>(
+      src, dst, ii, len, Div16, add, sub);
+}
+
+TARGET_AVX2 void FloatToInt24AVX2(const float *src, int *dst, size_t len,
+   const float *add, const float *sub)
+{
+   const auto scale = _mm256_set1_ps(Div24);
+   const auto minBound = _mm256_set1_epi32(-8388608);
+   const auto maxBound = _mm256_set1_epi32(8388607);
+   size_t ii = 0;
+   for (; ii + 8 <= len; ii += 8) {
+      const auto x = RoundAVX2(src, ii, scale, add, sub);
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + ii),
+         _mm256_max_epi32(_mm256_min_epi32(x, maxBound), minBound));
+   }
+   FloatToIntScalar<int, -8388608, 8388607>(
+      src, dst, ii, len, Div24, add, sub);
+}
+
+TARGET_AVX2 void SummarizeGroupsAVX2(
+   const float *src, size_t len, size_t group, float *dst)
+{
+   for (size_t start = 0; start < len; start += group, dst += 3) {
+      const auto pSrc = src + start;
+      const auto count = std::min(group, len - start);
+      // Minimum and maximum take the other operand when the sample is NaN
+      auto min = _mm256_set1_ps(pSrc[0]);
+      auto max = min;
+      auto sumsq = _mm256_setzero_ps();
+      size_t ii = 0;
+      for (; ii + 8 <= count; ii += 8) {
+         const auto x = _mm256_loadu_ps(pSrc + ii);
+         min = _mm256_min_ps(x, min);
+         max = _mm256_max_ps(x, max);
+         sumsq = _mm256_add_ps(sumsq, _mm256_mul_ps(x, x));
+      }
+      // Fold the halves, then the lanes
+      const auto min4 = _mm_min_ps(
+         _mm256_castps256_ps128(min), _mm256_extractf128_ps(min, 1));
+      const auto max4 = _mm_max_ps(
+         _mm256_castps256_ps128(max), _mm256_extractf128_ps(max, 1));
+      const auto sumsq4 = _mm_add_ps(
+         _mm256_castps256_ps128(sumsq), _mm256_extractf128_ps(sumsq, 1));
+      alignas(16) float mins[4], maxes[4], sums[4];
+      _mm_store_ps(mins, min4);
+      _mm_store_ps(maxes, max4);
+      _mm_store_ps(sums, sumsq4);
+      float groupMin = std::min({ mins[0], mins[1], mins[2], mins[3] });
+      float groupMax = std::max({ maxes[0], maxes[1], maxes[2], maxes[3] });
+      float groupSumsq = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+      SummarizeScalar(pSrc, ii, count, groupMin, groupMax, groupSumsq);
+      dst[0] = groupMin;
+      dst[1] = groupMax;
+      dst[2] = groupSumsq;
+   }
+}
+
+#endif
+
+}
+
+ConversionKernels BestConversionKernels()
+{
+   static const ConversionKernels best = Detect();
+   return best;
+}
+
+ConversionKernels GetConversionKernels()
+{
+   return CurrentKernels().load(std::memory_order_relaxed);
+}
+
+void SetConversionKernels(ConversionKernels kernels)
+{
+   if (kernels > BestConversionKernels())
+      kernels = BestConversionKernels();
+   CurrentKernels().store(kernels, std::memory_order_relaxed);
+}
+
+const char *ConversionKernelsName(ConversionKernels kernels)
+{
+   switch (kernels) {
+   case ConversionKernels::SSE41:
+      return "SSE4.1";
+   case ConversionKernels::AVX2:
+      return "AVX2";
+   case ConversionKernels::Scalar:
+   default:
+      return "Scalar";
+   }
+}
+
+namespace SampleFormatSIMD {
+
+#if defined(SAMPLE_FORMAT_SIMD_X86)
+   #define DISPATCH(name, ...) \
+      switch (GetConversionKernels()) { \
+      case ConversionKernels::AVX2: \
+         name ## AVX2(__VA_ARGS__); \
+         return true; \
+      case ConversionKernels::SSE41: \
+         name ## SSE41(__VA_ARGS__); \
+         return true; \
+      default: \
+         return false; \
+      }
+#else
+   #define DISPATCH(name, ...) return false;
+#endif
+
+bool Int16ToFloat(const short *src, float *dst, size_t len)
+{
+   DISPATCH(Int16ToFloat, src, dst, len)
+}
+
+bool Int24ToFloat(const int *src, float *dst, size_t len)
+{
+   DISPATCH(Int24ToFloat, src, dst, len)
+}
+
+bool Int16ToInt24(const short *src, int *dst, size_t len)
+{
+   DISPATCH(Int16ToInt24, src, dst, len)
+}
+
+bool FloatToInt16(const float *src, short *dst, size_t len,
+   const float *add, const float *sub)
+{
+   DISPATCH(FloatToInt16, src, dst, len, add, sub)
+}
+
+bool FloatToInt24(const float *src, int *dst, size_t len,
+   const float *add, const float *sub)
+{
+   DISPATCH(FloatToInt24, src, dst, len, add, sub)
+}
+
+bool SummarizeGroups(const float *src, size_t len, size_t group, float *dst)
+{
+   DISPATCH(SummarizeGroups, src, len, group, dst)
+}
+
+#undef DISPATCH
+
+}
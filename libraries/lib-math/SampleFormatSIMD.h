@@ -0,0 +1,73 @@
+/**********************************************************************
+
+  Tenacity: A Digital Audio Editor
+
+  @file SampleFormatSIMD.h
+
+  Vectorized inner loops for the sample format conversions in Dither,
+  and for the summaries of sample blocks
+
+**********************************************************************/
+#ifndef __TENACITY_SAMPLE_FORMAT_SIMD__
+#define __TENACITY_SAMPLE_FORMAT_SIMD__
+
+#include <cstddef>
+
+//! Instruction sets for which there are conversion kernels
+/*! Ordered from least to most capable */
+enum class ConversionKernels : unsigned {
+   Scalar,
+   SSE41,
+   AVX2,
+};
+
+//! The most capable kernels the running CPU supports
+MATH_API ConversionKernels BestConversionKernels();
+
+//! The kernels that Dither::Apply currently uses; initially the best available
+MATH_API ConversionKernels GetConversionKernels();
+
+//! Choose the kernels for Dither::Apply, for instance to compare them
+/*! A choice beyond BestConversionKernels() is lowered to that */
+MATH_API void SetConversionKernels(ConversionKernels kernels);
+
+//! A short name for messages such as benchmark reports
+MATH_API const char *ConversionKernelsName(ConversionKernels kernels);
+
+//! Kernels for contiguous buffers, giving the same results as the scalar loops in Dither.cpp
+/*!
+ Each returns false, doing nothing, when the current kernels are Scalar, so
+ that the caller falls back to its own loop.
+
+ The float to integer kernels clip the source to [-1, 1], scale it, then
+ add `add[ii]` and subtract `sub[ii]` when those are not null, in that order,
+ before rounding in the current rounding mode and clipping to the range of
+ the destination.  That is how the no, rectangle and triangle dithers apply
+ their noise.  NaN converts to 0, as it does in the scalar loops where lrintf
+ returns a long.
+ */
+namespace SampleFormatSIMD {
+
+bool Int16ToFloat(const short *src, float *dst, size_t len);
+bool Int24ToFloat(const int *src, float *dst, size_t len);
+bool Int16ToInt24(const short *src, int *dst, size_t len);
+
+bool FloatToInt16(const float *src, short *dst, size_t len,
+   const float *add = nullptr, const float *sub = nullptr);
+bool FloatToInt24(const float *src, int *dst, size_t len,
+   const float *add = nullptr, const float *sub = nullptr);
+
+//! Minimum, maximum and sum of squares of each group of samples
+/*!
+ Writes three floats to dst for each group of `group` samples of src, the
+ last group maybe shorter.  NaN samples after the first of a group do not
+ affect its minimum and maximum, as in the scalar loop of
+ SqliteSampleBlock::CalcSummary(), but the sums are added in another order,
+ so they may differ from that loop in the last bits.
+ */
+MATH_API bool SummarizeGroups(
+   const float *src, size_t len, size_t group, float *dst);
+
+}
+
+#endif
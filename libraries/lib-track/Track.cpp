@@ -117,6 +117,23 @@ Track::Holder Track::Duplicate() const
    return result;
 }
 
+Track::Holder Track::SharingDuplicate(const Track &prior) const
+{
+   auto result = SharingClone(prior);
+
+   AttachedTrackObjects::ForEach([&](auto &attachment){
+      // Copy view state that might be important to undo/redo
+      attachment.CopyTo( *result );
+   });
+
+   return result;
+}
+
+Track::Holder Track::SharingClone(const Track &) const
+{
+   return Clone();
+}
+
 Track::~Track()
 {
 }
@@ -419,6 +419,11 @@ private:
    // public nonvirtual duplication function that invokes Clone():
    virtual Holder Duplicate() const;
 
+   //! Like Duplicate(), but for undo history, sharing unchanged contents
+   /*! prior is an earlier copy of this track.  The result may share with it
+    whatever did not change since, so neither may be modified afterwards. */
+   Holder SharingDuplicate(const Track &prior) const;
+
    // Called when this track is merged to stereo with another, and should
    // take on some parameters of its partner.
    virtual void Merge(const Track &orig);
@@ -480,6 +485,9 @@ private:
    // the track data proper (not associated data such as for groups and views):
    virtual Holder Clone() const = 0;
 
+   //! Implements only a part of SharingDuplicate(); default calls Clone()
+   virtual Holder SharingClone(const Track &prior) const;
+
    template<typename T>
       friend std::enable_if_t< std::is_pointer_v<T>, T >
          track_cast(Track *track);
@@ -0,0 +1,365 @@
+/**********************************************************************
+
+  Tenacity: A Digital Audio Editor
+
+  @file TaskScheduler.cpp
+
+**********************************************************************/
+#include "TaskScheduler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+
+namespace {
+std::atomic<unsigned> sThreadBudget{ 0 };
+
+//! The worker that is the current thread, if any, and its scheduler
+thread_local const TaskScheduler *tlScheduler = nullptr;
+thread_local size_t tlIndex = 0;
+
+//! The group whose task the current thread is running, if any
+thread_local const TaskGroup *tlGroup = nullptr;
+
+constexpr auto PollInterval = std::chrono::milliseconds(50);
+
+constexpr size_t InteractiveLane =
+   static_cast<size_t>(TaskScheduler::Lane::Interactive);
+
+//! Makes a group the current one of this thread while in scope, so that
+//! groups made meanwhile are nested in it
+class GroupScope
+{
+public:
+   explicit GroupScope(const TaskGroup *pGroup)
+      : mpOuter{ tlGroup }
+   {
+      tlGroup = pGroup;
+   }
+   ~GroupScope()
+   {
+      tlGroup = mpOuter;
+   }
+
+private:
+   const TaskGroup *const mpOuter;
+};
+}
+
+struct TaskScheduler::Worker
+{
+   std::mutex mMutex;
+   //! Tasks submitted by this worker; it takes the newest, thieves the oldest
+   std::deque<Entry> mQueues[NumLanes];
+};
+
+void TaskScheduler::SetThreadBudget(unsigned nThreads)
+{
+   sThreadBudget = nThreads;
+}
+
+TaskScheduler &TaskScheduler::Get()
+{
+   static TaskScheduler instance{ [] {
+      const auto budget = sThreadBudget.load();
+      return budget > 0
+         ? budget
+         : std::max(1u, std::thread::hardware_concurrency());
+   }() };
+   return instance;
+}
+
+TaskScheduler::TaskScheduler(unsigned nThreads)
+{
+   // The last worker takes only interactive tasks
+   for (unsigned ii = 0; ii <= nThreads; ++ii)
+      mWorkers.push_back(std::make_unique<Worker>());
+   // Start the threads only when all workers exist, for stealing
+   for (unsigned ii = 0; ii <= nThreads; ++ii)
+      mThreads.emplace_back([this, ii]{ Loop(ii); });
+}
+
+TaskScheduler::~TaskScheduler()
+{
+   {
+      std::lock_guard<std::mutex> lock{ mMutex };
+      mStop = true;
+   }
+   mWake.notify_all();
+   mWakeInteractive.notify_all();
+   for (auto &thread : mThreads)
+      thread.join();
+}
+
+unsigned TaskScheduler::GetThreadCount() const
+{
+   return mWorkers.size() - 1;
+}
+
+bool TaskScheduler::IsWorkerThread() const
+{
+   return tlScheduler == this;
+}
+
+void TaskScheduler::Submit(Task task, Lane lane)
+{
+   Submit(std::move(task), lane, nullptr);
+}
+
+void TaskScheduler::Submit(Task task, Lane lane, const TaskGroup *pGroup)
+{
+   const auto iLane = static_cast<size_t>(lane);
+   // Count under the lock so that no idle worker misses the wake-up
+   if (IsWorkerThread()) {
+      auto &worker = *mWorkers[tlIndex];
+      {
+         std::lock_guard<std::mutex> lock{ worker.mMutex };
+         worker.mQueues[iLane].push_back({ std::move(task), pGroup });
+      }
+      std::lock_guard<std::mutex> lock{ mMutex };
+      ++mQueued[iLane];
+   }
+   else {
+      std::lock_guard<std::mutex> lock{ mMutex };
+      mQueues[iLane].push_back({ std::move(task), pGroup });
+      ++mQueued[iLane];
+   }
+   if (iLane == InteractiveLane)
+      mWakeInteractive.notify_one();
+   mWake.notify_one();
+}
+
+bool TaskScheduler::Pop(Worker *pSelf, Task &task, size_t lastLane,
+   const TaskGroup *pGroup)
+{
+   const auto nWorkers = mWorkers.size();
+   const auto take = [&](std::deque<Entry> &queue, size_t iLane, bool newest) {
+      const auto matches = [&](const Entry &entry){
+         return !pGroup || (entry.pGroup && entry.pGroup->IsWithin(*pGroup));
+      };
+      auto iter = queue.end();
+      if (newest) {
+         const auto found = std::find_if(queue.rbegin(), queue.rend(), matches);
+         if (found != queue.rend())
+            iter = std::prev(found.base());
+      }
+      else
+         iter = std::find_if(queue.begin(), queue.end(), matches);
+      if (iter == queue.end())
+         return false;
+      task = std::move(iter->task);
+      queue.erase(iter);
+      --mQueued[iLane];
+      return true;
+   };
+
+   for (size_t iLane = 0; iLane <= lastLane; ++iLane) {
+      // The newest task of this worker, whose data are likely still cached
+      if (pSelf) {
+         std::lock_guard<std::mutex> lock{ pSelf->mMutex };
+         if (take(pSelf->mQueues[iLane], iLane, true))
+            return true;
+      }
+
+      // The oldest task from outside the workers
+      {
+         std::lock_guard<std::mutex> lock{ mMutex };
+         if (take(mQueues[iLane], iLane, false))
+            return true;
+      }
+
+      // The oldest task of another worker, visiting each in turn
+      const auto first = pSelf ? tlIndex + 1 : 0;
+      for (size_t ii = 0; ii < nWorkers; ++ii) {
+         auto &victim = *mWorkers[(first + ii) % nWorkers];
+         if (&victim == pSelf)
+            continue;
+         std::lock_guard<std::mutex> lock{ victim.mMutex };
+         if (take(victim.mQueues[iLane], iLane, false))
+            return true;
+      }
+   }
+   return false;
+}
+
+bool TaskScheduler::RunOneOf(const TaskGroup &group)
+{
+   Task task;
+   if (!Pop(mWorkers[tlIndex].get(), task, NumLanes - 1, &group))
+      return false;
+   task();
+   return true;
+}
+
+void TaskScheduler::Loop(size_t index)
+{
+   tlScheduler = this;
+   tlIndex = index;
+   const auto pSelf = mWorkers[index].get();
+   const bool interactiveOnly = (index == mWorkers.size() - 1);
+   const auto lastLane = interactiveOnly ? InteractiveLane : NumLanes - 1;
+   auto &wake = interactiveOnly ? mWakeInteractive : mWake;
+
+   while (true) {
+      Task task;
+      if (Pop(pSelf, task, lastLane)) {
+         task();
+         continue;
+      }
+
+      std::unique_lock<std::mutex> lock{ mMutex };
+      wake.wait(lock, [&]{
+         if (mStop)
+            return true;
+         for (size_t iLane = 0; iLane <= lastLane; ++iLane)
+            if (mQueued[iLane] > 0)
+               return true;
+         return false;
+      });
+      if (mStop)
+         return;
+   }
+}
+
+TaskGroup::TaskGroup(Lane lane, TaskScheduler &scheduler)
+   : mScheduler{ scheduler }
+   , mLane{ lane }
+   , mpParent{ tlGroup }
+{
+}
+
+TaskGroup::~TaskGroup()
+{
+   Cancel();
+   try {
+      Wait();
+   }
+   catch (...) {
+   }
+}
+
+void TaskGroup::Run(std::function<void()> task)
+{
+   {
+      std::lock_guard<std::mutex> lock{ mMutex };
+      ++mRunning;
+   }
+   try {
+      mScheduler.Submit([this, task = std::move(task)]{
+         if (!IsCancelled()) {
+            GroupScope scope{ this };
+            try {
+               task();
+            }
+            catch (...) {
+               Fail(std::current_exception());
+            }
+         }
+         Finish();
+      }, mLane, this);
+   }
+   catch (...) {
+      Finish();
+      throw;
+   }
+}
+
+void TaskGroup::ParallelFor(
+   size_t count, const std::function<void(size_t)> &body)
+{
+   if (count == 0)
+      return;
+
+   std::atomic<size_t> next{ 0 };
+   const auto work = [&]{
+      for (size_t ii; !IsCancelled() && (ii = next++) < count;)
+         body(ii);
+   };
+
+   try {
+      // This thread works too
+      const auto nHelpers =
+         std::min<size_t>(count - 1, mScheduler.GetThreadCount());
+      for (size_t ii = 0; ii < nHelpers; ++ii)
+         Run(work);
+      GroupScope scope{ this };
+      work();
+   }
+   catch (...) {
+      Fail(std::current_exception());
+   }
+
+   // The helpers use this stack frame, so wait for them even after failure
+   Wait();
+}
+
+void TaskGroup::Cancel() noexcept
+{
+   mCancelled = true;
+}
+
+bool TaskGroup::IsCancelled() const noexcept
+{
+   return mCancelled;
+}
+
+void TaskGroup::Wait(const std::function<bool()> &poll)
+{
+   const auto finished = [this]{ return mRunning == 0; };
+   std::unique_lock<std::mutex> lock{ mMutex };
+   if (mScheduler.IsWorkerThread()) {
+      // Help, so that groups waited for in tasks can't starve the workers;
+      // but only with this group, lest unrelated work nest on this stack
+      while (!finished()) {
+         lock.unlock();
+         const bool ran = mScheduler.RunOneOf(*this);
+         lock.lock();
+         if (!ran)
+            mFinished.wait_for(lock, std::chrono::milliseconds(1), finished);
+      }
+   }
+   else {
+      while (!mFinished.wait_for(lock, PollInterval, finished)) {
+         if (poll) {
+            lock.unlock();
+            const bool keepGoing = poll();
+            lock.lock();
+            if (!keepGoing)
+               Cancel();
+         }
+      }
+   }
+
+   auto error = std::move(mError);
+   mError = nullptr;
+   lock.unlock();
+   if (error)
+      std::rethrow_exception(error);
+}
+
+bool TaskGroup::IsWithin(const TaskGroup &ancestor) const noexcept
+{
+   // Groups are made in the tasks they are nested in, and outlive none of
+   // them, so the chain is intact
+   for (auto pGroup = this; pGroup; pGroup = pGroup->mpParent)
+      if (pGroup == &ancestor)
+         return true;
+   return false;
+}
+
+void TaskGroup::Fail(std::exception_ptr error) noexcept
+{
+   std::lock_guard<std::mutex> lock{ mMutex };
+   if (!mError)
+      mError = error;
+   Cancel();
+}
+
+void TaskGroup::Finish() noexcept
+{
+   // Notify while locked, because the waiting thread may destroy the group
+   // as soon as it sees the count reach zero
+   std::lock_guard<std::mutex> lock{ mMutex };
+   if (--mRunning == 0)
+      mFinished.notify_all();
+}
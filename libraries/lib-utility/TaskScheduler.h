@@ -0,0 +1,171 @@
+/**********************************************************************
+
+  Tenacity: A Digital Audio Editor
+
+  @file TaskScheduler.h
+  @brief Process-wide pool of threads that run tasks, stealing from each
+  other
+
+**********************************************************************/
+#ifndef __TENACITY_TASK_SCHEDULER__
+#define __TENACITY_TASK_SCHEDULER__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class TaskGroup;
+
+//! A fixed number of worker threads shared by all of the application
+/*!
+ Each worker has its own queues and takes its newest task first; an idle
+ worker takes the oldest task submitted from outside the workers, or else
+ steals the oldest task of another worker.  Tasks in the interactive lane
+ are always taken before any in the batch lane, and one more worker takes
+ only those, so that they never wait behind long batch tasks.
+
+ Submit work through a TaskGroup, which waits for its tasks, collects
+ their exceptions and can cancel them.
+ */
+class UTILITY_API TaskScheduler final
+{
+public:
+   //! Priority of tasks
+   enum class Lane {
+      Interactive, //!< Work that someone is waiting to see
+      Batch,       //!< Long processing, as by effects, import and export
+   };
+   static constexpr size_t NumLanes = 2;
+
+   using Task = std::function<void()>;
+
+   //! Set the number of worker threads, before the first call to Get()
+   /*! Zero, the default, means one per hardware thread */
+   static void SetThreadBudget(unsigned nThreads);
+
+   //! The scheduler of the process, which starts its threads on first use
+   static TaskScheduler &Get();
+
+   TaskScheduler(const TaskScheduler&) = delete;
+   TaskScheduler &operator=(const TaskScheduler&) = delete;
+   //! Stops the workers, dropping tasks not yet started
+   ~TaskScheduler();
+
+   //! Number of workers that take batch tasks, not counting the one
+   //! reserved for interactive tasks
+   unsigned GetThreadCount() const;
+
+   //! Whether the calling thread is one of the workers of this scheduler
+   bool IsWorkerThread() const;
+
+   //! Queue a task, which must not throw
+   void Submit(Task task, Lane lane = Lane::Batch);
+
+private:
+   friend TaskGroup;
+
+   explicit TaskScheduler(unsigned nThreads);
+
+   struct Worker;
+   struct Entry {
+      Task task;
+      //! The group that submitted the task, if any
+      const TaskGroup *pGroup;
+   };
+
+   void Submit(Task task, Lane lane, const TaskGroup *pGroup);
+
+   //! Take a task of a lane up to lastLane; if pGroup is not null, only one
+   //! of pGroup or of a group nested in its tasks
+   bool Pop(Worker *pSelf, Task &task, size_t lastLane,
+      const TaskGroup *pGroup = nullptr);
+   //! Run in the calling worker one queued task of group or of a group nested
+   //! in its tasks, but no other, which might take long or need locks that
+   //! the caller holds
+   /*! @return whether a task was run */
+   bool RunOneOf(const TaskGroup &group);
+   void Loop(size_t index);
+
+   std::vector<std::unique_ptr<Worker>> mWorkers;
+   std::vector<std::thread> mThreads;
+
+   //! Guards mQueues and mStop, and the waiting of idle workers
+   std::mutex mMutex;
+   //! Wakes workers that take any task
+   std::condition_variable mWake;
+   //! Wakes the worker that takes only interactive tasks
+   std::condition_variable mWakeInteractive;
+   //! Tasks submitted from outside the workers
+   std::deque<Entry> mQueues[NumLanes];
+   //! Tasks of each lane queued anywhere and not yet taken
+   std::atomic<size_t> mQueued[NumLanes]{};
+   bool mStop{ false };
+};
+
+//! Tasks submitted together to a TaskScheduler, to wait for or cancel
+/*!
+ The first exception from any task is rethrown by Wait(), and cancels the
+ tasks of the group that have not yet started.
+ */
+class UTILITY_API TaskGroup final
+{
+public:
+   using Lane = TaskScheduler::Lane;
+
+   explicit TaskGroup(Lane lane = Lane::Batch,
+      TaskScheduler &scheduler = TaskScheduler::Get());
+   TaskGroup(const TaskGroup&) = delete;
+   TaskGroup &operator=(const TaskGroup&) = delete;
+   //! Cancels, and waits for tasks already running, ignoring exceptions
+   ~TaskGroup();
+
+   //! Queue one task
+   void Run(std::function<void()> task);
+
+   //! Call body for each index in [0, count), in this thread and in as many
+   //! workers as are useful, and wait for all
+   /*! Indices not yet started when the group is cancelled are skipped.
+    @excsafety{Strong} -- if body gives it */
+   void ParallelFor(size_t count, const std::function<void(size_t)> &body);
+
+   //! Skip the tasks that have not yet started
+   /*! Running tasks may check IsCancelled() to stop early */
+   void Cancel() noexcept;
+   bool IsCancelled() const noexcept;
+
+   //! Wait for all tasks run so far, then rethrow the first exception
+   /*! In a worker thread, runs queued tasks of this group, or of groups
+    nested in its tasks, meanwhile.  Otherwise, calls
+    poll, if given, about every 50 ms, as to update a progress dialog, and
+    cancels the group when it returns false. */
+   void Wait(const std::function<bool()> &poll = {});
+
+private:
+   friend TaskScheduler;
+
+   void Fail(std::exception_ptr error) noexcept;
+   void Finish() noexcept;
+   //! Whether this is ancestor, or nested in tasks of ancestor
+   bool IsWithin(const TaskGroup &ancestor) const noexcept;
+
+   TaskScheduler &mScheduler;
+   const Lane mLane;
+   //! The group whose task was running in the thread that made this one
+   const TaskGroup *const mpParent;
+
+   std::mutex mMutex;
+   std::condition_variable mFinished;
+   //! Tasks submitted and not yet finished or skipped
+   size_t mRunning{ 0 };
+   std::exception_ptr mError;
+   std::atomic<bool> mCancelled{ false };
+};
+
+#endif
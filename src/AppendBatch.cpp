@@ -0,0 +1,151 @@
+/**********************************************************************
+
+  Tenacity: A Digital Audio Editor
+
+  @file AppendBatch.cpp
+
+**********************************************************************/
+#include "AppendBatch.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+// Tenacity libraries
+#include <lib-preferences/Prefs.h>
+#include <lib-utility/MemoryX.h>
+#include <lib-utility/TaskScheduler.h>
+
+#include "SampleBlock.h"
+#include "Sequence.h"
+#include "WaveClip.h"
+
+static IntSetting RecordingThreads{ L"/Performance/RecordingThreads", 0 };
+
+unsigned AppendBatch::DefaultThreads()
+{
+   // Zero, the default, means as many as the task scheduler has
+   const auto nThreads = RecordingThreads.Read();
+   return nThreads > 0
+      ? nThreads
+      : TaskScheduler::Get().GetThreadCount() + 1;
+}
+
+AppendBatch::AppendBatch(unsigned nThreads)
+   : mParallel{ nThreads > 1 }
+{
+}
+
+AppendBatch::~AppendBatch()
+{
+}
+
+/*! @excsafety{Strong} -- for each clip, as of its last appended block */
+bool AppendBatch::Store(const std::vector<WaveClip *> &clips)
+{
+   bool stored = false;
+
+   // Visit each clip once, in the given order
+   std::vector<WaveClip *> uniqueClips;
+   for (auto pClip : clips)
+      if (pClip && std::find(uniqueClips.begin(), uniqueClips.end(), pClip)
+            == uniqueClips.end())
+         uniqueClips.push_back(pClip);
+
+   //! A full block at the start of the append buffer of a clip
+   struct Pending {
+      WaveClip *pClip;
+      SampleBlockFactory *pFactory;
+      constSamplePtr samples;
+      sampleFormat format;
+      size_t len;
+      SampleBlockFactory::PreparedBlockPtr prepared;
+   };
+   std::vector<Pending> pending;
+
+   for (auto pClip : uniqueClips) {
+      auto &clip = *pClip;
+      auto &sequence = *clip.mSequence;
+      const auto format = sequence.GetSampleFormat();
+      const auto maxBlockSize = sequence.GetMaxBlockSize();
+
+      // A first block that must fill up the last block of the sequence is
+      // stored now, as WaveClip::Append() would store it
+      const auto idealLen = sequence.GetIdealAppendLen();
+      if (idealLen < maxBlockSize && clip.mAppendBufferLen >= idealLen) {
+         sequence.Append(clip.mAppendBuffer.ptr(), format, idealLen);
+         stored = true;
+         memmove(clip.mAppendBuffer.ptr(),
+            clip.mAppendBuffer.ptr() + idealLen * SAMPLE_SIZE(format),
+            (clip.mAppendBufferLen - idealLen) * SAMPLE_SIZE(format));
+         clip.mAppendBufferLen -= idealLen;
+         clip.UpdateEnvelopeTrackLen();
+         clip.MarkChanged();
+      }
+
+      // The rest are whole blocks of the maximum size
+      for (size_t offset = 0;
+           offset + maxBlockSize <= clip.mAppendBufferLen;
+           offset += maxBlockSize)
+         pending.push_back({ &clip, sequence.GetFactory().get(),
+            clip.mAppendBuffer.ptr() + offset * SAMPLE_SIZE(format),
+            format, maxBlockSize, {} });
+   }
+
+   if (pending.empty())
+      return stored;
+
+   // Copy the samples and compute the summaries concurrently
+   const auto prepare = [&](size_t ii){
+      auto &block = pending[ii];
+      block.prepared = block.pFactory->Prepare(
+         block.samples, block.len, block.format);
+   };
+   if (mParallel)
+      // Recording can't wait behind long batch work
+      TaskGroup{ TaskGroup::Lane::Interactive }
+         .ParallelFor(pending.size(), prepare);
+   else
+      for (size_t ii = 0; ii < pending.size(); ++ii)
+         prepare(ii);
+
+   // Store the blocks of each factory in one batch, in order
+   std::vector<SampleBlockPtr> blocks;
+   blocks.reserve(pending.size());
+   for (size_t ii = 0, nn = pending.size(); ii < nn;) {
+      const auto pFactory = pending[ii].pFactory;
+      std::vector<SampleBlockFactory::PreparedBlockPtr> batch;
+      for (; ii < nn && pending[ii].pFactory == pFactory; ++ii)
+         batch.push_back(std::move(pending[ii].prepared));
+      auto created = pFactory->CreatePrepared(std::move(batch));
+      std::move(created.begin(), created.end(), std::back_inserter(blocks));
+   }
+
+   // Append the blocks to their clips, then remove their samples from the
+   // append buffers, even if appending fails part way
+   for (auto pClip : uniqueClips) {
+      auto &clip = *pClip;
+      size_t appended = 0;
+      auto cleanup = finally([&]{
+         if (appended == 0)
+            return;
+         const auto sampleSize =
+            SAMPLE_SIZE(clip.mSequence->GetSampleFormat());
+         memmove(clip.mAppendBuffer.ptr(),
+            clip.mAppendBuffer.ptr() + appended * sampleSize,
+            (clip.mAppendBufferLen - appended) * sampleSize);
+         clip.mAppendBufferLen -= appended;
+         clip.UpdateEnvelopeTrackLen();
+         clip.MarkChanged();
+      });
+      for (size_t ii = 0, nn = pending.size(); ii < nn; ++ii) {
+         if (pending[ii].pClip != pClip)
+            continue;
+         clip.mSequence->AppendSharedBlock(blocks[ii]);
+         appended += pending[ii].len;
+         stored = true;
+      }
+   }
+
+   return stored;
+}
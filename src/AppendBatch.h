@@ -0,0 +1,55 @@
+/**********************************************************************
+
+  Tenacity: A Digital Audio Editor
+
+  @file AppendBatch.h
+
+  Stores the full blocks appended to many clips at once
+
+**********************************************************************/
+#ifndef __TENACITY_APPEND_BATCH__
+#define __TENACITY_APPEND_BATCH__
+
+#include <vector>
+
+class WaveClip;
+
+//! Stores the full blocks in the append buffers of clips, computing their
+//! summaries in the task scheduler
+/*!
+ Samples are first added with WaveClip::AppendToBuffer(), which only copies
+ them.  Store() then splits the append buffers into blocks as
+ WaveClip::Append() would, computes the summaries of all blocks of all clips
+ concurrently, stores the blocks of each sample block factory in one batch,
+ and appends them to their clips in order.
+
+ The samples stay in the append buffers until their blocks are appended, so
+ a failure leaves each clip as it was after its last appended block, and
+ appending more samples while Store() lags behind only lets the buffers grow
+ until the next Store() catches up.
+ */
+class TENACITY_DLL_API AppendBatch
+{
+public:
+   //! Number of threads from preferences; zero in preferences means the
+   //! task scheduler's and the calling thread
+   static unsigned DefaultThreads();
+
+   //! If nThreads is 1, Store() computes all the summaries in the calling
+   //! thread; otherwise it shares them with the task scheduler
+   explicit AppendBatch(unsigned nThreads = DefaultThreads());
+   AppendBatch(const AppendBatch&) = delete;
+   AppendBatch &operator=(const AppendBatch&) = delete;
+   ~AppendBatch();
+
+   //! Store the full blocks in the append buffers of the clips
+   /*! Clips may repeat in the list.  Leaves less than one block in each
+    append buffer.
+    @return whether any blocks were stored */
+   bool Store(const std::vector<WaveClip *> &clips);
+
+private:
+   const bool mParallel;
+};
+
+#endif
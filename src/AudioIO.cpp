@@ -61,6 +61,7 @@ time warp info and AudioIOListener and whether the playback is looped.
 
 
 #include "AudioIO.h"
+#include "AppendBatch.h"
 #include "AudioIOExt.h"
 #include "AudioIOListener.h"
 
@@ -81,6 +82,7 @@ time warp info and AudioIOListener and whether the playback is looped.
 #endif
 
 #include <wx/app.h>
+#include <wx/log.h>
 #include <wx/wxcrtvararg.h>
 #include <wx/time.h>
 
@@ -98,6 +100,7 @@ time warp info and AudioIOListener and whether the playback is looped.
 
 #include "Meter.h"
 #include "Mix.h"
+#include "RealtimeChecks.h"
 #include "RingBuffer.h"
 #include "Decibels.h"
 #include "Project.h"
@@ -159,6 +162,8 @@ constexpr size_t TimeQueueGrainSize = 2000;
 #include "pa_linux_alsa.h"
 #endif
 
+//! How many blocks of each track to read ahead of playback
+static IntSetting PlaybackReadAheadBlocks{ L"/AudioIO/ReadAheadBlocks", 4 };
 
 struct AudioIoCallback::ScrubState : NonInterferingBase
 {
@@ -911,6 +916,7 @@ int AudioIO::StartStream(const TransportTracks &tracks,
    mPlaybackBuffers.reset();
    mPlaybackMixers.reset();
    mCaptureBuffers.reset();
+   mpAppendBatch.reset();
    mResample.reset();
    mTimeQueue.mData.reset();
 
@@ -982,7 +988,8 @@ int AudioIO::StartStream(const TransportTracks &tracks,
          auto & em = RealtimeEffectManager::Get(*pOwningProject);
          // Setup for realtime playback at the rate of the realtime
          // stream, not the rate of the track.
-         em.RealtimeInitialize(mRate);
+         em.RealtimeInitialize(mRate,
+            mNumPlaybackChannels, GetConvertedLatencyPreference());
 
          // The following adds a NEW effect processor for each logical track and the
          // group determination should mimic what is done in audacityAudioCallback()
@@ -1302,6 +1309,10 @@ bool AudioIO::AllocateBuffers(
                   nullptr,
                   false // don't apply track gains
                );
+               // Keep the playback thread from waiting on the disk at
+               // block boundaries
+               mPlaybackMixers[i]->SetReadAhead(
+                  std::max(0, PlaybackReadAheadBlocks.Read()));
             }
          }
 
@@ -1331,6 +1342,13 @@ bool AudioIO::AllocateBuffers(
                   std::make_unique<Resample>(true, mFactor, mFactor);
                   // constant rate resampling
             }
+
+            // Compute the summaries of the recorded blocks on worker threads
+            const auto nThreads = AppendBatch::DefaultThreads();
+            if (nThreads > 1)
+               mpAppendBatch = std::make_unique<AppendBatch>(nThreads);
+            else
+               mpAppendBatch.reset();
          }
       }
       catch(std::bad_alloc&)
@@ -1370,6 +1388,7 @@ void AudioIO::StartStreamCleanup(bool bOnlyBuffers)
    mPlaybackBuffers.reset();
    mPlaybackMixers.reset();
    mCaptureBuffers.reset();
+   mpAppendBatch.reset();
    mResample.reset();
    mTimeQueue.mData.reset();
 
@@ -1437,6 +1456,16 @@ void AudioIO::StopStream()
 
    std::lock_guard<std::mutex> locker(mSuspendAudioThread);
 
+   {
+      const auto counts = RealtimeChecks::Take();
+      if (counts.allocations || counts.locks || counts.bypassed)
+         wxLogDebug(
+            wxT("Audio callback made %llu heap allocations, waited for %llu locks, and bypassed realtime effects %llu times"),
+            static_cast<unsigned long long>(counts.allocations),
+            static_cast<unsigned long long>(counts.locks),
+            static_cast<unsigned long long>(counts.bypassed));
+   }
+
    // No longer need effects processing
    if (mNumPlaybackChannels > 0)
    {
@@ -1530,6 +1559,7 @@ void AudioIO::StopStream()
       if (mCaptureTracks.size() > 0)
       {
          mCaptureBuffers.reset();
+         mpAppendBatch.reset();
          mResample.reset();
 
          //
@@ -2083,6 +2113,16 @@ void AudioIO::DrainRecordBuffers()
 
          // Append captured samples to the end of the WaveTracks.
          // The WaveTracks have their own buffering for efficiency.
+         // With a batch, they only buffer the samples, and the batch stores
+         // the blocks of all of them after the loop.
+         std::vector<WaveClip *> clips;
+         const auto append = [&](WaveTrack &track,
+            constSamplePtr buffer, sampleFormat format, size_t len) {
+            if (!mpAppendBatch)
+               return track.Append(buffer, format, len, 1);
+            clips.push_back(track.AppendToBuffer(buffer, format, len));
+            return false;
+         };
          auto numChannels = mCaptureTracks.size();
 
          for( size_t i = 0; i < numChannels; i++ )
@@ -2100,7 +2140,7 @@ void AudioIO::DrainRecordBuffers()
                   size_t size = floor( correction * mRate * mFactor);
                   SampleBuffer temp(size, trackFormat);
                   ClearSamples(temp.ptr(), trackFormat, 0, size);
-                  mCaptureTracks[i]->Append(temp.ptr(), trackFormat, size, 1);
+                  append(*mCaptureTracks[i], temp.ptr(), trackFormat, size);
                }
                else {
                   // Leftward shift
@@ -2137,6 +2177,27 @@ void AudioIO::DrainRecordBuffers()
 
             wxASSERT(discarded <= avail);
             size_t toGet = avail - discarded;
+
+            if( mFactor == 1.0 && !pCrossfadeSrc )
+            {
+               // The ring buffer holds samples of the track's format, so
+               // append them from where they are, without a temporary copy
+               auto &ringBuffer = *mCaptureBuffers[i];
+               const auto span = ringBuffer.GetReadable(toGet);
+               size_t size = span.Size();
+               if (double(size) > remainingSamples)
+                  size = floor(remainingSamples);
+               for (unsigned piece = 0; piece < 2 && size > 0; ++piece) {
+                  const auto count = std::min(size, span.count[piece]);
+                  // see comment in second handler about guarantee
+                  newBlocks = append(*mCaptureTracks[i],
+                     span.data[piece], trackFormat, count) || newBlocks;
+                  size -= count;
+               }
+               ringBuffer.Consume(span.Size());
+               continue;
+            }
+
             SampleBuffer temp;
             size_t size;
             sampleFormat format;
@@ -2202,10 +2263,14 @@ void AudioIO::DrainRecordBuffers()
 
             // Now append
             // see comment in second handler about guarantee
-            newBlocks = mCaptureTracks[i]->Append(temp.ptr(), format, size, 1)
+            newBlocks = append(*mCaptureTracks[i], temp.ptr(), format, size)
                || newBlocks;
          } // end loop over capture channels
 
+         if (mpAppendBatch)
+            // see comment in second handler about guarantee
+            newBlocks = mpAppendBatch->Store(clips) || newBlocks;
+
          // Now update the recording schedule position
          mRecordingSchedule.mPosition += avail / mRate;
          mRecordingSchedule.mLatencyCorrected = latencyCorrected;
@@ -2387,6 +2452,9 @@ void AudioIoCallback::UpdateBuffers()
    {
       buffer = mScratchBufferAllocator.Allocate(true, newBufferSize);
    }
+   mChannelBuffers.resize(mScratchBuffers.size());
+   mInPlaceBuffers.assign(mScratchBuffers.size(), nullptr);
+   mCallbackScratch.reinit(newBufferSize * std::max(channels, 1u));
 
    mBuffersPrepared = true;
 }
@@ -2444,6 +2512,15 @@ bool AudioIoCallback::FillOutputBuffers(
       const auto toGet =
          std::min<size_t>(framesPerBuffer, GetCommonlyReadyPlayback());
 
+      // Give back the ring buffer space of channels that were read in place
+      const auto consumeInPlace = [&]{
+         for (int c = 0; c < chanCnt; c++)
+            if (auto &pBuffer = mInPlaceBuffers[c]) {
+               pBuffer->Consume(toGet);
+               pBuffer = nullptr;
+            }
+      };
+
       // The drop and dropQuickly booleans are so named for historical reasons.
       // JKC: The original code attempted to be faster by doing nothing on silenced audio.
       // This, IMHO, is 'premature optimisation'.  Instead clearer and cleaner code would
@@ -2502,22 +2579,36 @@ bool AudioIoCallback::FillOutputBuffers(
          }
          else
          {
-            len = mPlaybackBuffers[t]->Get((samplePtr)mScratchBuffers[chanCnt],
-                                                      floatSample,
-                                                      toGet);
-            // assert( len == toGet );
-            if (len < framesPerBuffer)
-            {
-               // This used to happen normally at the end of non-looping
-               // plays, but it can also be an anomalous case where the
-               // supply from TrackBufferExchange fails to keep up with the
-               // real-time demand in this thread (see bug 1932).  We
-               // must supply something to the sound card, so pad it with
-               // zeroes and not random garbage.
-               memset((void*)&mScratchBuffers[chanCnt][len], 0,
-                  (framesPerBuffer - len) * sizeof(float));
+            // The ring buffer holds floats.  If the samples don't wrap
+            // around its end, mix them (and let realtime effects modify
+            // them) where they are, and consume them afterwards.
+            auto &ringBuffer = *mPlaybackBuffers[t];
+            const auto span = ringBuffer.GetReadable(toGet);
+            if (span.count[0] == toGet) {
+               mChannelBuffers[chanCnt] = (float*)span.data[0];
+               mInPlaceBuffers[chanCnt] = &ringBuffer;
+               len = toGet;
+               chanCnt++;
+            }
+            else {
+               mChannelBuffers[chanCnt] = mScratchBuffers[chanCnt];
+               len = ringBuffer.Get((samplePtr)mScratchBuffers[chanCnt],
+                                    floatSample,
+                                    toGet);
+               // assert( len == toGet );
+               if (len < framesPerBuffer)
+               {
+                  // This used to happen normally at the end of non-looping
+                  // plays, but it can also be an anomalous case where the
+                  // supply from TrackBufferExchange fails to keep up with the
+                  // real-time demand in this thread (see bug 1932).  We
+                  // must supply something to the sound card, so pad it with
+                  // zeroes and not random garbage.
+                  memset((void*)&mScratchBuffers[chanCnt][len], 0,
+                     (framesPerBuffer - len) * sizeof(float));
+               }
+               chanCnt++;
             }
-            chanCnt++;
          }
 
          // PRL:  Bug1104:
@@ -2536,12 +2627,14 @@ bool AudioIoCallback::FillOutputBuffers(
          len = mMaxFramesOutput;
 
          if( !dropQuickly && selected )
-            len = scope.Process(group, chanCnt, mScratchBuffers.data(), len);
+            len = scope.Process(group, chanCnt, mChannelBuffers.data(), len);
          group++;
 
          CallbackCheckCompletion(mCallbackReturn, len);
-         if (dropQuickly) // no samples to process, they've been discarded
+         if (dropQuickly) { // no samples to process, they've been discarded
+            consumeInPlace();
             continue;
+         }
 
          // Our channels aren't silent.  We need to pass their data on.
          //
@@ -2560,14 +2653,15 @@ bool AudioIoCallback::FillOutputBuffers(
             if (vt->GetChannelIgnoringPan() == Track::LeftChannel ||
                   vt->GetChannelIgnoringPan() == Track::MonoChannel )
                AddToOutputChannel( 0, outputMeterFloats, outputFloats,
-                  mScratchBuffers[c], drop, len, *vt);
+                  mChannelBuffers[c], drop, len, *vt);
 
             if (vt->GetChannelIgnoringPan() == Track::RightChannel ||
                   vt->GetChannelIgnoringPan() == Track::MonoChannel  )
                AddToOutputChannel( 1, outputMeterFloats, outputFloats,
-                  mScratchBuffers[c], drop, len, *vt);
+                  mChannelBuffers[c], drop, len, *vt);
          }
 
+         consumeInPlace();
          chanCnt = 0;
       }
 
@@ -2686,46 +2780,63 @@ void AudioIoCallback::DrainInputBuffers(
    // possible issues with the (short*) cast.  We'd have a problem if
    // sizeof(short) > sizeof(float) since our buffers are sized for floats.
    for(unsigned t = 0; t < numCaptureChannels; t++) {
+      auto &ringBuffer = *mCaptureBuffers[t];
+
+      // Un-interleave directly into the ring buffer when it holds samples
+      // of the capture format; else into tempFloats, and let Put() convert.
+      const bool inPlace = ringBuffer.GetFormat() == mCaptureFormat;
+      const auto span = inPlace
+         ? ringBuffer.GetWritable(len)
+         : RingBuffer::Span{ { (samplePtr)tempFloats }, { len } };
+
+      size_t frame = 0;
+      for (unsigned piece = 0; piece < 2; ++piece) {
+         const auto count = span.count[piece];
+
+         // dmazzoni:
+         // Un-interleave.  Ugly special-case code required because the
+         // capture channels could be in three different sample formats;
+         // it'd be nice to be able to call CopySamples, but it can't
+         // handle multiplying by the gain and then clipping.  Bummer.
+
+         switch(mCaptureFormat) {
+            case floatSample: {
+               auto inputFloats = (const float *)inputBuffer;
+               auto destFloats = (float *)span.data[piece];
+               for(unsigned i = 0; i < count; i++)
+                  destFloats[i] =
+                     inputFloats[numCaptureChannels*(frame+i)+t];
+            } break;
+            case int24Sample:
+               // We should never get here. Audacity's int24Sample format
+               // is different from PortAudio's sample format and so we
+               // make PortAudio return float samples when recording in
+               // 24-bit samples.
+               assert(false);
+               break;
+            case int16Sample: {
+               auto inputShorts = (const short *)inputBuffer;
+               short *destShorts = (short *)span.data[piece];
+               for( unsigned i = 0; i < count; i++) {
+                  float tmp = inputShorts[numCaptureChannels*(frame+i)+t];
+                  tmp = wxClip( -32768, tmp, 32767 );
+                  destShorts[i] = (short)(tmp);
+               }
+            } break;
+         } // switch
 
-      // dmazzoni:
-      // Un-interleave.  Ugly special-case code required because the
-      // capture channels could be in three different sample formats;
-      // it'd be nice to be able to call CopySamples, but it can't
-      // handle multiplying by the gain and then clipping.  Bummer.
-
-      switch(mCaptureFormat) {
-         case floatSample: {
-            auto inputFloats = (const float *)inputBuffer;
-            for(unsigned i = 0; i < len; i++)
-               tempFloats[i] =
-                  inputFloats[numCaptureChannels*i+t];
-         } break;
-         case int24Sample:
-            // We should never get here. Audacity's int24Sample format
-            // is different from PortAudio's sample format and so we
-            // make PortAudio return float samples when recording in
-            // 24-bit samples.
-            assert(false);
-            break;
-         case int16Sample: {
-            auto inputShorts = (const short *)inputBuffer;
-            short *tempShorts = (short *)tempFloats;
-            for( unsigned i = 0; i < len; i++) {
-               float tmp = inputShorts[numCaptureChannels*i+t];
-               tmp = wxClip( -32768, tmp, 32767 );
-               tempShorts[i] = (short)(tmp);
-            }
-         } break;
-      } // switch
+         frame += count;
+      }
 
       // JKC: mCaptureFormat must be for samples with sizeof(float) or
       // fewer bytes (because tempFloats is sized for floats).  All 
       // formats are 2 or 4 bytes, so we are OK.
-      //const auto put = // unused
-         mCaptureBuffers[t]->Put(
+      if (inPlace)
+         ringBuffer.Produce(span.Size());
+      else
+         ringBuffer.Put(
             (samplePtr)tempFloats, mCaptureFormat, len);
-      // assert(put == len);
-      // but we can't assert in this thread
+      // Both make all of len available, but we can't assert in this thread
    }
 }
 
@@ -2954,6 +3065,9 @@ int AudioIoCallback::AudioCallback(
    const PaStreamCallbackTimeInfo *timeInfo,
    const PaStreamCallbackFlags statusFlags, void * WXUNUSED(userData) )
 {
+   // Count any heap allocations or waits for locks from here on
+   RealtimeChecks::Scope checks;
+
    // Poll tracks for change of state.  User might click mute and solo buttons.
    mbHasSoloTracks = CountSoloingTracks() > 0 ;
    mCallbackReturn = paContinue;
@@ -2975,15 +3089,12 @@ int AudioIoCallback::AudioCallback(
          mRate, mNumPauseFrames, IsPaused(), mbHasSoloTracks);
    }
 
-   // ------ MEMORY ALLOCATIONS -----------------------------------------------
-   // tempFloats will be a reusable scratch pad for (possibly format converted)
+   // tempFloats is a reusable scratch pad for (possibly format converted)
    // audio data.  One temporary use is for the InputMeter data.
-   const auto numPlaybackChannels = mNumPlaybackChannels;
+   // UpdateBuffers() sized it for the frames per buffer requested of
+   // PortAudio, as it did the other scratch buffers.
    const auto numCaptureChannels = mNumCaptureChannels;
-   std::unique_ptr<float> tempFloats(
-      new float[framesPerBuffer * std::max(numCaptureChannels, numPlaybackChannels)]
-   );
-   // ----- END of MEMORY ALLOCATIONS ------------------------------------------
+   const auto tempFloats = mCallbackScratch.get();
 
    if (inputBuffer && numCaptureChannels) {
       float *inputSamples;
@@ -2993,8 +3104,8 @@ int AudioIoCallback::AudioCallback(
       }
       else {
          SamplesToFloats(reinterpret_cast<constSamplePtr>(inputBuffer),
-            mCaptureFormat, tempFloats.get(), framesPerBuffer * numCaptureChannels);
-         inputSamples = tempFloats.get();
+            mCaptureFormat, tempFloats, framesPerBuffer * numCaptureChannels);
+         inputSamples = tempFloats;
       }
 
       SendVuInputMeterData(
@@ -3042,7 +3153,7 @@ int AudioIoCallback::AudioCallback(
       inputBuffer,
       framesPerBuffer,
       statusFlags,
-      tempFloats.get());
+      tempFloats);
 
    SendVuOutputMeterData( outputBuffer, framesPerBuffer);
 
@@ -3052,7 +3163,8 @@ int AudioIoCallback::AudioCallback(
 int AudioIoCallback::CallbackDoSeek()
 {
    const int token = mStreamToken;
-   std::lock_guard<std::mutex> locker(mSuspendAudioThread);
+   // Seeking must wait for the audio thread
+   RealtimeChecks::LockGuard<std::mutex> locker(mSuspendAudioThread);
    if (token != mStreamToken)
       // This stream got destroyed while we waited for it
       return paAbort;
@@ -31,6 +31,7 @@
 #include <lib-math/SampleFormat.h>
 #include <lib-utility/MessageBuffer.h>
 
+class AppendBatch;
 class AudioIOBase;
 class AudioIO;
 class RingBuffer;
@@ -225,8 +226,17 @@ protected:
    // Buffers
    std::vector<WaveTrack*> mTrackChannelsBuffer;
    std::vector<float*>     mScratchBuffers;
+   //! Samples of each channel of the current track, either in a scratch
+   //! buffer or in place in its playback ring buffer
+   std::vector<float*>     mChannelBuffers;
+   //! For each channel read in place, the ring buffer to consume from once
+   //! the track is mixed, else null
+   std::vector<RingBuffer*> mInPlaceBuffers;
    AutoAllocator<float>    mScratchBufferAllocator;
    std::shared_ptr<float>  mTemporaryBuffer;
+   //! Scratch for converted input samples in the audio callback, sized by
+   //! UpdateBuffers() so that the callback does not allocate
+   Floats                  mCallbackScratch;
 
    // Bufer preparation status
    bool mBuffersPrepared;
@@ -249,6 +259,9 @@ public:
    ArrayOf<std::unique_ptr<Resample>> mResample;
    ArrayOf<std::unique_ptr<RingBuffer>> mCaptureBuffers;
    WaveTrackArray      mCaptureTracks;
+   //! Stores the recorded blocks of all capture tracks together; null if
+   //! each track stores its own as it appends
+   std::unique_ptr<AppendBatch> mpAppendBatch;
    ArrayOf<std::unique_ptr<RingBuffer>> mPlaybackBuffers;
    WaveTrackArray      mPlaybackTracks;
 
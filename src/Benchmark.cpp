@@ -32,8 +32,12 @@ of sample block storage.
 #include <wx/valtext.h>
 #include <wx/intl.h>
 
+#include <cstring>
+
 // Tenacity libraries
 #include <lib-files/FileNames.h>
+#include <lib-math/Dither.h>
+#include <lib-math/SampleFormatSIMD.h>
 #include <lib-preferences/Prefs.h>
 
 #include "SampleBlock.h"
@@ -69,6 +73,10 @@ private:
    void OnClear( wxCommandEvent &event );
    void OnClose( wxCommandEvent &event );
 
+   //! Time the sample format conversions with each available set of kernels
+   //! and compare their results with those of the scalar code
+   bool BenchmarkConversions(size_t nSamples, unsigned seed);
+
    void Printf(const TranslatableString &str);
    void HoldPrint(bool hold);
    void FlushPrint();
@@ -321,6 +329,80 @@ void BenchmarkDialog::FlushPrint()
    mToPrint = wxT("");
 }
 
+bool BenchmarkDialog::BenchmarkConversions(size_t nSamples, unsigned seed)
+{
+   Printf( XO("Timing sample format conversions of %lld samples...\n")
+      .Format( (long long) nSamples ) );
+   wxTheApp->Yield();
+   FlushPrint();
+
+   struct Conversion {
+      const char *name;
+      DitherType dither;
+      sampleFormat source, dest;
+   };
+   static const Conversion conversions[] = {
+      { "16 bit to float",         DitherType::none,      int16Sample, floatSample },
+      { "24 bit to float",         DitherType::none,      int24Sample, floatSample },
+      { "16 bit to 24 bit",        DitherType::none,      int16Sample, int24Sample },
+      { "float to 16 bit",         DitherType::none,      floatSample, int16Sample },
+      { "float to 24 bit",         DitherType::none,      floatSample, int24Sample },
+      { "float to 16 bit, rect.",  DitherType::rectangle, floatSample, int16Sample },
+      { "float to 16 bit, tri.",   DitherType::triangle,  floatSample, int16Sample },
+      { "float to 24 bit, tri.",   DitherType::triangle,  floatSample, int24Sample },
+   };
+
+   // Source samples in each format, somewhat beyond full scale
+   SampleBuffer floats{ nSamples, floatSample };
+   SampleBuffer ints{ nSamples, int24Sample };
+   SampleBuffer shorts{ nSamples, int16Sample };
+   srand(seed);
+   for (size_t ii = 0; ii < nSamples; ++ii) {
+      const float value = 2.2f * (rand() / (float)RAND_MAX - 0.5f);
+      ((float*)floats.ptr())[ii] = value;
+      ((int*)ints.ptr())[ii] = int(value * (1 << 22));
+      ((short*)shorts.ptr())[ii] = short(value * (1 << 14));
+   }
+   const auto source = [&](sampleFormat format) {
+      return format == floatSample ? floats.ptr()
+         : format == int24Sample ? ints.ptr() : shorts.ptr();
+   };
+
+   const auto oldKernels = GetConversionKernels();
+   const auto cleanup = finally( [&] { SetConversionKernels(oldKernels); } );
+   const auto best = BestConversionKernels();
+
+   SampleBuffer expected{ nSamples, floatSample };
+   SampleBuffer result{ nSamples, floatSample };
+   wxStopWatch timer;
+   bool good = true;
+   for (const auto &conversion : conversions) {
+      const auto bytes = nSamples * SAMPLE_SIZE(conversion.dest);
+      for (auto kernels = ConversionKernels::Scalar; kernels <= best;
+           kernels = ConversionKernels(unsigned(kernels) + 1)) {
+         SetConversionKernels(kernels);
+         auto &buffer = kernels == ConversionKernels::Scalar ? expected : result;
+         // The dithers must draw the same noise for every set of kernels
+         srand(seed);
+         Dither dither;
+         timer.Start();
+         dither.Apply(conversion.dither,
+            source(conversion.source), conversion.source,
+            buffer.ptr(), conversion.dest, nSamples);
+         const auto elapsed = timer.Time();
+
+         const bool same = kernels == ConversionKernels::Scalar ||
+            0 == memcmp(expected.ptr(), result.ptr(), bytes);
+         good = good && same;
+         Printf( Verbatim("%s (%s): %ld ms%s\n")
+            .Format( conversion.name, ConversionKernelsName(kernels), elapsed,
+               same ? wxString{} : wxString{ wxT(", RESULTS DIFFER") } ) );
+      }
+   }
+   FlushPrint();
+   return good;
+}
+
 void BenchmarkDialog::OnRun( wxCommandEvent & WXUNUSED(event))
 {
    TransferDataFromWindow();
@@ -579,6 +661,11 @@ void BenchmarkDialog::OnRun( wxCommandEvent & WXUNUSED(event))
    Printf( XO("At 44100 Hz, %d bytes per sample, the estimated number of\n simultaneous tracks that could be played at once: %.1f\n" )
       .Format( SAMPLE_SIZE(SampleFormat), (nChunks*chunkSize/44100.0)/(elapsed/1000.0) ) );
 
+   // The conversions hold several buffers at once, so bound their size
+   if (!BenchmarkConversions(
+      std::min<uint64_t>(nChunks * chunkSize, 1 << 24), randSeed))
+      goto fail;
+
    goto success;
 
  fail:
@@ -21,6 +21,7 @@ Paul Licameli -- split from ProjectFileIO.cpp
 #include <lib-files/FileNames.h>
 #include <lib-files/TenacityLogger.h>
 #include <lib-files/wxFileNameWrapper.h>
+#include <lib-preferences/Prefs.h>
 #include <lib-strings/Internat.h>
 
 #include "Project.h"
@@ -40,6 +41,10 @@ static const char *FastConfig =
    "PRAGMA <schema>.synchronous = OFF;"
    "PRAGMA <schema>.journal_mode = OFF;";
 
+// Megabytes of the database file for sqlite to read through memory mapped
+// i/o instead of through its own page cache; zero disables mapping
+static IntSetting DatabaseMmapSize{ L"/Performance/DatabaseMmapSize", 0 };
+
 DBConnection::DBConnection(
    const std::weak_ptr<TenacityProject> &pProject,
    const std::shared_ptr<DBConnectionErrors> &pErrors,
@@ -337,8 +342,16 @@ int DBConnection::ModeConfig(sqlite3 *db, const char *schema, const char *config
    // Ensure attached DB connection gets configured
    int rc;
 
-   // Replace all schema "keywords" with the schema name
    wxString sql = config;
+
+   // Optionally map the file, so that reading blobs of samples copies
+   // directly out of the mapped pages
+   const auto mmapSize = DatabaseMmapSize.Read();
+   if (mmapSize > 0)
+      sql += wxString::Format(wxT("PRAGMA <schema>.mmap_size = %lld;"),
+         mmapSize * 1024LL * 1024LL);
+
+   // Replace all schema "keywords" with the schema name
    sql.Replace(wxT("<schema>"), schema);
 
    // Set the configuration
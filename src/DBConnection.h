@@ -73,6 +73,7 @@ public:
    enum StatementID
    {
       GetSamples,
+      GetSamplesBatch,
       GetSummary256,
       GetSummary64k,
       LoadSampleBlock,
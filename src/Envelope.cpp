@@ -30,6 +30,7 @@ a draggable point type.
 #include "Envelope.h"
 
 
+#include <algorithm>
 #include <cmath>
 
 #include <wx/wxcrtvararg.h>
@@ -266,6 +267,22 @@ Envelope::Envelope(const Envelope &orig)
    CopyRange(orig, 0, orig.GetNumberOfPoints());
 }
 
+bool Envelope::SameContents(const Envelope &other) const
+{
+   if (mDB != other.mDB ||
+       mMinValue != other.mMinValue ||
+       mMaxValue != other.mMaxValue ||
+       mDefaultValue != other.mDefaultValue ||
+       mOffset != other.mOffset ||
+       mTrackLen != other.mTrackLen ||
+       mEnv.size() != other.mEnv.size())
+      return false;
+
+   return std::equal(mEnv.begin(), mEnv.end(), other.mEnv.begin(),
+      [](const EnvPoint &a, const EnvPoint &b){
+         return a.GetT() == b.GetT() && a.GetVal() == b.GetVal(); });
+}
+
 void Envelope::CopyRange(const Envelope &orig, size_t begin, size_t end)
 {
    size_t len = orig.mEnv.size();
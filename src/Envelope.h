@@ -77,6 +77,9 @@ public:
 
    Envelope(const Envelope &orig);
 
+   //! Whether a copy of this envelope would equal other
+   bool SameContents(const Envelope &other) const;
+
    // Create from a subrange of another envelope.
    Envelope(const Envelope &orig, double t0, double t1);
 
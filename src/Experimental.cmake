@@ -50,6 +50,10 @@ set( EXPERIMENTAL_OPTIONS_LIST
    # feature to link audio tracks to a label track
    SYNC_LOCK
 
+   # Count heap allocations and waits for locks in the audio callback,
+   # and report them in the debug log when the stream stops
+   #REALTIME_CHECKS
+
    # DA: Enables dark audacity theme and customisations.
    # GP: This option might be dropped in the future. We might take some
    # customizations from DarkAudacity, however.
@@ -127,7 +127,13 @@ wxString sf_normalize_name(const char *name);
 
 // This function wrapper uses a mutex to serialize calls to the SndFile library.
 // PRL: Keeping this in a comment, but with Unitary, the only remaining uses
-// of libsndfile should be in import/export and so are on the main thread only
+// of libsndfile should be in import/export.
+// Importer::ImportConcurrently() and ExportMultipleDialog run those on
+// TaskScheduler workers, but libsndfile needs no lock so long as each SNDFILE
+// is used by one thread at a time:  an export task opens, writes and closes its
+// own file, and an import job takes over its handle only after the main thread
+// has probed it.  Calls that take no SNDFILE, like sf_error(NULL), report
+// through state shared by all threads; keep those on the main thread.
 //extern std::mutex libSndFileMutex;
 
 template<typename R, typename F, typename... Args>
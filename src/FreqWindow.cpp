@@ -655,11 +655,16 @@ bool FrequencyPlotDialog::Show(bool show)
    return res;
 }
 
+//! Most samples to analyze, as the whole selection is held in memory
+static IntSetting FrequencyPlotMaxSamples{
+   L"/Performance/FrequencyPlotMaxSamples", 64 * 1048576 };
+
 void FrequencyPlotDialog::GetAudio()
 {
    mData.reset();
    mDataLen = 0;
 
+   const auto maxLen = sampleCount{ std::max(1, FrequencyPlotMaxSamples.Read()) };
    int selcount = 0;
    bool warning = false;
    for (auto track : TrackList::Get( *mProject ).Selected< const WaveTrack >()) {
@@ -669,12 +674,12 @@ void FrequencyPlotDialog::GetAudio()
          auto start = track->TimeToLongSamples(selectedRegion.t0());
          auto end = track->TimeToLongSamples(selectedRegion.t1());
          auto dataLen = end - start;
-         if (dataLen > 10485760) {
+         if (dataLen > maxLen) {
             warning = true;
-            mDataLen = 10485760;
+            mDataLen = maxLen.as_size_t();
          }
          else
-            // dataLen is not more than 10 * 2 ^ 20
+            // dataLen is not more than maxLen
             mDataLen = dataLen.as_size_t();
          mData = Floats{ mDataLen };
          // Don't allow throw for bad reads
@@ -691,12 +696,17 @@ void FrequencyPlotDialog::GetAudio()
             return;
          }
          auto start = track->TimeToLongSamples(selectedRegion.t0());
-         Floats buffer2{ mDataLen };
-         // Again, stop exceptions
-         track->GetFloats(buffer2.get(), start, mDataLen,
-                    fillZero, false);
-         for (size_t i = 0; i < mDataLen; i++)
-            mData[i] += buffer2[i];
+         // Add a block at a time, not to hold the selection twice
+         const auto bufferLen = std::min(mDataLen, track->GetMaxBlockSize());
+         Floats buffer2{ bufferLen };
+         for (size_t done = 0; done < mDataLen; done += bufferLen) {
+            const auto len = std::min(bufferLen, mDataLen - done);
+            // Again, stop exceptions
+            track->GetFloats(buffer2.get(), start + done, len,
+                       fillZero, false);
+            for (size_t i = 0; i < len; i++)
+               mData[done + i] += buffer2[i];
+         }
       }
       selcount++;
    }
@@ -34,6 +34,7 @@
 #include <lib-math/float_cast.h>
 #include <lib-math/Resample.h>
 #include <lib-preferences/Prefs.h>
+#include <lib-utility/TaskScheduler.h>
 
 #include "Envelope.h"
 #include "WaveTrack.h"
@@ -152,6 +153,7 @@ void MixAndRender(TrackList *tracks, WaveTrackFactory *trackFactory,
       Mixer::WarpOptions{*tracks},
       startTime, endTime, mono ? 1 : 2, maxBlockLen, false,
       rate, format);
+   mixer.SetThreads(Mixer::DefaultThreads());
 
    ::wxSafeYield();
 
@@ -255,6 +257,7 @@ Mixer::Mixer(const WaveTrackConstArray &inputTracks,
 
    , mNumChannels{ numOutChannels }
    , mGains{ mNumChannels }
+   , mChannelFlags{ mNumChannels }
 
    , mFormat{ outFormat }
    , mRate{ outRate }
@@ -349,6 +352,41 @@ Mixer::~Mixer()
 {
 }
 
+static IntSetting MixerThreads{ L"/Performance/MixerThreads", 0 };
+
+unsigned Mixer::DefaultThreads()
+{
+   // Zero, the default, means the task scheduler's and the calling thread
+   const auto nThreads = MixerThreads.Read();
+   return nThreads > 0
+      ? nThreads
+      : TaskScheduler::Get().GetThreadCount() + 1;
+}
+
+void Mixer::SetThreads(unsigned nThreads)
+{
+   nThreads = std::min<size_t>(nThreads, mNumInputTracks);
+   // The time track envelope, shared by all tracks, caches search positions
+   // and is not safe to evaluate concurrently
+   if (nThreads <= 1 || mEnvelope) {
+      mGroupEnvValues.clear();
+      mTrackBuffers.reset();
+      mTrackLengths.reset();
+      return;
+   }
+
+   // Each group of tracks is fetched by one task, so at most nThreads run
+   const auto envLen = std::max(mQueueMaxLen, mInterleavedBufferSize);
+   mGroupEnvValues.clear();
+   for (unsigned ii = 0; ii < nThreads; ++ii)
+      mGroupEnvValues.emplace_back(envLen);
+   mTrackLengths.reinit(mNumInputTracks);
+   mTrackBuffers.reinit(mNumInputTracks);
+   for (size_t i = 0; i < mNumInputTracks; i++)
+      // PRL:  Bug2536: see other comments below
+      mTrackBuffers[i].reinit(mInterleavedBufferSize + 1);
+}
+
 void Mixer::MakeResamplers()
 {
    for (size_t i = 0; i < mNumInputTracks; i++)
@@ -409,10 +447,11 @@ double ComputeWarpFactor(const Envelope &env, double t0, double t1)
 
 }
 
-size_t Mixer::MixVariableRates(int *channelFlags, WaveTrackCache &cache,
+size_t Mixer::MixVariableRates(WaveTrackCache &cache,
                                     sampleCount *pos, float *queue,
                                     int *queueStart, int *queueLen,
-                                    Resample * pResample)
+                                    Resample * pResample,
+                                    float *floatBuffer, double *envValues)
 {
    const WaveTrack *const track = cache.GetTrack().get();
    const double trackRate = track->GetRate();
@@ -466,7 +505,7 @@ size_t Mixer::MixVariableRates(int *channelFlags, WaveTrackCache &cache,
                else
                   memset(&queue[*queueLen], 0, sizeof(float) * getLen);
 
-               track->GetEnvelopeValues(mEnvValues.get(),
+               track->GetEnvelopeValues(envValues,
                                         getLen,
                                         (*pos - (getLen- 1)).as_double() / trackRate);
                *pos -= getLen;
@@ -478,7 +517,7 @@ size_t Mixer::MixVariableRates(int *channelFlags, WaveTrackCache &cache,
                else
                   memset(&queue[*queueLen], 0, sizeof(float) * getLen);
 
-               track->GetEnvelopeValues(mEnvValues.get(),
+               track->GetEnvelopeValues(envValues,
                                         getLen,
                                         (*pos).as_double() / trackRate);
 
@@ -486,7 +525,7 @@ size_t Mixer::MixVariableRates(int *channelFlags, WaveTrackCache &cache,
             }
 
             for (decltype(getLen) i = 0; i < getLen; i++) {
-               queue[(*queueLen) + i] *= mEnvValues[i];
+               queue[(*queueLen) + i] *= envValues[i];
             }
 
             if (backwards)
@@ -526,11 +565,11 @@ size_t Mixer::MixVariableRates(int *channelFlags, WaveTrackCache &cache,
          // PRL:  Bug2536: crash in soxr happened on Mac, sometimes, when
          // mMaxOut - out == 1 and &mFloatBuffer[out + 1] was an unmapped
          // address, because soxr, strangely, fetched an 8-byte (misaligned!)
-         // value from &mFloatBuffer[out], but did nothing with it anyway,
+         // value from &floatBuffer[out], but did nothing with it anyway,
          // in soxr_output_no_callback.
          // Now we make the bug go away by allocating a little more space in
          // the buffer than we need.
-         &mFloatBuffer[out],
+         &floatBuffer[out],
          mMaxOut - out);
 
       const auto input_used = results.first;
@@ -544,28 +583,11 @@ size_t Mixer::MixVariableRates(int *channelFlags, WaveTrackCache &cache,
       }
    }
 
-   for (size_t c = 0; c < mNumChannels; c++) {
-      if (mApplyTrackGains) {
-         mGains[c] = track->GetChannelGain(c);
-      }
-      else {
-         mGains[c] = 1.0;
-      }
-   }
-
-   MixBuffers(mNumChannels,
-              channelFlags,
-              mGains.get(),
-              mFloatBuffer.get(),
-              mTemp.get(),
-              out,
-              mInterleaved);
-
    return out;
 }
 
-size_t Mixer::MixSameRate(int *channelFlags, WaveTrackCache &cache,
-                               sampleCount *pos)
+size_t Mixer::MixSameRate(WaveTrackCache &cache, sampleCount *pos,
+                          float *floatBuffer, double *envValues)
 {
    const WaveTrack *const track = cache.GetTrack().get();
    const double t = ( *pos ).as_double() / track->GetRate();
@@ -591,39 +613,92 @@ size_t Mixer::MixSameRate(int *channelFlags, WaveTrackCache &cache,
    if (backwards) {
       auto results = cache.GetFloats(*pos - (slen - 1), slen, mMayThrow);
       if (results)
-         memcpy(mFloatBuffer.get(), results, sizeof(float) * slen);
+         memcpy(floatBuffer, results, sizeof(float) * slen);
       else
-         memset(mFloatBuffer.get(), 0, sizeof(float) * slen);
-      track->GetEnvelopeValues(mEnvValues.get(), slen, t - (slen - 1) / mRate);
+         memset(floatBuffer, 0, sizeof(float) * slen);
+      track->GetEnvelopeValues(envValues, slen, t - (slen - 1) / mRate);
       for(decltype(slen) i = 0; i < slen; i++)
-         mFloatBuffer[i] *= mEnvValues[i]; // Track gain control will go here?
-      ReverseSamples((samplePtr)mFloatBuffer.get(), floatSample, 0, slen);
+         floatBuffer[i] *= envValues[i]; // Track gain control will go here?
+      ReverseSamples((samplePtr)floatBuffer, floatSample, 0, slen);
 
       *pos -= slen;
    }
    else {
       auto results = cache.GetFloats(*pos, slen, mMayThrow);
       if (results)
-         memcpy(mFloatBuffer.get(), results, sizeof(float) * slen);
+         memcpy(floatBuffer, results, sizeof(float) * slen);
       else
-         memset(mFloatBuffer.get(), 0, sizeof(float) * slen);
-      track->GetEnvelopeValues(mEnvValues.get(), slen, t);
+         memset(floatBuffer, 0, sizeof(float) * slen);
+      track->GetEnvelopeValues(envValues, slen, t);
       for(decltype(slen) i = 0; i < slen; i++)
-         mFloatBuffer[i] *= mEnvValues[i]; // Track gain control will go here?
+         floatBuffer[i] *= envValues[i]; // Track gain control will go here?
 
       *pos += slen;
    }
 
+   return slen;
+}
+
+size_t Mixer::MixTrack(size_t i, float *floatBuffer, double *envValues)
+{
+   const WaveTrack *const track = mInputTrack[i].GetTrack().get();
+   if (mbVariableRates || track->GetRate() != mRate)
+      return MixVariableRates(mInputTrack[i],
+         &mSamplePos[i], mSampleQueue[i].get(),
+         &mQueueStart[i], &mQueueLen[i], mResample[i].get(),
+         floatBuffer, envValues);
+   else
+      return MixSameRate(mInputTrack[i], &mSamplePos[i],
+         floatBuffer, envValues);
+}
+
+void Mixer::Accumulate(size_t i, const float *floatBuffer, size_t len)
+{
+   const WaveTrack *const track = mInputTrack[i].GetTrack().get();
+   auto &channelFlags = mChannelFlags;
+   for(size_t j=0; j<mNumChannels; j++)
+      channelFlags[j] = 0;
+
+   if( mMixerSpec ) {
+      //ignore left and right when downmixing is not required
+      for(size_t j = 0; j < mNumChannels; j++ )
+         channelFlags[ j ] = mMixerSpec->mMap[ i ][ j ] ? 1 : 0;
+   }
+   else {
+      switch(track->GetChannel()) {
+      case Track::MonoChannel:
+      default:
+         for(size_t j=0; j<mNumChannels; j++)
+            channelFlags[j] = 1;
+         break;
+      case Track::LeftChannel:
+         channelFlags[0] = 1;
+         break;
+      case Track::RightChannel:
+         if (mNumChannels >= 2)
+            channelFlags[1] = 1;
+         else
+            channelFlags[0] = 1;
+         break;
+      }
+   }
+
    for(size_t c=0; c<mNumChannels; c++)
       if (mApplyTrackGains)
          mGains[c] = track->GetChannelGain(c);
       else
          mGains[c] = 1.0;
 
-   MixBuffers(mNumChannels, channelFlags, mGains.get(),
-              mFloatBuffer.get(), mTemp.get(), slen, mInterleaved);
+   MixBuffers(mNumChannels, channelFlags.get(), mGains.get(),
+              floatBuffer, mTemp.get(), len, mInterleaved);
 
-   return slen;
+   double t = mSamplePos[i].as_double() / (double)track->GetRate();
+   if (mT0 > mT1)
+      // backwards (as possibly in scrubbing)
+      mTime = std::max(std::min(t, mTime), mT1);
+   else
+      // forwards (the usual)
+      mTime = std::min(std::max(t, mTime), mT1);
 }
 
 size_t Mixer::Process(size_t maxToProcess)
@@ -634,76 +709,55 @@ size_t Mixer::Process(size_t maxToProcess)
    //   return 0;
 
    decltype(Process(0)) maxOut = 0;
-   ArrayOf<int> channelFlags{ mNumChannels };
 
    mMaxOut = maxToProcess;
 
    Clear();
-   for(size_t i=0; i<mNumInputTracks; i++) {
-      const WaveTrack *const track = mInputTrack[i].GetTrack().get();
-      for(size_t j=0; j<mNumChannels; j++)
-         channelFlags[j] = 0;
-
-      if( mMixerSpec ) {
-         //ignore left and right when downmixing is not required
-         for(size_t j = 0; j < mNumChannels; j++ )
-            channelFlags[ j ] = mMixerSpec->mMap[ i ][ j ] ? 1 : 0;
+   if (!mGroupEnvValues.empty()) {
+      // Tracks are independent until summed, so fetch them concurrently,
+      // each task taking every nth track
+      const size_t nGroups = mGroupEnvValues.size();
+      TaskGroup{}.ParallelFor(nGroups, [this, nGroups](size_t group){
+         const auto envValues = mGroupEnvValues[group].get();
+         for (size_t i = group; i < mNumInputTracks; i += nGroups)
+            mTrackLengths[i] =
+               MixTrack(i, mTrackBuffers[i].get(), envValues);
+      });
+      // Sum in the same order as the serial case, for identical results
+      for(size_t i=0; i<mNumInputTracks; i++) {
+         maxOut = std::max(maxOut, mTrackLengths[i]);
+         Accumulate(i, mTrackBuffers[i].get(), mTrackLengths[i]);
       }
-      else {
-         switch(track->GetChannel()) {
-         case Track::MonoChannel:
-         default:
-            for(size_t j=0; j<mNumChannels; j++)
-               channelFlags[j] = 1;
-            break;
-         case Track::LeftChannel:
-            channelFlags[0] = 1;
-            break;
-         case Track::RightChannel:
-            if (mNumChannels >= 2)
-               channelFlags[1] = 1;
-            else
-               channelFlags[0] = 1;
-            break;
-         }
+   }
+   else {
+      for(size_t i=0; i<mNumInputTracks; i++) {
+         const auto len = MixTrack(i, mFloatBuffer.get(), mEnvValues.get());
+         maxOut = std::max(maxOut, len);
+         Accumulate(i, mFloatBuffer.get(), len);
       }
-      if (mbVariableRates || track->GetRate() != mRate)
-         maxOut = std::max(maxOut,
-            MixVariableRates(channelFlags.get(), mInputTrack[i],
-               &mSamplePos[i], mSampleQueue[i].get(),
-               &mQueueStart[i], &mQueueLen[i], mResample[i].get()));
-      else
-         maxOut = std::max(maxOut,
-            MixSameRate(channelFlags.get(), mInputTrack[i], &mSamplePos[i]));
-
-      double t = mSamplePos[i].as_double() / (double)track->GetRate();
-      if (mT0 > mT1)
-         // backwards (as possibly in scrubbing)
-         mTime = std::max(std::min(t, mTime), mT1);
-      else
-         // forwards (the usual)
-         mTime = std::min(std::max(t, mTime), mT1);
    }
    if(mInterleaved) {
       for(size_t c=0; c<mNumChannels; c++) {
-         CopySamples((constSamplePtr)(mTemp[0].get() + c),
+         mDither.Apply(
+            mHighQuality ? gHighQualityDither : gLowQualityDither,
+            (constSamplePtr)(mTemp[0].get() + c),
             floatSample,
             mBuffer[0].ptr() + (c * SAMPLE_SIZE(mFormat)),
             mFormat,
             maxOut,
-            mHighQuality ? gHighQualityDither : gLowQualityDither,
             mNumChannels,
             mNumChannels);
       }
    }
    else {
       for(size_t c=0; c<mNumBuffers; c++) {
-         CopySamples((constSamplePtr)mTemp[c].get(),
+         mDither.Apply(
+            mHighQuality ? gHighQualityDither : gLowQualityDither,
+            (constSamplePtr)mTemp[c].get(),
             floatSample,
             mBuffer[c].ptr(),
             mFormat,
-            maxOut,
-            mHighQuality ? gHighQualityDither : gLowQualityDither);
+            maxOut);
       }
    }
    // MB: this doesn't take warping into account, replaced with code based on mSamplePos
@@ -727,6 +781,12 @@ double Mixer::MixGetCurrentTime()
    return mTime;
 }
 
+void Mixer::SetReadAhead(size_t depth)
+{
+   for (size_t i = 0; i < mNumInputTracks; i++)
+      mInputTrack[i].SetReadAhead(depth);
+}
+
 void Mixer::Restart()
 {
    mTime = mT0;
@@ -21,6 +21,7 @@
 #define __AUDACITY_MIX__
 
 // Tenacity libraries
+#include <lib-math/Dither.h>
 #include <lib-math/SampleFormat.h>
 
 #include <vector>
@@ -143,16 +144,34 @@ class TENACITY_DLL_API Mixer {
    /// Retrieve one of the non-interleaved buffers
    constSamplePtr GetBuffer(int channel);
 
- private:
+   /// Read ahead up to depth blocks of each input track in background
+   /// threads; zero disables.  See WaveTrackCache::SetReadAhead.
+   void SetReadAhead(size_t depth);
+
+   /// Fetch, resample and apply envelopes of the input tracks on up to
+   /// nThreads threads.  Tracks are still summed in order on the calling
+   /// thread, so the output is the same as with one thread, the default.
+   void SetThreads(unsigned nThreads);
+
+   /// Number of threads for mixing that is not in real time, from preferences
+   static unsigned DefaultThreads();
 
+ private:
    void Clear();
-   size_t MixSameRate(int *channelFlags, WaveTrackCache &cache,
-                           sampleCount *pos);
+   //! Fetch one input track into floatBuffer, at the output rate
+   //! @return number of samples fetched
+   size_t MixTrack(size_t i, float *floatBuffer, double *envValues);
+   //! Add the fetched samples of one track into mTemp
+   void Accumulate(size_t i, const float *floatBuffer, size_t len);
+
+   size_t MixSameRate(WaveTrackCache &cache, sampleCount *pos,
+                      float *floatBuffer, double *envValues);
 
-   size_t MixVariableRates(int *channelFlags, WaveTrackCache &cache,
+   size_t MixVariableRates(WaveTrackCache &cache,
                                 sampleCount *pos, float *queue,
                                 int *queueStart, int *queueLen,
-                                Resample * pResample);
+                                Resample * pResample,
+                                float *floatBuffer, double *envValues);
 
    void MakeResamplers();
 
@@ -181,6 +200,8 @@ class TENACITY_DLL_API Mixer {
    size_t              mMaxOut;
    const unsigned   mNumChannels;
    Floats           mGains;
+   //! Which output channels the track being accumulated goes to
+   ArrayOf<int>     mChannelFlags;
    unsigned         mNumBuffers;
    size_t              mBufferSize;
    size_t              mInterleavedBufferSize;
@@ -193,8 +214,17 @@ class TENACITY_DLL_API Mixer {
    double           mSpeed;
    bool             mHighQuality;
    std::vector<double> mMinFactor, mMaxFactor;
+   //! Own state for conversion of the output, so that mixers in different
+   //! threads do not share the global one
+   Dither           mDither;
 
    const bool       mMayThrow;
+
+   // Parallel mixing
+   //! Envelope values for each group of tracks fetched by one task
+   std::vector<Doubles> mGroupEnvValues;
+   ArrayOf<Floats>  mTrackBuffers;
+   ArrayOf<size_t>  mTrackLengths;
 };
 
 #endif
@@ -210,6 +210,10 @@ ModuleManager::ModuleManager()
 
 ModuleManager::~ModuleManager()
 {
+   for (const auto &id : mKeptProviders)
+      if (auto iter = mDynModules.find(id); iter != mDynModules.end())
+         // Leak it
+         iter->second.release();
    mDynModules.clear();
    builtinModuleList().clear();
 }
@@ -551,3 +555,8 @@ bool ModuleManager::IsPluginValid(const PluginID & providerID,
 
    return mDynModules[providerID]->IsPluginValid(path, bFast);
 }
+
+void ModuleManager::KeepProvider(const PluginID & providerID)
+{
+   mKeptProviders.insert(providerID);
+}
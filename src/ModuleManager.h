@@ -21,6 +21,7 @@
 
 #include <functional>
 #include <map>
+#include <set>
 #include <vector>
 
 class wxArrayString;
@@ -114,6 +115,10 @@ public:
    bool IsProviderValid(const PluginID & provider, const PluginPath & path);
    bool IsPluginValid(const PluginID & provider, const PluginPath & path, bool bFast);
 
+   //! Never terminate nor destroy the provider, because a thread that cannot
+   //! be stopped may still be in it at exit
+   void KeepProvider(const PluginID & provider);
+
 private:
    // I'm a singleton class
    ModuleManager();
@@ -132,6 +137,8 @@ private:
    // number of Plug-Ins identified by "paths", and are also factories of
    // ComponentInterface objects for each path:
    ModuleMap mDynModules;
+   //! Providers that KeepProvider() says not to destroy
+   std::set<PluginID> mKeptProviders;
 
    // Other libraries that receive notifications of events described by
    // ModuleDispatchTypes:
@@ -23,6 +23,13 @@ for shared and private configs - which need to move out.
 
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_set>
 
 #include <wx/log.h>
 #include <wx/tokenzr.h>
@@ -31,6 +38,7 @@ for shared and private configs - which need to move out.
 
 // Tenacity libraries
 #include <lib-files/FileNames.h>
+#include <lib-preferences/Prefs.h>
 #include <lib-strings/Internat.h>
 #include <lib-utility/MemoryX.h>
 
@@ -591,11 +599,22 @@ PluginManager & PluginManager::Get()
 
 void PluginManager::Initialize()
 {
+   // Time each stage, for the log
+   auto lap = std::chrono::steady_clock::now();
+   const auto elapsed = [&]{
+      const auto now = std::chrono::steady_clock::now();
+      const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+         now - lap).count();
+      lap = now;
+      return static_cast<long>(ms);
+   };
+
    // Always load the registry first
    Load();
 
    // And force load of setting to verify it's accessible
    GetSettings();
+   const auto loadTime = elapsed();
 
    auto &mm = ModuleManager::Get();
    mm.DiscoverProviders();
@@ -604,6 +623,7 @@ void PluginManager::Initialize()
       // Allow the module to auto-register children
       module->AutoRegisterPlugins(*this);
    }
+   const auto registerTime = elapsed();
 
    // And finally check for updates
 #ifndef EXPERIMENTAL_EFFECT_MANAGEMENT
@@ -612,10 +632,18 @@ void PluginManager::Initialize()
    const bool kFast = true;
    CheckForUpdates( kFast );
 #endif
+   const auto checkTime = elapsed();
+
+   wxLogMessage(wxT("Plugin startup: registry %ld ms, providers %ld ms, checks %ld ms"),
+      loadTime, registerTime, checkTime);
 }
 
 void PluginManager::Terminate()
 {
+   StopScans();
+
+   StopScans();
+
    // Get rid of all non-module plugins first
    PluginMap::iterator iter = mPlugins.begin();
    while (iter != mPlugins.end())
@@ -1211,16 +1239,175 @@ void PluginManager::SaveGroup(FileConfig *pRegistry, PluginType type)
 // If bFast is true, do not do a full check.  Just check the ones
 // that are quick to check.  Currently (Feb 2017) just Nyquist
 // and built-ins.
+namespace {
+
+//! Seconds to wait for one plugin check before giving up on it; zero waits
+//! as long as it takes
+IntSetting PluginCheckTimeout{ L"/Performance/PluginCheckTimeout", 10 };
+
+using Clock = std::chrono::steady_clock;
+
+//! Wakes PluginManager when the scans of one CheckForUpdates() progress
+struct ScanSignal
+{
+   std::mutex mutex;
+   std::condition_variable changed;
+};
+
+//! The checks of the plugins of one provider, then its search for new ones
+/*!
+ A thread does them in order, because providers need not be thread-safe, but
+ the threads of different providers run concurrently.  The thread shares this
+ with PluginManager::CheckForUpdates(), which may stop waiting for it.
+ */
+struct ProviderScan
+{
+   struct Check {
+      PluginID ID;
+      PluginPath path;
+      bool valid{ false };
+   };
+
+   explicit ProviderScan(std::shared_ptr<ScanSignal> pSignal)
+      : mpSignal{ std::move(pSignal) }
+   {}
+
+   //! Start the thread, which holds pScan until it returns
+   static void Start(const std::shared_ptr<ProviderScan> &pScan,
+      PluginManagerInterface &pm, bool bFast)
+   {
+      // Ignore exceptions, because no one may be waiting for them
+      pScan->thread = std::thread([pScan, &pm, bFast]{
+         try {
+            pScan->Run(pm, bFast);
+         }
+         catch (...) {
+         }
+         pScan->Notify([&]{ pScan->mReturned = true; });
+      });
+   }
+
+   //! Stop after the step in progress, whose results no one will use
+   void Abandon() { mAbandoned = true; }
+
+   //! How many steps are done: checks, then the search
+   size_t Done() const { return mDone; }
+   size_t Steps() const { return checks.size() + 1; }
+   bool Finished() const { return Done() == Steps(); }
+   //! Whether the thread is out of the provider for good, and may be joined
+   bool Returned() const { return mReturned; }
+
+   //! When the step in progress times out, if it has begun and timeout is
+   //! not zero
+   std::optional<Clock::time_point> Deadline(Clock::duration timeout) const
+   {
+      const Clock::rep since = mSince;
+      if (timeout <= Clock::duration::zero() || since == 0)
+         return {};
+      return Clock::time_point{ Clock::duration{ since } } + timeout;
+   }
+
+   //! Whether the step in progress has taken longer than timeout
+   /*! A scan still queued behind others is not overdue */
+   bool Overdue(Clock::duration timeout) const
+   {
+      const auto deadline = Deadline(timeout);
+      return deadline && Clock::now() >= *deadline;
+   }
+
+   ScanSignal &Signal() const { return *mpSignal; }
+
+   ModuleInterface *pProvider{};
+   bool findPaths{ false };
+   std::vector<Check> checks;
+   PluginPaths paths;
+   //! Only the main thread joins or detaches it
+   std::thread thread;
+
+private:
+   void Run(PluginManagerInterface &pm, bool bFast)
+   {
+      const auto begin = [this]{
+         Notify([this]{
+            mSince = Clock::now().time_since_epoch().count(); });
+      };
+      const auto end = [this]{ Notify([this]{ ++mDone; }); };
+      for (auto &check : checks) {
+         // Once abandoned, leave the provider to the main thread
+         if (mAbandoned)
+            return;
+         begin();
+         check.valid =
+            pProvider && pProvider->IsPluginValid(check.path, bFast);
+         end();
+      }
+      if (mAbandoned)
+         return;
+      if (findPaths && pProvider) {
+         begin();
+         paths = pProvider->FindPluginPaths(pm);
+      }
+      end();
+   }
+
+   //! Change the state under the lock, so that no waiter misses it
+   template<typename F> void Notify(const F &f)
+   {
+      {
+         std::lock_guard<std::mutex> lock{ mpSignal->mutex };
+         f();
+      }
+      mpSignal->changed.notify_all();
+   }
+
+   const std::shared_ptr<ScanSignal> mpSignal;
+   std::atomic<size_t> mDone{ 0 };
+   //! When the step in progress began, or zero before the first
+   std::atomic<Clock::rep> mSince{ 0 };
+   std::atomic<bool> mAbandoned{ false };
+   std::atomic<bool> mReturned{ false };
+};
+
+//! Scans that timed out, by provider, whose threads may still be in a call
+//! to the provider
+/*!
+ Later scans skip that provider until the call returns and the thread is
+ joined; the plugin that hangs is disabled.
+ */
+std::map<PluginID, std::shared_ptr<ProviderScan>> &AbandonedScans()
+{
+   static std::map<PluginID, std::shared_ptr<ProviderScan>> scans;
+   return scans;
+}
+
+//! Join the threads of abandoned scans that have returned, and report
+//! whether none is left
+bool JoinAbandonedScans()
+{
+   auto &abandoned = AbandonedScans();
+   for (auto iter = abandoned.begin(); iter != abandoned.end();) {
+      if (iter->second->Returned()) {
+         iter->second->thread.join();
+         iter = abandoned.erase(iter);
+      }
+      else
+         ++iter;
+   }
+   return abandoned.empty();
+}
+
+}
+
 void PluginManager::CheckForUpdates(bool bFast)
 {
    ModuleManager & mm = ModuleManager::Get();
-   wxArrayString pathIndex;
+   std::unordered_set<wxString> pathIndex;
    for (auto &pair : mPlugins) {
       auto &plug = pair.second;
 
       // Bypass 2.1.0 placeholders...remove this after a few releases past 2.1.0
       if (plug.GetPluginType() != PluginTypeNone)
-         pathIndex.push_back(plug.GetPath().BeforeFirst(wxT(';')));
+         pathIndex.insert(plug.GetPath().BeforeFirst(wxT(';')));
    }
 
    // Check all known plugins to ensure they are still valid and scan for NEW ones.
@@ -1234,6 +1421,22 @@ void PluginManager::CheckForUpdates(bool bFast)
    //
    // When the user enables the plugin, each provider that reported it will be asked
    // to register the plugin.
+   JoinAbandonedScans();
+   auto &abandoned = AbandonedScans();
+   for (const auto &pair : abandoned)
+      wxLogWarning(wxT("Not checking plugins of %s, an earlier check of which has not returned"),
+         pair.first);
+
+   const auto pSignal = std::make_shared<ScanSignal>();
+   std::map<PluginID, std::shared_ptr<ProviderScan>> scans;
+   const auto getScan = [&](const PluginID &providerID) -> ProviderScan & {
+      auto &pScan = scans[providerID];
+      if (!pScan) {
+         pScan = std::make_shared<ProviderScan>(pSignal);
+         pScan->pProvider = mm.CreateProviderInstance(providerID, wxEmptyString);
+      }
+      return *pScan;
+   };
    for (auto &pair : mPlugins) {
       auto &plug = pair.second;
       const PluginID & plugID = plug.GetID();
@@ -1246,6 +1449,13 @@ void PluginManager::CheckForUpdates(bool bFast)
          continue;
       }
 
+      // Leave the plugins of a busy provider as they were
+      if (abandoned.count(
+         plugType == PluginTypeModule ? plugID : plug.GetProviderID()))
+      {
+         continue;
+      }
+
       if ( plugType == PluginTypeModule  )
       {
          if( bFast ) 
@@ -1257,44 +1467,157 @@ void PluginManager::CheckForUpdates(bool bFast)
             plug.SetEnabled(false);
             plug.SetValid(false);
          }
-         else
+         else if (mm.CreateProviderInstance(plugID, plugPath))
          {
             // Collect plugin paths
-            PluginPaths paths;
-            if (auto provider = mm.CreateProviderInstance( plugID, plugPath ) )
-               paths = provider->FindPluginPaths( *this );
-            for (size_t i = 0, cnt = paths.size(); i < cnt; i++)
-            {
-               wxString path = paths[i].BeforeFirst(wxT(';'));;
-               if ( ! make_iterator_range( pathIndex ).contains( path ) )
-               {
-                  PluginID ID = plugID + wxT("_") + path;
-                  PluginDescriptor & plug2 = mPlugins[ID];  // This will create a NEW descriptor
-                  plug2.SetPluginType(PluginTypeStub);
-                  plug2.SetID(ID);
-                  plug2.SetProviderID(plugID);
-                  plug2.SetPath(path);
-                  plug2.SetEnabled(false);
-                  plug2.SetValid(false);
-               }
-            }
+            getScan(plugID).findPaths = true;
          }
       }
       else if (plugType != PluginTypeNone && plugType != PluginTypeStub)
       {
-         plug.SetValid(mm.IsPluginValid(plug.GetProviderID(), plugPath, bFast));
+         getScan(plug.GetProviderID()).checks.push_back({ plugID, plugPath });
+      }
+   }
+
+   // Make sure that lazily computed paths are ready before the tasks use them
+   FileNames::PlugInDir();
+   PlatformCompatibility::GetExecutablePath();
+
+   // A plugin that never returns must not hold a worker of the
+   // TaskScheduler, which could then never stop; so each provider gets a
+   // thread of its own, which this function may leave to StopScans() to join
+   for (auto &pair : scans)
+      ProviderScan::Start(pair.second, *this, bFast);
+
+   // Wait for each provider until it finishes or one step takes too long
+   const Clock::duration timeout =
+      std::chrono::seconds{ std::max(0, PluginCheckTimeout.Read()) };
+   std::vector<std::shared_ptr<ProviderScan>> pending;
+   for (auto &pair : scans)
+      pending.push_back(pair.second);
+   {
+      std::unique_lock<std::mutex> lock{ pSignal->mutex };
+      while (true) {
+         pending.erase(std::remove_if(pending.begin(), pending.end(),
+            [&](const auto &pScan){
+               return pScan->Finished() || pScan->Overdue(timeout); }),
+            pending.end());
+         if (pending.empty())
+            break;
+         std::optional<Clock::time_point> deadline;
+         for (const auto &pScan : pending)
+            if (const auto next = pScan->Deadline(timeout))
+               deadline = deadline ? std::min(*deadline, *next) : *next;
+         if (deadline)
+            pSignal->changed.wait_until(lock, *deadline);
+         else
+            pSignal->changed.wait(lock);
+      }
+   }
+
+   size_t nChecked = 0, nTimedOut = 0, nFound = 0;
+   for (auto &[providerID, pScan] : scans) {
+      const auto done = pScan->Done();
+      const auto &checks = pScan->checks;
+      for (size_t ii = 0, nn = std::min(done, checks.size()); ii < nn; ++ii) {
+         const auto &check = checks[ii];
+         auto &plug = mPlugins[check.ID];
+         plug.SetValid(check.valid);
          if (!plug.IsValid())
          {
             plug.SetEnabled(false);
          }
+         ++nChecked;
+      }
+
+      if (pScan->Finished())
+         // The thread has nothing left to do but return
+         pScan->thread.join();
+      else {
+         // Its thread may still be in the provider, which must not be used
+         // meanwhile
+         pScan->Abandon();
+         abandoned[providerID] = pScan;
+      }
+
+      if (done < checks.size()) {
+         // Disable the plugin that hangs; leave the rest as they were
+         const auto &check = checks[done];
+         wxLogWarning(wxT("Checking plugin %s timed out"), check.path);
+         auto &plug = mPlugins[check.ID];
+         plug.SetValid(false);
+         plug.SetEnabled(false);
+         ++nTimedOut;
+         continue;
+      }
+
+      if (!pScan->Finished()) {
+         wxLogWarning(wxT("Searching for plugins of %s timed out"), providerID);
+         ++nTimedOut;
+         continue;
+      }
+
+      for (const auto &foundPath : pScan->paths)
+      {
+         wxString path = foundPath.BeforeFirst(wxT(';'));
+         if ( ! pathIndex.count( path ) )
+         {
+            PluginID ID = providerID + wxT("_") + path;
+            PluginDescriptor & plug2 = mPlugins[ID];  // This will create a NEW descriptor
+            plug2.SetPluginType(PluginTypeStub);
+            plug2.SetID(ID);
+            plug2.SetProviderID(providerID);
+            plug2.SetPath(path);
+            plug2.SetEnabled(false);
+            plug2.SetValid(false);
+            ++nFound;
+         }
       }
    }
 
+   wxLogMessage(wxT("Checked %d plugins and found %d new; %d checks timed out"),
+      (int)nChecked, (int)nFound, (int)nTimedOut);
+
    Save();
 
    return;
 }
 
+void PluginManager::StopScans()
+{
+   auto &abandoned = AbandonedScans();
+   if (JoinAbandonedScans())
+      return;
+
+   // Give the checks that hang one more timeout to return
+   const Clock::duration timeout =
+      std::chrono::seconds{ std::max(0, PluginCheckTimeout.Read()) };
+   const auto deadline = Clock::now() + timeout;
+   for (const auto &[providerID, pScan] : abandoned) {
+      auto &signal = pScan->Signal();
+      std::unique_lock<std::mutex> lock{ signal.mutex };
+      const auto returned = [&]{ return pScan->Returned(); };
+      if (timeout > Clock::duration::zero())
+         signal.changed.wait_until(lock, deadline, returned);
+      else
+         signal.changed.wait(lock, returned);
+   }
+   if (JoinAbandonedScans())
+      return;
+
+   // Nothing can stop a call that never returns.  Exit must not wait for it,
+   // nor destroy the provider under it; the thread holds its scan, and the
+   // end of the process stops it.
+   auto &mm = ModuleManager::Get();
+   for (auto &[providerID, pScan] : abandoned) {
+      wxLogWarning(wxT("Leaving a check of plugins of %s that has not returned"),
+         providerID);
+      mm.KeepProvider(providerID);
+      pScan->thread.detach();
+   }
+   abandoned.clear();
+}
+
 // Here solely for the purpose of Nyquist Workbench until
 // a better solution is devised.
 const PluginID & PluginManager::RegisterPlugin(
@@ -293,6 +293,9 @@ private:
    void LoadGroup(FileConfig *pRegistry, PluginType type);
    void SaveGroup(FileConfig *pRegistry, PluginType type);
 
+   //! Join plugin checks that timed out, or keep their providers for good
+   void StopScans();
+
    PluginDescriptor & CreatePlugin(const PluginID & id, ComponentInterface *ident, PluginType type);
 
    FileConfig *GetSettings();
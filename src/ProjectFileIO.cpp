@@ -10,7 +10,8 @@ Paul Licameli split from TenacityProject.cpp
 
 #include "ProjectFileIO.h"
 
-#include <atomic>
+#include <algorithm>
+#include <map>
 #include <sqlite3.h>
 #include <optional>
 #include <cstring>
@@ -27,6 +28,7 @@ Paul Licameli split from TenacityProject.cpp
 #include <lib-project/ProjectFormatExtensionsRegistry.h>
 #include <lib-xml/XMLFileReader.h>
 #include <lib-xml/XMLStringWriter.h>
+#include <lib-utility/TaskScheduler.h>
 #include <lib-xml/XMLWriter.h>
 
 #include "ActiveProjects.h"
@@ -102,6 +104,11 @@ static const char *ProjectFileSchema =
    "PRAGMA <schema>.application_id = %d;"
    "PRAGMA <schema>.user_version = %u;"
    ""
+   // Let unused pages be released in place by "PRAGMA incremental_vacuum"
+   // rather than by copying the whole file.  This must precede the creation
+   // of tables, and has no effect on files created without it.
+   "PRAGMA <schema>.auto_vacuum = INCREMENTAL;"
+   ""
    // project is a binary representation of an XML file.
    // it's in binary for speed.
    // One instance only.  id is always 1.
@@ -124,7 +131,8 @@ static const char *ProjectFileSchema =
    // CREATE SQL autosave
    // autosave is a binary representation of an XML file.
    // it's in binary for speed.
-   // One instance only.  id is always 1.
+   // id 1 is a full snapshot.  id 2, if present, records the changes
+   // since that snapshot, as runs of new bytes and of the snapshot's bytes.
    // dict is a dictionary of fieldnames.
    // doc is the binary representation of the XML
    // in the doc, fieldnames are replaced by 2 byte dictionary
@@ -423,6 +431,167 @@ protected:
 
 constexpr std::array<const char*, 2> BufferedProjectBlobStream::Columns;
 
+class BufferedMemoryStream final : public BufferedStreamReader
+{
+public:
+   explicit BufferedMemoryStream(const std::vector<uint8_t> &data)
+       : BufferedStreamReader(32 * 1024)
+       , mData(data)
+   {
+   }
+
+protected:
+   bool HasMoreData() const override
+   {
+      return mOffset < mData.size();
+   }
+
+   size_t ReadData(void* buffer, size_t maxBytes) override
+   {
+      maxBytes = std::min(maxBytes, mData.size() - mOffset);
+      memcpy(buffer, mData.data() + mOffset, maxBytes);
+      mOffset += maxBytes;
+
+      return maxBytes;
+   }
+
+private:
+   const std::vector<uint8_t> &mData;
+   size_t mOffset { 0 };
+};
+
+// Rows of the autosave table: the last full snapshot of the project, and
+// the changes made since
+constexpr int AutoSaveSnapshotID = 1;
+constexpr int AutoSaveDeltaID = 2;
+
+// Periodically write a full snapshot, even if the changes stay small
+constexpr int AutoSaveDeltasPerSnapshot = 50;
+
+// The doc of the delta row is a sequence of records.  Each is a run of
+// serialized bytes, or the offset and length of a run of the snapshot doc,
+// as when a track did not change.  The dict of the delta row replaces that of
+// the snapshot, which it extends.
+enum AutoSaveRecord : char
+{
+   AutoSaveLiteral = 'L',
+   AutoSaveCopy = 'C',
+};
+
+static std::vector<uint8_t> SerializedBytes(const ProjectSerializer &serializer)
+{
+   const auto &data = serializer.GetData();
+
+   std::vector<uint8_t> bytes;
+   bytes.reserve(data.GetSize());
+
+   for (auto chunk : data)
+   {
+      auto begin = static_cast<const uint8_t *>(chunk.first);
+      bytes.insert(bytes.end(), begin, begin + chunk.second);
+   }
+
+   return bytes;
+}
+
+static void AppendLiteral(MemoryStream &stream, const std::vector<uint8_t> &bytes)
+{
+   const uint64_t length = bytes.size();
+   stream.AppendByte(AutoSaveLiteral);
+   stream.AppendData(&length, sizeof(length));
+   stream.AppendData(bytes.data(), bytes.size());
+}
+
+static void AppendCopy(MemoryStream &stream, uint64_t offset, uint64_t length)
+{
+   stream.AppendByte(AutoSaveCopy);
+   stream.AppendData(&offset, sizeof(offset));
+   stream.AppendData(&length, sizeof(length));
+}
+
+static bool ReadAutoSaveBlob(
+   sqlite3 *db, const char *column, int64_t rowID, std::vector<uint8_t> &bytes)
+{
+   auto blobStream =
+      SQLiteBlobStream::Open(db, "main", "autosave", column, rowID, true);
+
+   if (!blobStream)
+      return false;
+
+   bytes.clear();
+
+   while (!blobStream->IsEof())
+   {
+      uint8_t buffer[32 * 1024];
+      int bytesRead = sizeof(buffer);
+
+      if (SQLITE_OK != blobStream->Read(buffer, bytesRead))
+         return false;
+
+      bytes.insert(bytes.end(), buffer, buffer + bytesRead);
+   }
+
+   return true;
+}
+
+//! Apply the records of delta to the snapshot doc; false if delta is malformed
+static bool ApplyAutoSaveDelta(const std::vector<uint8_t> &snapshot,
+   const std::vector<uint8_t> &delta, std::vector<uint8_t> &doc)
+{
+   size_t pos = 0;
+   const auto readValue = [&](uint64_t &value)
+   {
+      if (delta.size() - pos < sizeof(value))
+         return false;
+      memcpy(&value, delta.data() + pos, sizeof(value));
+      pos += sizeof(value);
+      return true;
+   };
+
+   while (pos < delta.size())
+   {
+      uint64_t offset = 0;
+      uint64_t length = 0;
+
+      switch (delta[pos++])
+      {
+         case AutoSaveLiteral:
+            if (!readValue(length) || length > delta.size() - pos)
+               return false;
+            doc.insert(doc.end(),
+               delta.begin() + pos, delta.begin() + pos + length);
+            pos += length;
+         break;
+
+         case AutoSaveCopy:
+            if (!readValue(offset) || !readValue(length) ||
+                offset > snapshot.size() || length > snapshot.size() - offset)
+               return false;
+            doc.insert(doc.end(),
+               snapshot.begin() + offset, snapshot.begin() + offset + length);
+         break;
+
+         default:
+            return false;
+      }
+   }
+
+   return true;
+}
+
+struct ProjectFileIO::AutoSaveSnapshot
+{
+   struct Fragment
+   {
+      size_t offset; //!< of the track in the snapshot doc
+      std::vector<uint8_t> bytes;
+   };
+
+   std::map<TrackId, Fragment> tracks;
+   size_t size { 0 };
+   int deltas { 0 };
+};
+
 bool ProjectFileIO::InitializeSQL()
 {
    static SQLiteIniter sqliteIniter;
@@ -1314,12 +1483,11 @@ FilePath ProjectFileIO::SafetyFileName(const FilePath &src)
 
 bool ProjectFileIO::RenameOrWarn(const FilePath &src, const FilePath &dst)
 {
-   std::atomic_bool done = {false};
    bool success = false;
-   auto thread = std::thread([&]
+   TaskGroup tasks{ TaskGroup::Lane::Interactive };
+   tasks.Run([&]
    {
       success = wxRenameFile(src, dst);
-      done = true;
    });
 
    // Provides a progress dialog with indeterminate mode
@@ -1328,13 +1496,8 @@ bool ProjectFileIO::RenameOrWarn(const FilePath &src, const FilePath &dst)
       XO("Copying Project"), XO("This may take several seconds"));
    wxASSERT(pd);
 
-   // Wait for the checkpoints to end
-   while (!done)
-   {
-      wxMilliSleep(50);
-      pd->Pulse();
-   }
-   thread.join();
+   // Wait for the rename to end
+   tasks.Wait([&]{ pd->Pulse(); return true; });
 
    if (!success)
    {
@@ -1475,6 +1638,14 @@ void ProjectFileIO::Compact(
       }
    }
 
+   // A file created for it can be compacted in place, needing no copy and
+   // no extra disk space
+   if (CanCompactInPlace())
+   {
+      mWasCompacted = CompactInPlace(tracks);
+      return;
+   }
+
    wxString origName = mFileName;
    wxString backName = origName + "_compact_back";
    wxString tempName = origName + "_compact_temp";
@@ -1574,6 +1745,139 @@ void ProjectFileIO::Compact(
    return;
 }
 
+bool ProjectFileIO::CanCompactInPlace()
+{
+   // 2 is INCREMENTAL
+   int64_t autoVacuum = 0;
+   return GetValue("PRAGMA main.auto_vacuum;", autoVacuum, true) &&
+      autoVacuum == 2;
+}
+
+bool ProjectFileIO::CompactInPlace(const std::vector<const TrackList *> &tracks)
+{
+   {
+      TransactionScope transaction(GetConnection(), "CompactInPlace");
+
+      // Keep only the blocks used by the tracks, as CopyTo() would
+      if (!tracks.empty())
+      {
+         bool recovered = mRecovered;
+         SampleBlockIDSet blockids;
+         for (auto pTracks : tracks)
+            if (pTracks)
+               InspectBlocks( *pTracks, {}, &blockids );
+         bool success = DeleteBlocks(blockids, true);
+         // Don't set mRecovered if any were deleted
+         mRecovered = recovered;
+         if (!success)
+            return false;
+      }
+
+      // And replace the documents, as CopyTo() would
+      ProjectSerializer doc;
+      WriteXMLHeader(doc);
+      WriteXML(doc, false, tracks.empty() ? nullptr : tracks[0]);
+
+      bool modified = mModified;
+      bool success = AutoSaveDelete() &&
+         WriteDoc(IsTemporary() ? "autosave" : "project", doc);
+      mModified = modified;
+      if (!success || !transaction.Commit())
+         return false;
+   }
+
+   // Give all unused pages back to the file system
+   if (!Query("PRAGMA main.incremental_vacuum;", [](auto...) { return 0; }))
+      return false;
+
+   // The vacuum only wrote the shorter database into the write-ahead log;
+   // move it into the file and empty the log, so that callers measuring the
+   // files see the space actually freed.  Failure here loses nothing.
+   Query("PRAGMA main.wal_checkpoint(TRUNCATE);",
+      [](auto...) { return 0; }, true);
+   return true;
+}
+
+auto ProjectFileIO::GetCompactionStats() -> CompactionStats
+{
+   CompactionStats stats;
+   stats.deletedBlocks = mDeletedBlocks;
+   stats.releasedPages = mReleasedPages;
+
+   if (HasConnection())
+   {
+      GetValue("PRAGMA main.page_size;", stats.pageSize, true);
+      GetValue("PRAGMA main.page_count;", stats.pageCount, true);
+      GetValue("PRAGMA main.freelist_count;", stats.freePages, true);
+      stats.incremental = CanCompactInPlace();
+   }
+
+   return stats;
+}
+
+bool ProjectFileIO::CompactStep(int64_t maxBytes)
+{
+   // Don't open a connection just for this
+   if (!HasConnection())
+      return false;
+
+   auto db = DB();
+
+   // Some operations, such as effects, hold a transaction open while yielding
+   // to the event loop; wait until they finish
+   if (!sqlite3_get_autocommit(db))
+      return true;
+
+   // Imports yield to the event loop while worker threads store blocks
+   if (mProject.mbBusyImporting)
+      return true;
+
+   if (!CanCompactInPlace())
+      return false;
+
+   if (!mOrphansDeleted)
+   {
+      // Rows of sample blocks that have no object in memory can never be
+      // used again.  Collect the ids and delete the other rows while no
+      // block can be created.
+      bool success = true;
+      WaveTrackFactory::Get( mProject )
+         .GetSampleBlockFactory()
+            ->VisitActiveBlockIDs([&](const auto &blockids){
+               if (blockids.size() > 0)
+               {
+                  bool recovered = mRecovered;
+                  const auto changes = sqlite3_total_changes(db);
+                  success = DeleteBlocks(blockids, true);
+                  mRecovered = recovered;
+                  if (success)
+                     mDeletedBlocks += sqlite3_total_changes(db) - changes;
+               }
+            });
+      if (!success)
+         return false;
+      mOrphansDeleted = true;
+   }
+
+   int64_t pageSize = 0;
+   int64_t freePages = 0;
+   if (!GetValue("PRAGMA main.page_size;", pageSize, true) ||
+       !GetValue("PRAGMA main.freelist_count;", freePages, true) ||
+       pageSize <= 0 || freePages == 0)
+      return false;
+
+   // The checkpoint thread truncates the file when it next runs
+   const auto pages = std::clamp<int64_t>(maxBytes / pageSize, 1, freePages);
+   const wxString sql = wxString::Format(
+      "PRAGMA main.incremental_vacuum(%lld);", static_cast<long long>(pages));
+   if (!Query(sql.c_str(), [](auto...) { return 0; }))
+      return false;
+
+   mReleasedPages += pages;
+
+   return pages < freePages;
+}
+
 bool ProjectFileIO::WasCompacted()
 {
    return mWasCompacted;
@@ -1651,6 +1955,15 @@ void ProjectFileIO::SetFileName(const FilePath &fileName)
 
    mFileName = fileName;
 
+   // Every switch of connection comes here.  The autosave snapshot was written
+   // to the previous database, so the next autosave must be a full one.
+   mAutoSaveSnapshot.reset();
+
+   // Likewise restart the compaction in place
+   mOrphansDeleted = false;
+   mDeletedBlocks = 0;
+   mReleasedPages = 0;
+
    if (!mFileName.empty())
    {
       ActiveProjects::Add(mFileName);
@@ -1784,6 +2097,24 @@ void ProjectFileIO::WriteXML(XMLWriter &xmlFile,
 
    //TIMER_START( "TenacityProject::WriteXML", xml_writer_timer );
 
+   WriteXMLProjectStart(xmlFile);
+
+   tracklist.Any().Visit([&](const Track *t)
+   {
+      if (auto useTrack = SavedTrack(t, recording))
+         useTrack->WriteXML(xmlFile);
+   });
+
+   xmlFile.EndTag(wxT("project"));
+
+   //TIMER_STOP( xml_writer_timer );
+}
+
+void ProjectFileIO::WriteXMLProjectStart(XMLWriter &xmlFile)
+// may throw
+{
+   auto &proj = mProject;
+
    xmlFile.StartTag(wxT("project"));
    xmlFile.WriteAttr(wxT("xmlns"), wxT("http://audacity.sourceforge.net/"));
 
@@ -1792,45 +2123,125 @@ void ProjectFileIO::WriteXML(XMLWriter &xmlFile,
 
    ProjectFileIORegistry::Get().CallAttributeWriters(proj, xmlFile);
    ProjectFileIORegistry::Get().CallObjectWriters(proj, xmlFile);
+}
+
+const Track *ProjectFileIO::SavedTrack(const Track *t, bool recording)
+{
+   if ( recording ) {
+      // When append-recording, there is a temporary "shadow" track accumulating
+      // changes and displayed on the screen but it is not yet part of the
+      // regular track list.  That is the one that we want to back up.
+      // SubstitutePendingChangedTrack() fetches the shadow, if the track has
+      // one, else it gives the same track back.
+      return t->SubstitutePendingChangedTrack().get();
+   }
+   else if ( t->GetId() == TrackId{} ) {
+      // This is a track added during a non-appending recording that is
+      // not yet in the undo history.  The UndoManager skips backing it up
+      // when pushing.  Don't auto-save it.
+      return nullptr;
+   }
+   return t;
+}
+
+bool ProjectFileIO::AutoSave(bool recording)
+{
+   // Serialize the project element and each of the tracks separately, so that
+   // tracks unchanged since the last full snapshot need not be written again
+   ProjectSerializer head;
+   WriteXMLHeader(head);
+   WriteXMLProjectStart(head);
 
+   std::vector<std::pair<TrackId, std::vector<uint8_t>>> tracks;
+   const auto &tracklist = TrackList::Get(mProject);
    tracklist.Any().Visit([&](const Track *t)
    {
-      auto useTrack = t;
-      if ( recording ) {
-         // When append-recording, there is a temporary "shadow" track accumulating
-         // changes and displayed on the screen but it is not yet part of the
-         // regular track list.  That is the one that we want to back up.
-         // SubstitutePendingChangedTrack() fetches the shadow, if the track has
-         // one, else it gives the same track back.
-         useTrack = t->SubstitutePendingChangedTrack().get();
-      }
-      else if ( useTrack->GetId() == TrackId{} ) {
-         // This is a track added during a non-appending recording that is
-         // not yet in the undo history.  The UndoManager skips backing it up
-         // when pushing.  Don't auto-save it.
-         return;
+      if (auto useTrack = SavedTrack(t, recording))
+      {
+         ProjectSerializer track;
+         useTrack->WriteXML(track);
+         tracks.emplace_back(useTrack->GetId(), SerializedBytes(track));
       }
-      useTrack->WriteXML(xmlFile);
    });
 
-   xmlFile.EndTag(wxT("project"));
+   ProjectSerializer tail;
+   tail.EndTag(wxT("project"));
 
-   //TIMER_STOP( xml_writer_timer );
-}
+   const auto headBytes = SerializedBytes(head);
+   const auto tailBytes = SerializedBytes(tail);
 
-bool ProjectFileIO::AutoSave(bool recording)
-{
-   ProjectSerializer autosave;
-   WriteXMLHeader(autosave);
-   WriteXML(autosave, recording);
+   auto pSnapshot = std::move(mAutoSaveSnapshot);
 
-   if (WriteDoc("autosave", autosave))
+   MemoryStream delta;
+   bool full = !pSnapshot || pSnapshot->deltas >= AutoSaveDeltasPerSnapshot;
+   if (!full)
    {
-      mModified = true;
-      return true;
+      size_t literalSize = headBytes.size() + tailBytes.size();
+
+      AppendLiteral(delta, headBytes);
+      for (const auto &[id, bytes] : tracks)
+      {
+         auto iter = pSnapshot->tracks.find(id);
+         if (id != TrackId{} &&
+             iter != pSnapshot->tracks.end() && iter->second.bytes == bytes)
+         {
+            AppendCopy(delta, iter->second.offset, bytes.size());
+         }
+         else
+         {
+            AppendLiteral(delta, bytes);
+            literalSize += bytes.size();
+         }
+      }
+      AppendLiteral(delta, tailBytes);
+
+      // Start over from a new snapshot once the changes are no longer
+      // much smaller than it
+      full = literalSize * 2 > pSnapshot->size;
+   }
+
+   if (full)
+   {
+      pSnapshot = std::make_unique<AutoSaveSnapshot>();
+
+      MemoryStream doc;
+      doc.AppendData(headBytes.data(), headBytes.size());
+      for (auto &[id, bytes] : tracks)
+      {
+         doc.AppendData(bytes.data(), bytes.size());
+         if (id != TrackId{})
+            pSnapshot->tracks[id] =
+               { doc.GetSize() - bytes.size(), std::move(bytes) };
+      }
+      doc.AppendData(tailBytes.data(), tailBytes.size());
+      pSnapshot->size = doc.GetSize();
+
+      // Replace the snapshot and drop the delta against the old one together
+      TransactionScope transaction(GetConnection(), "AutoSave");
+
+      if (!WriteDoc("autosave", AutoSaveSnapshotID, head.GetDict(), doc))
+         return false;
+
+      if (!Query("DELETE FROM main.autosave WHERE id <> 1;",
+                 [](auto...) { return 0; }))
+         return false;
+
+      if (!transaction.Commit())
+         return false;
+   }
+   else
+   {
+      if (!WriteDoc("autosave", AutoSaveDeltaID, head.GetDict(), delta))
+         return false;
+
+      ++pSnapshot->deltas;
    }
 
-   return false;
+   // A failed write leaves no snapshot, so the next autosave is a full one
+   mAutoSaveSnapshot = std::move(pSnapshot);
+   mModified = true;
+
+   return true;
 }
 
 bool ProjectFileIO::AutoSaveDelete(sqlite3 *db /* = nullptr */)
@@ -1842,6 +2253,8 @@ bool ProjectFileIO::AutoSaveDelete(sqlite3 *db /* = nullptr */)
       db = DB();
    }
 
+   mAutoSaveSnapshot.reset();
+
    rc = sqlite3_exec(db, "DELETE FROM autosave;", nullptr, nullptr, nullptr);
    if (rc != SQLITE_OK)
    {
@@ -1859,6 +2272,14 @@ bool ProjectFileIO::AutoSaveDelete(sqlite3 *db /* = nullptr */)
 bool ProjectFileIO::WriteDoc(const char *table,
                              const ProjectSerializer &autosave,
                              const char *schema /* = "main" */)
+{
+   return WriteDoc(table, 1, autosave.GetDict(), autosave.GetData(), schema);
+}
+
+bool ProjectFileIO::WriteDoc(const char *table, int id,
+                             const MemoryStream &dict,
+                             const MemoryStream &data,
+                             const char *schema /* = "main" */)
 {
    auto db = DB();
 
@@ -1866,14 +2287,13 @@ bool ProjectFileIO::WriteDoc(const char *table,
 
    int rc;
 
-   // For now, we always use an ID of 1. This will replace the previously
-   // written row every time.
+   // This will replace the previously written row with the same id.
    char sql[256];
    sqlite3_snprintf(
       sizeof(sql), sql,
-      "INSERT INTO %s.%s(id, dict, doc) VALUES(1, ?1, ?2)"
+      "INSERT INTO %s.%s(id, dict, doc) VALUES(%d, ?1, ?2)"
       "       ON CONFLICT(id) DO UPDATE SET dict = ?1, doc = ?2;",
-      schema, table);
+      schema, table, id);
 
    sqlite3_stmt *stmt = nullptr;
    auto cleanup = finally([&]
@@ -1893,9 +2313,6 @@ bool ProjectFileIO::WriteDoc(const char *table,
       return false;
    }
 
-   const MemoryStream& dict = autosave.GetDict();
-   const MemoryStream& data = autosave.GetData();
-
    // Bind statement parameters
    // Might return SQL_MISUSE which means it's our mistake that we violated
    // preconditions; should return SQL_OK which is 0
@@ -1934,7 +2351,7 @@ bool ProjectFileIO::WriteDoc(const char *table,
    int64_t rowID = 0;
 
    const wxString rowIDSql =
-      wxString::Format("SELECT ROWID FROM %s.%s WHERE id = 1;", schema, table);
+      wxString::Format("SELECT ROWID FROM %s.%s WHERE id = %d;", schema, table, id);
 
    if (!GetValue(rowIDSql, rowID, true))
    {
@@ -2045,11 +2462,22 @@ bool ProjectFileIO::LoadProject(const FilePath &fileName, bool ignoreAutosave)
    }
    else
    {
-      // Load 'er up
-      BufferedProjectBlobStream stream(
-         DB(), "main", useAutosave ? "autosave" : "project", rowId);
+      // If autosaves were recorded as changes since a full snapshot, replay
+      // them onto it
+      int64_t deltaRowId = -1;
+      if (useAutosave &&
+          GetValue("SELECT ROWID FROM main.autosave WHERE id = 2;", deltaRowId, true))
+      {
+         success = DecodeAutoSaveDelta(rowId, deltaRowId);
+      }
+      else
+      {
+         // Load 'er up
+         BufferedProjectBlobStream stream(
+            DB(), "main", useAutosave ? "autosave" : "project", rowId);
 
-      success = ProjectSerializer::Decode(stream, this);
+         success = ProjectSerializer::Decode(stream, this);
+      }
 
       if (!success)
       {
@@ -2113,6 +2541,30 @@ bool ProjectFileIO::LoadProject(const FilePath &fileName, bool ignoreAutosave)
    return true;
 }
 
+bool ProjectFileIO::DecodeAutoSaveDelta(int64_t rowID, int64_t deltaRowID)
+{
+   auto db = DB();
+
+   std::vector<uint8_t> snapshot;
+   std::vector<uint8_t> delta;
+   std::vector<uint8_t> doc;
+
+   if (ReadAutoSaveBlob(db, "doc", rowID, snapshot) &&
+       ReadAutoSaveBlob(db, "doc", deltaRowID, delta) &&
+       ReadAutoSaveBlob(db, "dict", deltaRowID, doc) &&
+       ApplyAutoSaveDelta(snapshot, delta, doc))
+   {
+      BufferedMemoryStream stream(doc);
+      return ProjectSerializer::Decode(stream, this);
+   }
+
+   // Nothing was decoded yet, so the snapshot alone can still be recovered
+   wxLogWarning("Unable to apply the autosave delta, using the last snapshot");
+
+   BufferedProjectBlobStream stream(db, "main", "autosave", rowID);
+   return ProjectSerializer::Decode(stream, this);
+}
+
 bool ProjectFileIO::UpdateSaved(const TrackList *tracks)
 {
    ProjectSerializer doc;
@@ -2221,9 +2673,9 @@ bool ProjectFileIO::SaveProject(
       //       should be moved to DBConnection::Open(), wrapping the SafeMode() call
       //       there.
       {
-         std::atomic_bool done = {false};
          bool success = true;
-         auto thread = std::thread([&]
+         TaskGroup tasks{ TaskGroup::Lane::Interactive };
+         tasks.Run([&]
          {
             auto rc =  newConn->Open(fileName);
             if (rc != SQLITE_OK)
@@ -2232,7 +2684,6 @@ bool ProjectFileIO::SaveProject(
                SetError(Verbatim(sqlite3_errstr(rc)));
                success = false;
             }
-            done = true;
          });
 
          // Provides a progress dialog with indeterminate mode
@@ -2241,13 +2692,8 @@ bool ProjectFileIO::SaveProject(
             XO("Syncing"), XO("This may take several seconds"));
          wxASSERT(pd);
 
-         // Wait for the checkpoints to end
-         while (!done)
-         {
-            wxMilliSleep(50);
-            pd->Pulse();
-         }
-         thread.join();
+         // Wait for the open to end
+         tasks.Wait([&]{ pd->Pulse(); return true; });
 
          if (!success)
          {
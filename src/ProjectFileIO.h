@@ -30,8 +30,10 @@ struct sqlite3_value;
 class TenacityProject;
 class DBConnection;
 struct DBConnectionErrors;
+class MemoryStream;
 class ProjectSerializer;
 class SqliteSampleBlock;
+class Track;
 class TrackList;
 class WaveTrack;
 
@@ -182,6 +184,29 @@ public:
    void Compact(
       const std::vector<const TrackList *> &tracks, bool force = false);
 
+   //! Unused space in the project file, and what compaction in place released
+   struct CompactionStats
+   {
+      int64_t pageSize { 0 };
+      //! All pages of the file, including unused ones
+      int64_t pageCount { 0 };
+      //! Unused pages not yet released to the file system
+      int64_t freePages { 0 };
+      //! Orphaned sample blocks deleted by CompactStep() on this connection
+      int64_t deletedBlocks { 0 };
+      //! Pages released by CompactStep() on this connection
+      int64_t releasedPages { 0 };
+      //! Whether the file can be compacted in place (auto_vacuum = INCREMENTAL)
+      bool incremental { false };
+   };
+   CompactionStats GetCompactionStats();
+
+   //! One bounded step of compaction in place, for idle time
+   /*! The first step on a connection deletes orphaned sample blocks, then each
+    releases at most maxBytes of unused pages to the file system.
+    @return whether there may be more to do */
+   bool CompactStep(int64_t maxBytes);
+
    // The last compact check did actually compact the project file if true
    bool WasCompacted();
 
@@ -211,6 +236,10 @@ private:
    void WriteXMLHeader(XMLWriter &xmlFile) const;
    void WriteXML(XMLWriter &xmlFile, bool recording = false,
       const TrackList *tracks = nullptr) /* not override */;
+   //! Write the project start tag with its attributes and non-track children
+   void WriteXMLProjectStart(XMLWriter &xmlFile);
+   //! The track that WriteXML writes in place of t, or null if t is skipped
+   static const Track *SavedTrack(const Track *t, bool recording);
 
    // XMLTagHandler callback methods
    bool HandleXMLTag(const std::string_view& tag, const AttributesList &attrs) override;
@@ -251,6 +280,12 @@ private:
 
    // Write project or autosave XML (binary) documents
    bool WriteDoc(const char *table, const ProjectSerializer &autosave, const char *schema = "main");
+   bool WriteDoc(const char *table, int id,
+      const MemoryStream &dict, const MemoryStream &data,
+      const char *schema = "main");
+
+   //! Decode the last full autosave snapshot with the delta at deltaRowID applied
+   bool DecodeAutoSaveDelta(int64_t rowID, int64_t deltaRowID);
 
    // Application defined function to verify blockid exists is in set of blockids
    static void InSet(sqlite3_context *context, int argc, sqlite3_value **argv);
@@ -278,6 +313,12 @@ private:
 
    bool ShouldCompact(const std::vector<const TrackList *> &tracks);
 
+   //! Whether the file was created with auto_vacuum = INCREMENTAL
+   bool CanCompactInPlace();
+   //! Compact with the same outcome as CopyTo() into a new file, but without
+   //! the copy, deleting blocks and releasing unused pages
+   bool CompactInPlace(const std::vector<const TrackList *> &tracks);
+
    // Gets values from SQLite B-tree structures
    static unsigned int get2(const unsigned char *ptr);
    static unsigned int get4(const unsigned char *ptr);
@@ -309,9 +350,19 @@ private:
    // Project had unused blocks during last Compact()
    bool mHadUnused;
 
+   // Progress of CompactStep() on the current connection
+   bool mOrphansDeleted { false };
+   int64_t mDeletedBlocks { 0 };
+   int64_t mReleasedPages { 0 };
+
    Connection mPrevConn;
    FilePath mPrevFileName;
    bool mPrevTemporary;
+
+   // The last full autosave snapshot written through the current connection;
+   // later autosaves only record the tracks that changed since
+   struct AutoSaveSnapshot;
+   std::unique_ptr<AutoSaveSnapshot> mAutoSaveSnapshot;
 };
 
 class wxTopLevelWindow;
@@ -1346,6 +1346,64 @@ bool ProjectFileManager::Import(
    return true;
 }
 
+namespace {
+//! Finish a file decoded by Importer::ImportConcurrently(), as
+//! ProjectFileManager::Import() would after Importer::Import()
+void AddConcurrentImport(ProjectFileManager &manager, TenacityProject &project,
+   Importer::ConcurrentImport &file, const Tags &oldTags, bool addToHistory)
+{
+   if (file.error)
+      std::rethrow_exception(file.error);
+   if (!file.success)
+      return;
+
+   // The file updated a copy of oldTags, the tags of the project before the
+   // batch; merge only what it changed, keeping what earlier files added
+   auto newTags = Tags::Get( project ).Duplicate();
+   for (const auto &pair : file.tags->GetRange())
+      if (oldTags.GetTag(pair.first) != pair.second)
+         newTags->SetTag(pair.first, pair.second);
+   Tags::Set( project, newTags );
+
+   if (addToHistory) {
+      FileHistory::Global().Append(file.fileName);
+   }
+
+   // PRL: Undo history is incremented inside this:
+   manager.AddImportedTracks(file.fileName,
+      std::move(file.tracks), std::move(file.labelTracks));
+}
+}
+
+void ProjectFileManager::ImportMany(
+   const wxArrayString &fileNames,
+   bool addToHistory /* = true */)
+{
+   auto &project = mProject;
+
+   // Projects are imported otherwise
+   const auto oldTags = Tags::Get( project ).shared_from_this();
+   std::vector<Importer::ConcurrentImport> files;
+   for (const auto &fileName : fileNames)
+      if (!fileName.AfterLast('.').IsSameAs(wxT("aup3"), false))
+         files.push_back({ fileName, oldTags->Duplicate() });
+
+   Importer::Get().ImportConcurrently(project,
+      &WaveTrackFactory::Get( project ), files);
+
+   // Add the tracks in order, importing the files left over in turn
+   auto pFile = files.begin();
+   for (const auto &fileName : fileNames) {
+      const bool listed = pFile != files.end() && pFile->fileName == fileName;
+      if (listed && pFile->imported)
+         AddConcurrentImport(*this, project, *pFile, *oldTags, addToHistory);
+      else
+         Import(fileName, addToHistory);
+      if (listed)
+         ++pFile;
+   }
+}
+
 #include "Clipboard.h"
 #include "shuttle/ShuttleGui.h"
 #include "widgets/HelpSystem.h"
@@ -1457,12 +1515,15 @@ void ProjectFileManager::Compact()
          clipboard.Clear();
 
       // Refresh the before space usage since it may have changed due to the
-      // above actions.
-      auto before = wxFileName::GetSize(projectFileIO.GetFileName());
+      // above actions.  Count the write-ahead log too, which compaction
+      // checkpoints into the file.
+      auto baseFile = wxFileName(projectFileIO.GetFileName());
+      auto walFile = wxFileName(projectFileIO.GetFileName() + wxT("-wal"));
+      auto before = baseFile.GetSize() + walFile.GetSize();
 
       projectFileIO.Compact(trackLists, true);
 
-      auto after = wxFileName::GetSize(projectFileIO.GetFileName());
+      auto after = baseFile.GetSize() + walFile.GetSize();
 
       if (!isBatch)
       {
@@ -102,6 +102,11 @@ public:
    bool Import(const FilePath &fileName,
                bool addToHistory = true);
 
+   //! Import the files as Import() would one by one, adding their tracks in
+   //! the given order, but decoding what allows it concurrently
+   void ImportMany(const wxArrayString &fileNames,
+                   bool addToHistory = true);
+
    void Compact();
 
    void AddImportedTracks(const FilePath &fileName,
@@ -13,6 +13,7 @@ Paul Licameli split from TenacityProject.cpp
 // Tenacity libraries
 #include <lib-files/FileNames.h>
 #include <lib-files/wxFileNameWrapper.h>
+#include <lib-preferences/Prefs.h>
 #include <lib-project-rate/QualitySettings.h>
 
 #include "ActiveProject.h"
@@ -330,14 +331,23 @@ public:
             ProjectWindow::Get( *mProject ).HandleResize(); // Adjust scrollers for NEW track sizes.
          } );
 
+         // Import each run of files between MIDI files together
+         FilePaths names;
+         const auto importNames = [&]{
+            ProjectFileManager::Get( *mProject ).ImportMany(names);
+            names.clear();
+         };
          for (const auto &name : sortednames) {
 #ifdef USE_MIDI
-            if (FileNames::IsMidi(name))
+            if (FileNames::IsMidi(name)) {
+               importNames();
                DoImportMIDI( *mProject, name );
+            }
             else
 #endif
-               ProjectFileManager::Get( *mProject ).Import(name);
+               names.push_back(name);
          }
+         importNames();
 
          auto &window = ProjectWindow::Get( *mProject );
          window.ZoomAfterImport(nullptr);
@@ -984,6 +994,10 @@ void ProjectManager::RestartTimer()
    }
 }
 
+// Megabytes of unused space in the project file to release at each tick of
+// the timer while audio is idle; zero disables compaction in the background
+static IntSetting CompactStepSize{ L"/Performance/CompactStepSize", 32 };
+
 void ProjectManager::OnTimer(wxTimerEvent& WXUNUSED(event))
 {
    auto &project = mProject;
@@ -1004,6 +1018,12 @@ void ProjectManager::OnTimer(wxTimerEvent& WXUNUSED(event))
          SetStatusText(sMessage, mainStatusBarField);
       }
    }
+   else if (!gAudioIO->IsBusy()) {
+      const auto stepSize = CompactStepSize.Read();
+      if (stepSize > 0)
+         ProjectFileIO::Get(project).CompactStep(
+            static_cast<int64_t>(stepSize) * 1024 * 1024);
+   }
 
    // As also with the TrackPanel timer:  wxTimer may be unreliable without
    // some restarts
@@ -0,0 +1,217 @@
+/**********************************************************************
+
+  Tenacity: A Digital Audio Editor
+
+  @file RealtimeChecks.cpp
+
+**********************************************************************/
+#include "RealtimeChecks.h"
+
+#ifdef EXPERIMENTAL_REALTIME_CHECKS
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace {
+thread_local bool sInScope = false;
+std::atomic<size_t> sAllocations{ 0 };
+std::atomic<size_t> sLocks{ 0 };
+std::atomic<size_t> sBypassed{ 0 };
+
+void *Allocate(std::size_t size, std::size_t alignment)
+{
+   if (sInScope)
+      ++sAllocations;
+   if (!size)
+      size = 1;
+   while (true) {
+      void *result = nullptr;
+      if (alignment <= alignof(std::max_align_t))
+         result = std::malloc(size);
+      else {
+#ifdef _WIN32
+         result = _aligned_malloc(size, alignment);
+#else
+         if (posix_memalign(&result, alignment, size) != 0)
+            result = nullptr;
+#endif
+      }
+      if (result)
+         return result;
+      if (auto handler = std::get_new_handler())
+         handler();
+      else
+         throw std::bad_alloc{};
+   }
+}
+
+void *AllocateNoThrow(std::size_t size, std::size_t alignment) noexcept
+{
+   try {
+      return Allocate(size, alignment);
+   }
+   catch (...) {
+      return nullptr;
+   }
+}
+
+void Free(void *p, [[maybe_unused]] std::size_t alignment) noexcept
+{
+#ifdef _WIN32
+   // Memory from _aligned_malloc must not go to free
+   if (alignment > alignof(std::max_align_t)) {
+      _aligned_free(p);
+      return;
+   }
+#endif
+   std::free(p);
+}
+
+constexpr auto Default = alignof(std::max_align_t);
+}
+
+// Replacements of all the replaceable global allocation functions, so that
+// none of them escapes counting, and each delete matches its new
+void *operator new(std::size_t size)
+{
+   return Allocate(size, Default);
+}
+
+void *operator new[](std::size_t size)
+{
+   return Allocate(size, Default);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+   return AllocateNoThrow(size, Default);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+   return AllocateNoThrow(size, Default);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment)
+{
+   return Allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment)
+{
+   return Allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment,
+   const std::nothrow_t &) noexcept
+{
+   return AllocateNoThrow(size, static_cast<std::size_t>(alignment));
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment,
+   const std::nothrow_t &) noexcept
+{
+   return AllocateNoThrow(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void *p) noexcept
+{
+   Free(p, Default);
+}
+
+void operator delete[](void *p) noexcept
+{
+   Free(p, Default);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+   Free(p, Default);
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+   Free(p, Default);
+}
+
+void operator delete(void *p, const std::nothrow_t &) noexcept
+{
+   Free(p, Default);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept
+{
+   Free(p, Default);
+}
+
+void operator delete(void *p, std::align_val_t alignment) noexcept
+{
+   Free(p, static_cast<std::size_t>(alignment));
+}
+
+void operator delete[](void *p, std::align_val_t alignment) noexcept
+{
+   Free(p, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void *p, std::size_t, std::align_val_t alignment) noexcept
+{
+   Free(p, static_cast<std::size_t>(alignment));
+}
+
+void operator delete[](void *p, std::size_t, std::align_val_t alignment)
+   noexcept
+{
+   Free(p, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void *p, std::align_val_t alignment,
+   const std::nothrow_t &) noexcept
+{
+   Free(p, static_cast<std::size_t>(alignment));
+}
+
+void operator delete[](void *p, std::align_val_t alignment,
+   const std::nothrow_t &) noexcept
+{
+   Free(p, static_cast<std::size_t>(alignment));
+}
+
+namespace RealtimeChecks {
+
+Scope::Scope()
+{
+   sInScope = true;
+}
+
+Scope::~Scope()
+{
+   sInScope = false;
+}
+
+void NoteLock()
+{
+   if (sInScope)
+      ++sLocks;
+}
+
+void NoteBypass()
+{
+   if (sInScope)
+      ++sBypassed;
+}
+
+Counts Take()
+{
+   return {
+      sAllocations.exchange(0), sLocks.exchange(0), sBypassed.exchange(0) };
+}
+
+}
+
+#endif
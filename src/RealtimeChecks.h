@@ -0,0 +1,96 @@
+/**********************************************************************
+
+  Tenacity: A Digital Audio Editor
+
+  @file RealtimeChecks.h
+
+  Counts the heap allocations and blocking locks in the audio callback
+
+**********************************************************************/
+#ifndef __TENACITY_REALTIME_CHECKS__
+#define __TENACITY_REALTIME_CHECKS__
+
+#include <cstddef>
+#include <mutex>
+
+//! Debugging aid for the real-time safety of the audio callback
+/*!
+ With EXPERIMENTAL_REALTIME_CHECKS, the global operator new is replaced, in
+ all its forms, to count the allocations made by a thread while it is inside
+ a Scope; and a LockGuard counts each time that such a thread must wait for a
+ mutex.  Otherwise all of this is inline and does nothing but lock.
+
+ On Windows the replacement applies only to the executable, not to the
+ libraries and plugins loaded as DLLs, so their allocations are not counted.
+ */
+namespace RealtimeChecks {
+
+struct Counts
+{
+   size_t allocations = 0;
+   size_t locks = 0;
+   //! Blocks that played without realtime effects, because the main thread
+   //! was changing them
+   size_t bypassed = 0;
+};
+
+#ifdef EXPERIMENTAL_REALTIME_CHECKS
+
+//! Marks the constructing thread as in the audio callback, for its lifetime
+class TENACITY_DLL_API Scope
+{
+public:
+   Scope();
+   Scope(const Scope&) = delete;
+   Scope &operator=(const Scope&) = delete;
+   ~Scope();
+};
+
+//! Count a lock that must wait, if inside a Scope
+TENACITY_DLL_API void NoteLock();
+
+//! Count a block that bypassed realtime effects, if inside a Scope
+TENACITY_DLL_API void NoteBypass();
+
+//! Counts since the last call, which are then reset
+TENACITY_DLL_API Counts Take();
+
+#else
+
+class Scope
+{
+public:
+   Scope() {}
+};
+
+inline void NoteLock() {}
+
+inline void NoteBypass() {}
+
+inline Counts Take() { return {}; }
+
+#endif
+
+//! Like std::lock_guard, but counts the lock if it must wait
+template<typename Mutex> class LockGuard
+{
+public:
+   explicit LockGuard(Mutex &mutex)
+      : mMutex{ mutex }
+   {
+      if (!mMutex.try_lock()) {
+         NoteLock();
+         mMutex.lock();
+      }
+   }
+   LockGuard(const LockGuard&) = delete;
+   LockGuard &operator=(const LockGuard&) = delete;
+   ~LockGuard() { mMutex.unlock(); }
+
+private:
+   Mutex &mMutex;
+};
+
+}
+
+#endif
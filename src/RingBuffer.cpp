@@ -22,6 +22,10 @@
   AvailForPut and AvailForGet may underestimate but will never
   overestimate.
 
+  Besides Put and Get, which copy, the writer can fill the buffer in place
+  with GetWritable and Produce, and the reader can use the samples in place
+  with GetReadable and Consume.
+
 *//*******************************************************************/
 
 
@@ -54,6 +58,16 @@ size_t RingBuffer::Free( size_t start, size_t end )
    return std::max<size_t>(mBufferSize - Filled( start, end ), 4) - 4;
 }
 
+auto RingBuffer::MakeSpan( size_t pos, size_t samples ) -> Span
+{
+   Span span;
+   span.data[0] = mBuffer.ptr() + pos * SAMPLE_SIZE(mFormat);
+   span.count[0] = std::min( samples, mBufferSize - pos );
+   span.data[1] = mBuffer.ptr();
+   span.count[1] = samples - span.count[0];
+   return span;
+}
+
 //
 // For the writer only:
 // Only writer writes the end, so it can read it again relaxed
@@ -74,41 +88,46 @@ size_t RingBuffer::AvailForPut()
 size_t RingBuffer::Put(constSamplePtr buffer, sampleFormat format,
                     size_t samplesToCopy, size_t padding)
 {
-   auto start = mStart.load( std::memory_order_acquire );
-   auto end = mEnd.load( std::memory_order_relaxed );
-   const auto free = Free( start, end );
-   samplesToCopy = std::min( samplesToCopy, free );
-   padding = std::min( padding, free - samplesToCopy );
+   const auto span = GetWritable( samplesToCopy + padding );
+   samplesToCopy = std::min( samplesToCopy, span.Size() );
    auto src = buffer;
-   size_t copied = 0;
-   auto pos = end;
 
-   while ( samplesToCopy ) {
-      auto block = std::min( samplesToCopy, mBufferSize - pos );
+   for (unsigned ii = 0; ii < 2; ++ii) {
+      const auto block = std::min( samplesToCopy, span.count[ii] );
 
-      CopySamples(src, format,
-                  mBuffer.ptr() + pos * SAMPLE_SIZE(mFormat), mFormat,
+      CopySamples(src, format, span.data[ii], mFormat,
                   block, DitherType::none);
+      // Any remainder of the piece is padding
+      ClearSamples( span.data[ii], mFormat, block, span.count[ii] - block );
 
       src += block * SAMPLE_SIZE(format);
-      pos = (pos + block) % mBufferSize;
       samplesToCopy -= block;
-      copied += block;
    }
 
-   while ( padding ) {
-      const auto block = std::min( padding, mBufferSize - pos );
-      ClearSamples( mBuffer.ptr(), mFormat, pos, block );
-      pos = (pos + block) % mBufferSize;
-      padding -= block;
-      copied += block;
-   }
+   Produce( span.Size() );
+
+   return span.Size();
+}
+
+auto RingBuffer::GetWritable(size_t samples) -> Span
+{
+   // Acquire, so that the reader is done with the space before we reuse it
+   auto start = mStart.load( std::memory_order_acquire );
+   auto end = mEnd.load( std::memory_order_relaxed );
+   return MakeSpan( end, std::min( samples, Free( start, end ) ) );
+}
+
+void RingBuffer::Produce(size_t samples)
+{
+   // The reader only frees more space, so this bound is no smaller than
+   // the size of the last span
+   auto start = mStart.load( std::memory_order_relaxed );
+   auto end = mEnd.load( std::memory_order_relaxed );
+   samples = std::min( samples, Free( start, end ) );
 
    // Atomically update the end pointer with release, so the nonatomic writes
    // just done to the buffer don't get reordered after
-   mEnd.store(pos, std::memory_order_release);
-
-   return copied;
+   mEnd.store((end + samples) % mBufferSize, std::memory_order_release);
 }
 
 size_t RingBuffer::Clear(sampleFormat format, size_t samplesToClear)
@@ -156,33 +175,42 @@ size_t RingBuffer::AvailForGet()
 
 size_t RingBuffer::Get(samplePtr buffer, sampleFormat format,
                        size_t samplesToCopy)
+{
+   const auto span = GetReadable( samplesToCopy );
+   auto dest = buffer;
+
+   for (unsigned ii = 0; ii < 2; ++ii) {
+      CopySamples(span.data[ii], mFormat, dest, format,
+                  span.count[ii], DitherType::none);
+      dest += span.count[ii] * SAMPLE_SIZE(format);
+   }
+
+   Consume( span.Size() );
+
+   return span.Size();
+}
+
+auto RingBuffer::GetReadable(size_t samples) -> Span
 {
    // Must match the writer's release with acquire for well defined reads of
    // the buffer
    auto end = mEnd.load( std::memory_order_acquire );
    auto start = mStart.load( std::memory_order_relaxed );
-   samplesToCopy = std::min( samplesToCopy, Filled( start, end ) );
-   auto dest = buffer;
-   size_t copied = 0;
-
-   while(samplesToCopy) {
-      auto block = std::min( samplesToCopy, mBufferSize - start );
-
-      CopySamples(mBuffer.ptr() + start * SAMPLE_SIZE(mFormat), mFormat,
-                  dest, format,
-                  block, DitherType::none);
+   return MakeSpan( start, std::min( samples, Filled( start, end ) ) );
+}
 
-      dest += block * SAMPLE_SIZE(format);
-      start = (start + block) % mBufferSize;
-      samplesToCopy -= block;
-      copied += block;
-   }
+void RingBuffer::Consume(size_t samples)
+{
+   // The writer only adds samples, so this bound is no smaller than the size
+   // of the last span
+   auto end = mEnd.load( std::memory_order_relaxed );
+   auto start = mStart.load( std::memory_order_relaxed );
+   samples = std::min( samples, Filled( start, end ) );
 
    // Communicate to writer that we have consumed some data,
-   // with nonrelaxed ordering
-   mStart.store( start, std::memory_order_release );
-
-   return copied;
+   // with nonrelaxed ordering, so that our uses of the span happen-before
+   // the writer reuses the space
+   mStart.store( (start + samples) % mBufferSize, std::memory_order_release );
 }
 
 size_t RingBuffer::Discard(size_t samplesToDiscard)
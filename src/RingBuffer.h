@@ -18,9 +18,20 @@
 
 class RingBuffer final : public NonInterferingBase {
  public:
+   //! A region of the buffer, in two pieces when it wraps around the end
+   /*! The samples are in the format of the RingBuffer */
+   struct Span {
+      samplePtr data[2]{};
+      size_t count[2]{};
+
+      size_t Size() const { return count[0] + count[1]; }
+   };
+
    RingBuffer(sampleFormat format, size_t size);
    ~RingBuffer();
 
+   sampleFormat GetFormat() const { return mFormat; }
+
    //
    // For the writer only:
    //
@@ -32,6 +43,12 @@ class RingBuffer final : public NonInterferingBase {
               size_t padding = 0);
    size_t Clear(sampleFormat format, size_t samples);
 
+   //! Free space for at most `samples` samples, to fill in place
+   /*! The reader sees none of it before Produce() */
+   Span GetWritable(size_t samples);
+   //! Make the first `samples` of the last GetWritable() visible to the reader
+   void Produce(size_t samples);
+
    //
    // For the reader only:
    //
@@ -41,9 +58,16 @@ class RingBuffer final : public NonInterferingBase {
    size_t Get(samplePtr buffer, sampleFormat format, size_t samples);
    size_t Discard(size_t samples);
 
+   //! At most `samples` filled samples, to use in place
+   /*! They remain valid, and may even be modified, until Consume() */
+   Span GetReadable(size_t samples);
+   //! Give the first `samples` of the last GetReadable() back to the writer
+   void Consume(size_t samples);
+
  private:
    size_t Filled( size_t start, size_t end );
    size_t Free( size_t start, size_t end );
+   Span MakeSpan( size_t pos, size_t samples );
 
    // Align the two atomics to avoid false sharing
    NonInterfering< std::atomic<size_t> > mStart { 0 }, mEnd{ 0 };
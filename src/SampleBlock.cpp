@@ -9,11 +9,15 @@ SampleBlock.cpp
 // Tenacity libraries
 #include <lib-exceptions/InconsistencyException.h>
 #include <lib-math/SampleFormat.h>
+#include <lib-preferences/Prefs.h>
 
 #include "SampleBlock.h"
 
 #include <wx/defs.h>
 
+#include <cstring>
+#include <new>
+
 static SampleBlockFactoryFactory& installedFactory()
 {
    static SampleBlockFactoryFactory theFactory;
@@ -39,6 +43,60 @@ SampleBlockFactoryPtr SampleBlockFactory::New( TenacityProject &project )
 
 SampleBlockFactory::~SampleBlockFactory() = default;
 
+auto SampleBlockFactory::GetCacheStatistics() const -> CacheStatistics
+{
+   return {};
+}
+
+void SampleBlockFactory::SetCacheBudget( size_t )
+{
+}
+
+void SampleBlockFactory::Prefetch( const std::vector<SampleBlockID> & )
+{
+}
+
+SampleBlockFactory::PreparedBlock::~PreparedBlock() = default;
+
+namespace {
+//! Prepared block of the default implementation
+struct CopiedSamples final : SampleBlockFactory::PreparedBlock
+{
+   SampleBuffer samples;
+   size_t numsamples;
+   sampleFormat format;
+};
+}
+
+auto SampleBlockFactory::Prepare(constSamplePtr src,
+   size_t numsamples,
+   sampleFormat srcformat) -> PreparedBlockPtr
+{
+   auto result = std::make_unique<CopiedSamples>();
+   result->samples.Allocate(numsamples, srcformat);
+   if (!result->samples.ptr())
+      throw std::bad_alloc{};
+   memcpy(result->samples.ptr(), src, numsamples * SAMPLE_SIZE(srcformat));
+   result->numsamples = numsamples;
+   result->format = srcformat;
+   return result;
+}
+
+std::vector<SampleBlockPtr> SampleBlockFactory::CreatePrepared(
+   std::vector<PreparedBlockPtr> blocks )
+{
+   std::vector<SampleBlockPtr> result;
+   result.reserve(blocks.size());
+   for (auto &pBlock : blocks) {
+      auto &copied = static_cast<CopiedSamples&>(*pBlock);
+      result.push_back(
+         Create(copied.samples.ptr(), copied.numsamples, copied.format));
+   }
+   return result;
+}
+
+IntSetting SampleBlockCacheSize{ L"/Performance/SampleBlockCacheSize", 64 };
+
 SampleBlockPtr SampleBlockFactory::Create(constSamplePtr src,
    size_t numsamples,
    sampleFormat srcformat)
@@ -71,6 +129,11 @@ SampleBlockPtr SampleBlockFactory::CreateFromXML(
 
 SampleBlock::~SampleBlock() = default;
 
+SampleSpan SampleBlock::GetSampleSpan()
+{
+   return {};
+}
+
 size_t SampleBlock::GetSamples(samplePtr dest,
                    sampleFormat destformat,
                    size_t sampleoffset,
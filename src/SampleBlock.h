@@ -15,12 +15,14 @@ SampleBlock.h
 #include <functional>
 #include <memory>
 #include <unordered_set>
+#include <vector>
 
 #include "XMLTagHandler.h"
 
 class TenacityProject;
 class ProjectFileIO;
 class XMLWriter;
+class IntSetting;
 
 class SampleBlock;
 using SampleBlockPtr = std::shared_ptr<SampleBlock>;
@@ -31,6 +33,17 @@ using SampleBlockFactoryFactory =
 
 using SampleBlockID = long long;
 
+//! Read-only view of samples, sharing ownership of the memory that holds them
+struct SampleSpan
+{
+   std::shared_ptr<const void> owner;
+   constSamplePtr data = nullptr;
+   size_t count = 0;
+   sampleFormat format = floatSample;
+
+   explicit operator bool() const { return data != nullptr; }
+};
+
 class MinMaxRMS
 {
 public:
@@ -62,6 +75,10 @@ public:
 
    virtual size_t GetSampleCount() const = 0;
 
+   //! All the samples as stored, without copying, if the implementation can
+   /*! Never throws.  The default implementation returns an empty span. */
+   virtual SampleSpan GetSampleSpan();
+
    //! Non-throwing, should fill with zeroes on failure
    virtual bool
       GetSummary256(float *dest, size_t frameoffset, size_t numframes) = 0;
@@ -138,6 +155,15 @@ public:
    /*! @return ids of all sample blocks created by this factory and still extant */
    virtual SampleBlockIDs GetActiveBlockIDs() = 0;
 
+   //! Type of function that is given the ids of the extant sample blocks
+   using ActiveBlockIDsVisitor = std::function< void(const SampleBlockIDs&) >;
+
+   //! Call visit with the result of GetActiveBlockIDs(), while other threads
+   //! can create no block
+   /*! So that visit may delete the storage of all other blocks, though other
+    threads are importing */
+   virtual void VisitActiveBlockIDs( const ActiveBlockIDsVisitor &visit ) = 0;
+
    //! Type of function that is informed when a block is about to be deleted
    using BlockDeletionCallback = std::function< void(const SampleBlock&) >;
 
@@ -145,6 +171,53 @@ public:
    virtual BlockDeletionCallback SetBlockDeletionCallback(
       BlockDeletionCallback callback ) = 0;
 
+   //! Counters describing the factory's cache of sample block contents
+   struct CacheStatistics
+   {
+      size_t hits = 0;
+      size_t misses = 0;
+      size_t bytes = 0;    //!< currently held
+      size_t budget = 0;   //!< upper bound on bytes; zero if caching is off
+   };
+
+   //! Default implementation reports no cache
+   virtual CacheStatistics GetCacheStatistics() const;
+
+   //! Change the memory budget of the cache, evicting as needed
+   /*! Zero disables caching.  Default implementation does nothing. */
+   virtual void SetCacheBudget( size_t bytes );
+
+   //! Hint that the blocks will soon be read, in the given order
+   /*! An implementation may load them all with fewer round trips to storage
+    than reading them one at a time.  Never throws; errors are left to be
+    reported by the later reads.  Default implementation does nothing. */
+   virtual void Prefetch( const std::vector<SampleBlockID> &ids );
+
+   //! Contents of a block that is not yet stored, and whatever else about it
+   //! the factory can compute in advance
+   class TENACITY_DLL_API PreparedBlock
+   {
+   public:
+      virtual ~PreparedBlock();
+   };
+   using PreparedBlockPtr = std::unique_ptr<PreparedBlock>;
+
+   //! Copy samples for a block that CreatePrepared() will make later
+   /*! Unlike the other methods, this may be called on any thread, while
+    other threads use the factory.  The default implementation only copies
+    the samples.
+    @return not null */
+   virtual PreparedBlockPtr Prepare(constSamplePtr src,
+      size_t numsamples,
+      sampleFormat srcformat);
+
+   //! Make blocks from the results of Prepare(), in the same order
+   /*! An implementation may store many blocks at less cost than one at a
+    time.  The default implementation calls Create() for each.
+    Returns non-null pointers or else throws an exception */
+   virtual std::vector<SampleBlockPtr> CreatePrepared(
+      std::vector<PreparedBlockPtr> blocks );
+
 protected:
    // The override should throw more informative exceptions on error than the
    // default InconsistencyException thrown by Create
@@ -165,4 +238,7 @@ protected:
       const AttributesList &attrs) = 0;
 };
 
+//! Budget in megabytes for the cache of decoded sample blocks of each project
+extern TENACITY_DLL_API IntSetting SampleBlockCacheSize;
+
 #endif
@@ -33,6 +33,7 @@
 #include <algorithm>
 #include <cfloat>
 #include <cmath>
+#include <iterator>
 #include <optional>
 
 #include <wx/intl.h>
@@ -75,6 +76,21 @@ Sequence::~Sequence()
 {
 }
 
+bool Sequence::SameContents(const Sequence &other) const
+{
+   if (mpFactory != other.mpFactory ||
+       mSampleFormat != other.mSampleFormat ||
+       mNumSamples != other.mNumSamples ||
+       mMinSamples != other.mMinSamples ||
+       mMaxSamples != other.mMaxSamples ||
+       mBlock.size() != other.mBlock.size())
+      return false;
+
+   return std::equal(mBlock.begin(), mBlock.end(), other.mBlock.begin(),
+      [](const SeqBlock &a, const SeqBlock &b){
+         return a.sb == b.sb && a.start == b.start; });
+}
+
 size_t Sequence::GetMaxBlockSize() const
 {
    return mMaxSamples;
@@ -242,15 +258,13 @@ std::pair<float, float> Sequence::GetMinMax(
 
    // First calculate the min/max of the blocks in the middle of this region;
    // this is very fast because we have the min/max of every entire block
-   // already in memory.
-
-   for (unsigned b = block0 + 1; b < block1; ++b) {
-      auto results = mBlock[b].sb->GetMinMaxRMS(mayThrow);
+   // already in memory, and of runs of them in mPyramid.
 
-      if (results.min < min)
-         min = results.min;
-      if (results.max > max)
-         max = results.max;
+   if (block1 > block0 + 1) {
+      const auto summary =
+         mPyramid.Summarize(mBlock, block0 + 1, block1, mayThrow);
+      min = summary.min;
+      max = summary.max;
    }
 
    // Now we take the first and last blocks into account, noting that the
@@ -318,16 +332,12 @@ float Sequence::GetRMS(sampleCount start, sampleCount len, bool mayThrow) const
 
    // First calculate the rms of the blocks in the middle of this region;
    // this is very fast because we have the rms of every entire block
-   // already in memory.
-   for (unsigned b = block0 + 1; b < block1; b++) {
-      const SeqBlock &theBlock = mBlock[b];
-      const auto &sb = theBlock.sb;
-      auto results = sb->GetMinMaxRMS(mayThrow);
-
-      const auto fileLen = sb->GetSampleCount();
-      const auto blockRMS = results.RMS;
-      sumsq += static_cast<double>(blockRMS) * blockRMS * fileLen;
-      length += fileLen;
+   // already in memory, and of runs of them in mPyramid.
+   if (block1 > block0 + 1) {
+      const auto summary =
+         mPyramid.Summarize(mBlock, block0 + 1, block1, mayThrow);
+      sumsq += summary.sumsq;
+      length += mBlock[block1].start - mBlock[block0 + 1].start;
    }
 
    // Now we take the first and last blocks into account, noting that the
@@ -527,8 +537,10 @@ void Sequence::Paste(sampleCount s, const Sequence *src)
       // onto the end because the current last block is longer than the
       // minimum size
 
-      // Build and swap a copy so there is a strong exception safety guarantee
-      BlockArray newBlock{ mBlock };
+      // Build only the new blocks, then append them, so there is a strong
+      // exception safety guarantee without copying the existing blocks
+      BlockArray newBlock;
+      newBlock.reserve(srcNumBlocks);
       sampleCount samples = mNumSamples;
       for (unsigned int i = 0; i < srcNumBlocks; i++)
          // AppendBlock may throw for limited disk space, if pasting from
@@ -536,8 +548,8 @@ void Sequence::Paste(sampleCount s, const Sequence *src)
          AppendBlock(pUseFactory, mSampleFormat,
             newBlock, samples, srcBlock[i]);
 
-      CommitChangesIfConsistent
-         (newBlock, samples, wxT("Paste branch one"));
+      AppendBlocksIfConsistent
+         (newBlock, false, samples, wxT("Paste branch one"));
       return;
    }
 
@@ -573,6 +585,7 @@ void Sequence::Paste(sampleCount s, const Sequence *src)
          buffer.ptr(),
          largerBlockLen.as_size_t(),
          mSampleFormat);
+      mPyramid.Invalidate(b);
 
       // Don't make a duplicate array.  We can still give Strong-guarantee
       // if we modify only one block in place.
@@ -585,7 +598,9 @@ void Sequence::Paste(sampleCount s, const Sequence *src)
 
       // This consistency check won't throw, it asserts.
       // Proof that we kept consistency is not hard.
-      ConsistencyCheck(wxT("Paste branch two"), false);
+      // Check from the changed block only.
+      ConsistencyCheck(mBlock, mMaxSamples, b, mNumSamples,
+         wxT("Paste branch two"), false);
       return;
    }
 
@@ -593,9 +608,9 @@ void Sequence::Paste(sampleCount s, const Sequence *src)
    // it's simplest to just lump all the data together
    // into one big block along with the split block,
    // then resplit it all
+   // Build the blocks to replace the split block
    BlockArray newBlock;
-   newBlock.reserve(numBlocks + srcNumBlocks + 2);
-   newBlock.insert(newBlock.end(), mBlock.begin(), mBlock.begin() + b);
+   newBlock.reserve(srcNumBlocks + 2);
 
    SeqBlock &splitBlock = mBlock[b];
    auto splitLen = splitBlock.sb->GetSampleCount();
@@ -665,13 +680,9 @@ void Sequence::Paste(sampleCount s, const Sequence *src)
                newBlock, s + lastStart, sampleBuffer.ptr(), rightLen);
    }
 
-   // Copy remaining blocks to NEW block array and
-   // swap the NEW block array in for the old
-   for (i = b + 1; i < numBlocks; i++)
-      newBlock.push_back(mBlock[i].Plus(addedLen));
-
-   CommitChangesIfConsistent
-      (newBlock, mNumSamples + addedLen, wxT("Paste branch three"));
+   // Splice the NEW blocks in for the split block, shifting the rest
+   ReplaceBlocksIfConsistent
+      (b, b + 1, newBlock, addedLen, wxT("Paste branch three"));
 }
 
 /*! @excsafety{Strong} */
@@ -822,6 +833,7 @@ bool Sequence::HandleXMLTag(const std::string_view& tag, const AttributesList &a
          }
       }
 
+      mPyramid.Invalidate(mBlock.size());
       mBlock.push_back(wb);
 
       return true;
@@ -1075,11 +1087,37 @@ bool Sequence::Get(samplePtr buffer, sampleFormat format,
    return Get(b, buffer, format, start, len, mayThrow);
 }
 
+SampleSpan Sequence::GetSpan(
+   sampleFormat format, sampleCount start, size_t len) const
+{
+   if (len == 0 || start < 0 || start + len > mNumSamples)
+      return {};
+
+   const SeqBlock &block = mBlock[FindBlock(start)];
+   const auto bstart = (start - block.start).as_size_t();
+   if (bstart + len > block.sb->GetSampleCount())
+      return {};
+
+   auto span = block.sb->GetSampleSpan();
+   if (!span || span.format != format || bstart + len > span.count)
+      return {};
+
+   span.data += bstart * SAMPLE_SIZE(format);
+   span.count = len;
+   return span;
+}
+
 bool Sequence::Get(int b, samplePtr buffer, sampleFormat format,
    sampleCount start, size_t len, bool mayThrow) const
 {
    bool result = true;
+   const auto end = start + len;
+   // Index of the first block not yet passed to Prefetch()
+   int prefetched = b;
    while (len) {
+      if (b == prefetched)
+         prefetched = Prefetch(b, end);
+
       const SeqBlock &block = mBlock[b];
       // start is in block
       const auto bstart = (start - block.start).as_size_t();
@@ -1097,6 +1135,25 @@ bool Sequence::Get(int b, samplePtr buffer, sampleFormat format,
    return result;
 }
 
+int Sequence::Prefetch(int b, sampleCount end) const
+{
+   const int size = mBlock.size();
+   int bEnd = b;
+   while (bEnd < size && bEnd - b < PrefetchBlocks && mBlock[bEnd].start < end)
+      ++bEnd;
+
+   // A read within one block gains nothing
+   if (bEnd - b > 1 || (bEnd < size && mBlock[bEnd].start < end)) {
+      std::vector<SampleBlockID> ids;
+      ids.reserve(bEnd - b);
+      for (auto ii = b; ii < bEnd; ++ii)
+         ids.push_back(mBlock[ii].sb->GetBlockID());
+      mpFactory->Prefetch(ids);
+   }
+
+   return bEnd;
+}
+
 // Pass NULL to set silence
 /*! @excsafety{Strong} */
 void Sequence::SetSamples(constSamplePtr buffer, sampleFormat format,
@@ -1118,9 +1175,10 @@ void Sequence::SetSamples(constSamplePtr buffer, sampleFormat format,
       temp.Allocate(tempSize, mSampleFormat);
    }
 
-   int b = FindBlock(start);
+   const int b0 = FindBlock(start);
+   int b = b0;
+   // Build only the blocks that change
    BlockArray newBlock;
-   std::copy( mBlock.begin(), mBlock.begin() + b, std::back_inserter(newBlock) );
 
    while (len > 0
       // Redundant termination condition,
@@ -1204,9 +1262,7 @@ void Sequence::SetSamples(constSamplePtr buffer, sampleFormat format,
       b++;
    }
 
-   std::copy( mBlock.begin() + b, mBlock.end(), std::back_inserter(newBlock) );
-
-   CommitChangesIfConsistent( newBlock, mNumSamples, wxT("SetSamples") );
+   ReplaceBlocksIfConsistent( b0, b, newBlock, 0, wxT("SetSamples") );
 }
 
 namespace {
@@ -1272,8 +1328,7 @@ bool Sequence::GetWaveDisplay(float *min, float *max, float *rms, int* bl,
 
    auto srcX = s0;
    decltype(srcX) nextSrcX = 0;
-   int lastRmsDenom = 0;
-   int lastDivisor = 0;
+   double lastNumSamples = 0;
    auto whereNow = std::min(s1 - 1, where[0]);
    decltype(whereNow) whereNext = 0;
    // Loop over block files, opening and reading and closing each
@@ -1309,15 +1364,41 @@ bool Sequence::GetWaveDisplay(float *min, float *max, float *rms, int* bl,
                 (whereNext = std::min(s1 - 1, where[nextPixel])) < nextSrcX)
             ++nextPixel;
       }
-      if (nextPixel == pixel)
+      if (nextPixel == pixel) {
          // The entire block's samples fall within one pixel column.
          // Either it's a rare odd block at the end, or else,
          // we must be really zoomed out!
-         // Omit the entire block's contents from min/max/rms
-         // calculation, which is not correct, but correctness might not
-         // be worth the compute time if this happens every pixel
-         // column. -- PRL
+         // Then find all the following blocks that also fall within the
+         // column, and add them to it from the summaries in mPyramid,
+         // reading nothing
+         const auto columnEnd = (pixel < len)
+            ? std::min(s1 - 1, where[pixel])
+            : s1;
+         const unsigned bEnd = (columnEnd < mNumSamples)
+            ? FindBlock(columnEnd)
+            : nBlocks;
+         // (bEnd may not exceed b only for a last block extending past s1)
+         if (pixel > 0 && bEnd > b) {
+            const auto summary = mPyramid.Summarize(mBlock, b, bEnd, false);
+            const int lastPixel = pixel - 1;
+            float &lastMin = min[lastPixel];
+            lastMin = std::min(lastMin, summary.min);
+            float &lastMax = max[lastPixel];
+            lastMax = std::max(lastMax, summary.max);
+            float &lastRms = rms[lastPixel];
+            lastRms = sqrt(
+               (lastRms * lastRms * lastNumSamples + summary.sumsq) /
+               (lastNumSamples + summary.samples)
+            );
+            lastNumSamples += summary.samples;
+         }
+         if (bEnd > b + 1) {
+            b = bEnd - 1;
+            nextSrcX = std::min(s1,
+               mBlock[b].start + mBlock[b].sb->GetSampleCount());
+         }
          continue;
+      }
       if (nextPixel == len)
          whereNext = s1;
 
@@ -1391,11 +1472,11 @@ bool Sequence::GetWaveDisplay(float *min, float *max, float *rms, int* bl,
             float &lastMax = max[lastPixel];
             lastMax = std::max(lastMax, values.max);
             float &lastRms = rms[lastPixel];
-            int lastNumSamples = lastRmsDenom * lastDivisor;
             lastRms = sqrt(
                (lastRms * lastRms * lastNumSamples + values.sumsq * divisor) /
                (lastNumSamples + diff * divisor)
             );
+            lastNumSamples += diff * divisor;
 
             filePosition = midPosition;
          }
@@ -1440,8 +1521,7 @@ bool Sequence::GetWaveDisplay(float *min, float *max, float *rms, int* bl,
       wxASSERT(pixel == nextPixel);
       whereNow = whereNext;
       pixel = nextPixel;
-      lastDivisor = divisor;
-      lastRmsDenom = rmsDenom;
+      lastNumSamples = double(rmsDenom) * divisor;
    } // for each block file
 
    wxASSERT(pixel == len);
@@ -1672,6 +1752,7 @@ void Sequence::Delete(sampleCount start, sampleCount len)
            ( pos + len ).as_size_t(), newLen - pos, true);
 
       b.sb = factory.Create(scratch.ptr(), newLen, mSampleFormat);
+      mPyramid.Invalidate(b0);
 
       // Don't make a duplicate array.  We can still give Strong-guarantee
       // if we modify only one block in place.
@@ -1685,18 +1766,17 @@ void Sequence::Delete(sampleCount start, sampleCount len)
 
       // This consistency check won't throw, it asserts.
       // Proof that we kept consistency is not hard.
-      ConsistencyCheck(wxT("Delete - branch one"), false);
+      // Check from the changed block only.
+      ConsistencyCheck(mBlock, mMaxSamples, b0, mNumSamples,
+         wxT("Delete - branch one"), false);
       return;
    }
 
-   // Create a NEW array of blocks
+   // Create a NEW array of the blocks to replace those from first through b1,
+   // at most two on each side of the deletion
    BlockArray newBlock;
-   newBlock.reserve(numBlocks - (b1 - b0) + 2);
-
-   // Copy the blocks before the deletion point over to
-   // the NEW array
-   newBlock.insert(newBlock.end(), mBlock.begin(), mBlock.begin() + b0);
-   unsigned int i;
+   newBlock.reserve(4);
+   auto first = b0;
 
    // First grab the samples in block b0 before the deletion point
    // into preBuffer.  If this is enough samples for its own block,
@@ -1730,7 +1810,7 @@ void Sequence::Delete(sampleCount start, sampleCount len)
          Read(scratch.ptr() + prepreLen*sampleSize, mSampleFormat,
               preBlock, 0, preBufferLen, true);
 
-         newBlock.pop_back();
+         first = b0 - 1;
          Blockify(*mpFactory, mMaxSamples, mSampleFormat,
                   newBlock, prepreBlock.start, scratch.ptr(), sum);
       }
@@ -1786,12 +1866,9 @@ void Sequence::Delete(sampleCount start, sampleCount len)
       // right on the end of a block.
    }
 
-   // Copy the remaining blocks over from the old array
-   for (i = b1 + 1; i < numBlocks; i++)
-      newBlock.push_back(mBlock[i].Plus(-len));
-
-   CommitChangesIfConsistent
-      (newBlock, mNumSamples - len, wxT("Delete - branch two"));
+   // Splice the NEW blocks in, shifting the remaining blocks
+   ReplaceBlocksIfConsistent
+      (first, b1 + 1, newBlock, -len, wxT("Delete - branch two"));
 }
 
 void Sequence::ConsistencyCheck(const wxChar *whereStr, bool mayThrow) const
@@ -1802,7 +1879,7 @@ void Sequence::ConsistencyCheck(const wxChar *whereStr, bool mayThrow) const
 void Sequence::ConsistencyCheck
    (const BlockArray &mBlock, size_t maxSamples, size_t from,
     sampleCount mNumSamples, const wxChar *whereStr,
-    bool WXUNUSED(mayThrow))
+    bool WXUNUSED(mayThrow), sampleCount origin)
 {
    // Construction of the exception at the appropriate line of the function
    // gives a little more discrimination
@@ -1812,7 +1889,7 @@ void Sequence::ConsistencyCheck
 
    unsigned int i;
    sampleCount pos = from < numBlocks ? mBlock[from].start : mNumSamples;
-   if ( from == 0 && pos != 0 )
+   if ( from == 0 && pos != origin )
       ex.emplace( CONSTRUCT_INCONSISTENCY_EXCEPTION );
 
    for (i = from; !ex && i < numBlocks; i++) {
@@ -1858,6 +1935,13 @@ void Sequence::CommitChangesIfConsistent
    // now commit
    // use No-fail-guarantee
 
+   // Keep the summaries of the blocks before the first changed one
+   const auto unchanged = std::mismatch(
+      mBlock.begin(), mBlock.end(), newBlock.begin(), newBlock.end(),
+      [](const SeqBlock &a, const SeqBlock &b){ return a.sb == b.sb; }
+   ).first - mBlock.begin();
+   mPyramid.Invalidate(unchanged);
+
    mBlock.swap(newBlock);
    mNumSamples = numSamples;
 }
@@ -1881,6 +1965,7 @@ void Sequence::AppendBlocksIfConsistent
    }
 
    auto prevSize = mBlock.size();
+   mPyramid.Invalidate(prevSize);
 
    bool consistent = false;
    auto cleanup = finally( [&] {
@@ -1905,6 +1990,52 @@ void Sequence::AppendBlocksIfConsistent
    consistent = true;
 }
 
+void Sequence::ReplaceBlocksIfConsistent
+   (size_t b0, size_t b1, BlockArray &newBlocks, sampleCount delta,
+    const wxChar *whereStr)
+{
+   const auto numBlocks = mBlock.size();
+   wxASSERT(b0 <= b1 && b1 <= numBlocks);
+
+   // The NEW blocks must cover the replaced samples, changed in length by
+   // delta; check only them, not the whole array
+   const auto origin = b0 < numBlocks ? mBlock[b0].start : mNumSamples;
+   const auto end =
+      (b1 < numBlocks ? mBlock[b1].start : mNumSamples) + delta;
+   ConsistencyCheck( newBlocks, mMaxSamples, 0, end, whereStr,
+      true, origin ); // may throw
+
+   const auto removed = b1 - b0;
+   const auto added = newBlocks.size();
+   if (added > removed) {
+      const auto needed = numBlocks + added - removed;
+      if (needed > mBlock.capacity())
+         // Grow geometrically, so repeated insertions stay cheap
+         mBlock.reserve(std::max(needed, 2 * mBlock.capacity())); // may throw
+   }
+
+   // now commit
+   // use No-fail-guarantee
+
+   mPyramid.Invalidate(b0);
+
+   for (auto ii = b1; ii < numBlocks; ++ii)
+      mBlock[ii].start += delta;
+
+   // Moving SeqBlocks does not throw, and the capacity suffices
+   const auto common = std::min(removed, added);
+   std::move(newBlocks.begin(), newBlocks.begin() + common,
+      mBlock.begin() + b0);
+   if (added > removed)
+      mBlock.insert(mBlock.begin() + b1,
+         std::make_move_iterator(newBlocks.begin() + common),
+         std::make_move_iterator(newBlocks.end()));
+   else
+      mBlock.erase(mBlock.begin() + b0 + common, mBlock.begin() + b1);
+
+   mNumSamples += delta;
+}
+
 void Sequence::DebugPrintf
    (const BlockArray &mBlock, sampleCount mNumSamples, wxString *dest)
 {
@@ -20,8 +20,11 @@
 #include <lib-math/SampleFormat.h>
 #include <lib-xml/XMLTagHandler.h>
 
+#include "SummaryPyramid.h"
+
 class SampleBlock;
 class SampleBlockFactory;
+struct SampleSpan;
 using SampleBlockFactoryPtr = std::shared_ptr<SampleBlockFactory>;
 
 // This is an internal data structure!  For advanced use only.
@@ -93,6 +96,10 @@ class PROFILE_DLL_API Sequence final : public XMLTagHandler{
    bool Get(samplePtr buffer, sampleFormat format,
             sampleCount start, size_t len, bool mayThrow) const;
 
+   //! View of the samples without copying, if they lie within one block
+   //! stored in the given format; else an empty span
+   SampleSpan GetSpan(sampleFormat format, sampleCount start, size_t len) const;
+
    // Note that len is not size_t, because nullptr may be passed for buffer, in
    // which case, silence is inserted, possibly a large amount.
    void SetSamples(constSamplePtr buffer, sampleFormat format,
@@ -183,6 +190,10 @@ class PROFILE_DLL_API Sequence final : public XMLTagHandler{
    // you're doing!
    //
 
+   //! Whether a copy of this sequence would equal other, sharing its blocks
+   bool SameContents(const Sequence &other) const;
+
+   //! Do not change the blocks through this; it would not update mPyramid
    BlockArray &GetBlockArray() { return mBlock; }
    const BlockArray &GetBlockArray() const { return mBlock; }
 
@@ -211,6 +222,9 @@ class PROFILE_DLL_API Sequence final : public XMLTagHandler{
 
    bool          mErrorOpening{ false };
 
+   //! Summaries of runs of whole blocks, for GetWaveDisplay() when zoomed out
+   mutable SummaryPyramid mPyramid;
+
    //
    // Private methods
    //
@@ -250,6 +264,14 @@ class PROFILE_DLL_API Sequence final : public XMLTagHandler{
             size_t len,
             bool mayThrow) const;
 
+   //! Maximum number of blocks passed to one call of SampleBlockFactory::Prefetch
+   static constexpr int PrefetchBlocks = 16;
+
+   //! Pass the factory the ids of blocks from b, that begin before end
+   /*! Does nothing if the read does not span blocks.
+    @return index of the first block not passed */
+   int Prefetch(int b, sampleCount end) const;
+
 public:
 
    //
@@ -266,10 +288,12 @@ public:
       (const BlockArray &block, sampleCount numSamples, wxString *dest);
 
 private:
+   //! Check blocks from index from on, which should cover samples up to
+   //! numSamples, and start at origin if from is zero
    static void ConsistencyCheck
       (const BlockArray &block, size_t maxSamples, size_t from,
        sampleCount numSamples, const wxChar *whereStr,
-       bool mayThrow = true);
+       bool mayThrow = true, sampleCount origin = 0);
 
    // The next two are used in methods that give a strong guarantee.
    // They either throw because final consistency check fails, or swap the
@@ -282,6 +306,14 @@ private:
       (BlockArray &additionalBlocks, bool replaceLast,
        sampleCount numSamples, const wxChar *whereStr);
 
+   //! Replace blocks [b0, b1) with newBlocks, which must already have their
+   //! final starts, and shift the later blocks by delta samples
+   /*! Costs time in proportion to the changed blocks, plus one addition for
+    each later block, rather than copying and checking the whole array */
+   void ReplaceBlocksIfConsistent
+      (size_t b0, size_t b1, BlockArray &newBlocks, sampleCount delta,
+       const wxChar *whereStr);
+
 };
 
 #endif // __AUDACITY_SEQUENCE__
@@ -24,12 +24,41 @@ and in the spectrogram spectral selection.
 
 #include "SpectrumAnalyst.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
 // Tenacity libraries
 #include <lib-math/FFT.h>
+#include <lib-math/RealFFTf.h>
 #include <lib-math/SampleFormat.h>
+#include <lib-utility/TaskScheduler.h>
 
 #include <wx/dcclient.h>
 
+namespace {
+
+//! Fewest windows worth giving to one task, which has its own accumulator
+constexpr size_t MinWindowsPerChunk = 8;
+
+//! Buffers and partial sums for a range of windows, reused for each window
+struct WindowChunk
+{
+   explicit WindowChunk(size_t windowSize)
+      : in{ windowSize }
+      , out{ windowSize }
+      , out2{ windowSize }
+      , work{ windowSize }
+      , sum( windowSize / 2, 0.0f )
+   {
+   }
+
+   Floats in, out, out2, work;
+   std::vector<float> sum;
+};
+
+}
+
 FreqGauge::FreqGauge(wxWindow * parent, wxWindowID winid)
 :  wxStatusBar(parent, winid, wxST_SIZEGRIP)
 {
@@ -123,9 +152,6 @@ bool SpectrumAnalyst::Calculate(Algorithm alg, int windowFunc,
    auto half = mWindowSize / 2;
    mProcessed.resize(mWindowSize);
 
-   Floats in{ mWindowSize };
-   Floats out{ mWindowSize };
-   Floats out2{ mWindowSize };
    Floats win{ mWindowSize };
 
    for (size_t i = 0; i < mWindowSize; i++) {
@@ -149,95 +175,128 @@ bool SpectrumAnalyst::Calculate(Algorithm alg, int windowFunc,
       progress->SetRange(dataLen);
    }
 
-   size_t start = 0;
-   int windows = 0;
-   while (start + mWindowSize <= dataLen) {
-      for (size_t i = 0; i < mWindowSize; i++)
-         in[i] = win[i] * data[start + i];
-
-      switch (alg) {
-         case Spectrum:
-            PowerSpectrum(mWindowSize, in.get(), out.get());
+   const size_t windows = (dataLen - mWindowSize) / half + 1;
+   const auto hFFT = GetFFT(mWindowSize);
+
+   // Process the windows in independent ranges, each in one task with its
+   // own buffers and sums, which are added in order at the end
+   const auto nChunks = std::max<size_t>(1, std::min<size_t>(
+      windows / MinWindowsPerChunk,
+      4 * (TaskScheduler::Get().GetThreadCount() + 1)));
+   std::vector<std::unique_ptr<WindowChunk>> chunks(nChunks);
+   std::atomic<size_t> done{ 0 };
+
+   const auto processChunk = [&](size_t iChunk) {
+      chunks[iChunk] = std::make_unique<WindowChunk>(mWindowSize);
+      auto &chunk = *chunks[iChunk];
+      auto &in = chunk.in, &out = chunk.out, &out2 = chunk.out2,
+         &work = chunk.work;
+      auto &sum = chunk.sum;
+      const auto first = iChunk * windows / nChunks;
+      const auto last = (iChunk + 1) * windows / nChunks;
+      for (auto window = first; window < last; window++) {
+         const auto start = window * half;
+         for (size_t i = 0; i < mWindowSize; i++)
+            in[i] = win[i] * data[start + i];
+
+         switch (alg) {
+            case Spectrum:
+               PowerSpectrum(*hFFT, in.get(), out.get(), work.get());
 
-            for (size_t i = 0; i < half; i++)
-               mProcessed[i] += out[i];
-            break;
-
-         case Autocorrelation:
-         case CubeRootAutocorrelation:
-         case EnhancedAutocorrelation:
+               for (size_t i = 0; i < half; i++)
+                  sum[i] += out[i];
+               break;
 
-            // Take FFT
-            RealFFT(mWindowSize, in.get(), out.get(), out2.get());
-            // Compute power
-            for (size_t i = 0; i < mWindowSize; i++)
-               in[i] = (out[i] * out[i]) + (out2[i] * out2[i]);
+            case Autocorrelation:
+            case CubeRootAutocorrelation:
+            case EnhancedAutocorrelation:
 
-            if (alg == Autocorrelation) {
+               // Take FFT
+               RealFFT(*hFFT, in.get(), out.get(), out2.get(), work.get());
+               // Compute power
                for (size_t i = 0; i < mWindowSize; i++)
-                  in[i] = sqrt(in[i]);
-            }
-            if (alg == CubeRootAutocorrelation ||
-                alg == EnhancedAutocorrelation) {
-               // Tolonen and Karjalainen recommend taking the cube root
-               // of the power, instead of the square root
+                  in[i] = (out[i] * out[i]) + (out2[i] * out2[i]);
 
-               for (size_t i = 0; i < mWindowSize; i++)
-                  in[i] = pow(in[i], 1.0f / 3.0f);
-            }
-            // Take FFT
-            RealFFT(mWindowSize, in.get(), out.get(), out2.get());
-
-            // Take real part of result
-            for (size_t i = 0; i < half; i++)
-               mProcessed[i] += out[i];
-            break;
-
-         case Cepstrum:
-            RealFFT(mWindowSize, in.get(), out.get(), out2.get());
-
-            // Compute log power
-            // Set a sane lower limit assuming maximum time amplitude of 1.0
-            {
-               float power;
-               float minpower = 1e-20*mWindowSize*mWindowSize;
-               for (size_t i = 0; i < mWindowSize; i++)
-               {
-                  power = (out[i] * out[i]) + (out2[i] * out2[i]);
-                  if(power < minpower)
-                     in[i] = log(minpower);
-                  else
-                     in[i] = log(power);
+               if (alg == Autocorrelation) {
+                  for (size_t i = 0; i < mWindowSize; i++)
+                     in[i] = sqrt(in[i]);
                }
-               // Take IFFT
-               InverseRealFFT(mWindowSize, in.get(), NULL, out.get());
+               if (alg == CubeRootAutocorrelation ||
+                   alg == EnhancedAutocorrelation) {
+                  // Tolonen and Karjalainen recommend taking the cube root
+                  // of the power, instead of the square root
+
+                  for (size_t i = 0; i < mWindowSize; i++)
+                     in[i] = pow(in[i], 1.0f / 3.0f);
+               }
+               // Take FFT
+               RealFFT(*hFFT, in.get(), out.get(), out2.get(), work.get());
 
                // Take real part of result
                for (size_t i = 0; i < half; i++)
-                  mProcessed[i] += out[i];
-            }
+                  sum[i] += out[i];
+               break;
 
-            break;
+            case Cepstrum:
+               RealFFT(*hFFT, in.get(), out.get(), out2.get(), work.get());
 
-         default:
-            wxASSERT(false);
-            break;
-      }                         //switch
+               // Compute log power
+               // Set a sane lower limit assuming maximum time amplitude of 1.0
+               {
+                  float power;
+                  float minpower = 1e-20*mWindowSize*mWindowSize;
+                  for (size_t i = 0; i < mWindowSize; i++)
+                  {
+                     power = (out[i] * out[i]) + (out2[i] * out2[i]);
+                     if(power < minpower)
+                        in[i] = log(minpower);
+                     else
+                        in[i] = log(power);
+                  }
+                  // Take IFFT
+                  InverseRealFFT(*hFFT,
+                     in.get(), nullptr, out.get(), work.get());
+
+                  // Take real part of result
+                  for (size_t i = 0; i < half; i++)
+                     sum[i] += out[i];
+               }
 
-      // Update the progress bar
-      if (progress) {
-         progress->SetValue(start);
-      }
+               break;
 
-      start += half;
-      windows++;
+            default:
+               wxASSERT(false);
+               break;
+         }                         //switch
+
+         done++;
+      }
+   };
+
+   if (nChunks == 1)
+      processChunk(0);
+   else {
+      TaskGroup tasks{ TaskGroup::Lane::Interactive };
+      for (size_t iChunk = 0; iChunk < nChunks; iChunk++)
+         tasks.Run([&processChunk, iChunk]{ processChunk(iChunk); });
+      // Only this thread may update the progress bar
+      tasks.Wait([&]{
+         if (progress)
+            progress->SetValue(done * half);
+         return true;
+      });
    }
 
+   for (const auto &pChunk : chunks)
+      for (size_t i = 0; i < half; i++)
+         mProcessed[i] += pChunk->sum[i];
+
    if (progress) {
       // Reset for next time
       progress->Reset();
    }
 
+   Floats out{ mWindowSize };
    float mYMin = 1000000, mYMax = -1000000;
    double scale;
    switch (alg) {
@@ -35,6 +35,8 @@ public:
    ~SpectrumAnalyst();
 
    // Return true iff successful
+   // Ranges of windows are processed in parallel in the task scheduler,
+   // while this thread updates the progress gauge
    bool Calculate(Algorithm alg,
       int windowFunc, // see FFT.h for values
       size_t windowSize, double rate,
@@ -9,6 +9,10 @@ Paul Licameli -- split from SampleBlock.cpp and SampleBlock.h
 **********************************************************************/
 
 #include <cfloat>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 #include <sqlite3.h>
 
 #include "DBConnection.h"
@@ -16,6 +20,8 @@ Paul Licameli -- split from SampleBlock.cpp and SampleBlock.h
 
 // Tenacity libraries
 #include <lib-math/SampleFormat.h>
+#include <lib-math/SampleFormatSIMD.h>
+#include <lib-preferences/Prefs.h>
 #include <lib-xml/XMLTagHandler.h>
 
 #include "SampleBlock.h" // to inherit
@@ -24,6 +30,132 @@ Paul Licameli -- split from SampleBlock.cpp and SampleBlock.h
 
 class SqliteSampleBlockFactory;
 
+///\brief Size-bounded cache of the stored samples of blocks, shared by all
+/// readers of one project's blocks, discarding the least recently used first
+/*! Blocks never change contents after they are committed, and the database
+    never reuses block ids, so entries need no invalidation except to reclaim
+    memory when blocks are deleted.  All methods are thread-safe, because
+    playback reads blocks while the main thread draws and edits. */
+class SampleBlockCache
+{
+public:
+   //! Contents of one block, in its stored sample format
+   using Data = std::shared_ptr< const std::vector<char> >;
+
+   explicit SampleBlockCache( size_t budget );
+
+   //! Return null on a miss; updates the statistics
+   Data Find( SampleBlockID id );
+   //! Like Find but does not update the statistics or the recency
+   bool Contains( SampleBlockID id ) const;
+   void Insert( SampleBlockID id, Data data );
+   void Erase( SampleBlockID id );
+
+   bool Enabled() const;
+   void SetBudget( size_t budget );
+   SampleBlockFactory::CacheStatistics GetStatistics() const;
+
+private:
+   //! Discard least recently used entries until within the budget
+   //! @pre mMutex is locked
+   void Shrink();
+
+   mutable std::mutex mMutex;
+
+   //! Most recently used at the front
+   using List = std::list< std::pair< SampleBlockID, Data > >;
+   List mList;
+   std::unordered_map< SampleBlockID, List::iterator > mIndex;
+
+   size_t mBudget;
+   size_t mBytes{ 0 };
+   size_t mHits{ 0 };
+   size_t mMisses{ 0 };
+};
+
+SampleBlockCache::SampleBlockCache( size_t budget )
+   : mBudget{ budget }
+{
+}
+
+auto SampleBlockCache::Find( SampleBlockID id ) -> Data
+{
+   std::lock_guard<std::mutex> guard{ mMutex };
+   auto iter = mIndex.find( id );
+   if ( iter == mIndex.end() ) {
+      ++mMisses;
+      return {};
+   }
+   ++mHits;
+   // Move to the front, without invalidating iterators
+   mList.splice( mList.begin(), mList, iter->second );
+   return iter->second->second;
+}
+
+bool SampleBlockCache::Contains( SampleBlockID id ) const
+{
+   std::lock_guard<std::mutex> guard{ mMutex };
+   return mIndex.find( id ) != mIndex.end();
+}
+
+void SampleBlockCache::Insert( SampleBlockID id, Data data )
+{
+   std::lock_guard<std::mutex> guard{ mMutex };
+   if ( !data || data->size() > mBudget )
+      return;
+   auto iter = mIndex.find( id );
+   if ( iter != mIndex.end() ) {
+      // Another reader raced to load the same block
+      mBytes -= iter->second->second->size();
+      mList.erase( iter->second );
+      mIndex.erase( iter );
+   }
+   mBytes += data->size();
+   mList.emplace_front( id, std::move( data ) );
+   mIndex.emplace( id, mList.begin() );
+   Shrink();
+}
+
+void SampleBlockCache::Erase( SampleBlockID id )
+{
+   std::lock_guard<std::mutex> guard{ mMutex };
+   auto iter = mIndex.find( id );
+   if ( iter != mIndex.end() ) {
+      mBytes -= iter->second->second->size();
+      mList.erase( iter->second );
+      mIndex.erase( iter );
+   }
+}
+
+bool SampleBlockCache::Enabled() const
+{
+   std::lock_guard<std::mutex> guard{ mMutex };
+   return mBudget > 0;
+}
+
+void SampleBlockCache::SetBudget( size_t budget )
+{
+   std::lock_guard<std::mutex> guard{ mMutex };
+   mBudget = budget;
+   Shrink();
+}
+
+SampleBlockFactory::CacheStatistics SampleBlockCache::GetStatistics() const
+{
+   std::lock_guard<std::mutex> guard{ mMutex };
+   return { mHits, mMisses, mBytes, mBudget };
+}
+
+void SampleBlockCache::Shrink()
+{
+   while ( mBytes > mBudget && !mList.empty() ) {
+      auto &back = mList.back();
+      mBytes -= back.second->size();
+      mIndex.erase( back.first );
+      mList.pop_back();
+   }
+}
+
 ///\brief Implementation of @ref SampleBlock using Sqlite database
 class SqliteSampleBlock final : public SampleBlock
 {
@@ -40,6 +172,10 @@ public:
 
    //! Numbers of bytes needed for 256 and for 64k summaries
    using Sizes = std::pair< size_t, size_t >;
+   //! Copy the samples and calculate the summaries, without storing them
+   /*! Touches nothing shared, so it may be done on any thread */
+   Sizes PrepareSamples(
+      constSamplePtr src, size_t numsamples, sampleFormat srcformat);
    void Commit(Sizes sizes);
 
    void Delete();
@@ -52,6 +188,7 @@ public:
                        size_t numsamples) override;
    sampleFormat GetSampleFormat() const;
    size_t GetSampleCount() const override;
+   SampleSpan GetSampleSpan() override;
 
    bool GetSummary256(float *dest, size_t frameoffset, size_t numframes) override;
    bool GetSummary64k(float *dest, size_t frameoffset, size_t numframes) override;
@@ -71,6 +208,9 @@ public:
 private:
    bool IsSilent() const { return mBlockID <= 0; }
    void Load(SampleBlockID sbid);
+   //! Find all stored samples in the factory's cache, or read and cache them
+   /*! @return null if the cache is disabled */
+   SampleBlockCache::Data GetCachedSamples();
    bool GetSummary(float *dest,
                    size_t frameoffset,
                    size_t numframes,
@@ -140,6 +280,7 @@ public:
    ~SqliteSampleBlockFactory() override;
 
    SampleBlockIDs GetActiveBlockIDs() override;
+   void VisitActiveBlockIDs( const ActiveBlockIDsVisitor &visit ) override;
 
    SampleBlockPtr DoCreate(constSamplePtr src,
       size_t numsamples,
@@ -156,11 +297,26 @@ public:
    BlockDeletionCallback SetBlockDeletionCallback(
       BlockDeletionCallback callback ) override;
 
+   CacheStatistics GetCacheStatistics() const override;
+   void SetCacheBudget( size_t bytes ) override;
+   void Prefetch( const std::vector<SampleBlockID> &ids ) override;
+
+   PreparedBlockPtr Prepare(constSamplePtr src,
+      size_t numsamples,
+      sampleFormat srcformat) override;
+   std::vector<SampleBlockPtr> CreatePrepared(
+      std::vector<PreparedBlockPtr> blocks ) override;
+
 private:
    friend SqliteSampleBlock;
 
+   //! Requires mMutex to be held
+   SampleBlockIDs CollectActiveBlockIDs();
+
    const std::shared_ptr<ConnectionPtr> mppConnection;
 
+   SampleBlockCache mCache;
+
    // Track all blocks that this factory has created, but don't control
    // their lifetimes (so use weak_ptr)
    // (Must also use weak pointers because the blocks have shared pointers
@@ -169,11 +325,17 @@ private:
       std::map< SampleBlockID, std::weak_ptr< SqliteSampleBlock > >;
    AllBlocksMap mAllBlocks;
 
+   //! Serializes the creation of blocks, which concurrent imports do on
+   //! worker threads:  it spans each INSERT with its reading of the row id,
+   //! the savepoint of CreatePrepared(), and all uses of mAllBlocks
+   std::mutex mMutex;
+
    BlockDeletionCallback mCallback;
 };
 
 SqliteSampleBlockFactory::SqliteSampleBlockFactory( TenacityProject &project )
    : mppConnection{ ConnectionPtr::Get(project).shared_from_this() }
+   , mCache{ std::max( 0, SampleBlockCacheSize.Read() ) * size_t(1024 * 1024) }
 {
    
 }
@@ -184,13 +346,77 @@ SampleBlockPtr SqliteSampleBlockFactory::DoCreate(
    constSamplePtr src, size_t numsamples, sampleFormat srcformat )
 {
    auto sb = std::make_shared<SqliteSampleBlock>(shared_from_this());
-   sb->SetSamples(src, numsamples, srcformat);
+   // Calculate the summaries before taking the lock
+   const auto sizes = sb->PrepareSamples(src, numsamples, srcformat);
+   std::lock_guard<std::mutex> guard{ mMutex };
+   sb->Commit(sizes);
    // block id has now been assigned
    mAllBlocks[ sb->GetBlockID() ] = sb;
    return sb;
 }
 
+namespace {
+//! A block with its summaries calculated, awaiting its INSERT
+struct SqlitePreparedBlock final : SampleBlockFactory::PreparedBlock
+{
+   std::shared_ptr<SqliteSampleBlock> sb;
+   SqliteSampleBlock::Sizes sizes;
+};
+}
+
+auto SqliteSampleBlockFactory::Prepare(
+   constSamplePtr src, size_t numsamples, sampleFormat srcformat )
+   -> PreparedBlockPtr
+{
+   auto result = std::make_unique<SqlitePreparedBlock>();
+   result->sb = std::make_shared<SqliteSampleBlock>(shared_from_this());
+   result->sizes = result->sb->PrepareSamples(src, numsamples, srcformat);
+   return result;
+}
+
+std::vector<SampleBlockPtr> SqliteSampleBlockFactory::CreatePrepared(
+   std::vector<PreparedBlockPtr> blocks )
+{
+   std::vector<SampleBlockPtr> result;
+   if (blocks.empty())
+      return result;
+   result.reserve(blocks.size());
+
+   // One savepoint for the batch, rather than a transaction for each INSERT
+   std::lock_guard<std::mutex> guard{ mMutex };
+   auto &first = static_cast<SqlitePreparedBlock&>(*blocks.front());
+   TransactionScope transaction(*first.sb->Conn(), "PreparedBlocks");
+   for (auto &pBlock : blocks) {
+      auto &prepared = static_cast<SqlitePreparedBlock&>(*pBlock);
+      prepared.sb->Commit(prepared.sizes);
+      result.push_back(prepared.sb);
+   }
+   transaction.Commit();
+
+   // block ids have now been assigned
+   for (auto &pBlock : blocks) {
+      auto &sb = static_cast<SqlitePreparedBlock&>(*pBlock).sb;
+      mAllBlocks[ sb->GetBlockID() ] = sb;
+   }
+   return result;
+}
+
 auto SqliteSampleBlockFactory::GetActiveBlockIDs() -> SampleBlockIDs
+{
+   std::lock_guard<std::mutex> guard{ mMutex };
+   return CollectActiveBlockIDs();
+}
+
+void SqliteSampleBlockFactory::VisitActiveBlockIDs(
+   const ActiveBlockIDsVisitor &visit )
+{
+   // A block created after the ids are collected, but before visit deletes
+   // the rows of the others, would lose its row
+   std::lock_guard<std::mutex> guard{ mMutex };
+   visit( CollectActiveBlockIDs() );
+}
+
+auto SqliteSampleBlockFactory::CollectActiveBlockIDs() -> SampleBlockIDs
 {
    SampleBlockIDs result;
    for (auto end = mAllBlocks.end(), it = mAllBlocks.begin(); it != end;) {
@@ -244,6 +470,7 @@ SampleBlockPtr SqliteSampleBlockFactory::DoCreateFromXML(
             sb = DoCreateSilent( -nValue, floatSample );
          }
          else {
+            std::lock_guard<std::mutex> guard{ mMutex };
             // First see if this block id was previously loaded
             auto &wb = mAllBlocks[ nValue ];
             auto pb = wb.lock();
@@ -283,6 +510,86 @@ auto SqliteSampleBlockFactory::SetBlockDeletionCallback(
    return result;
 }
 
+auto SqliteSampleBlockFactory::GetCacheStatistics() const -> CacheStatistics
+{
+   return mCache.GetStatistics();
+}
+
+void SqliteSampleBlockFactory::SetCacheBudget( size_t bytes )
+{
+   mCache.SetBudget( bytes );
+}
+
+void SqliteSampleBlockFactory::Prefetch(
+   const std::vector<SampleBlockID> &ids )
+{
+   // Loading into the cache is the only purpose
+   if (!mCache.Enabled())
+      return;
+
+   auto &pConnection = mppConnection->mpConnection;
+   if (!pConnection)
+      return;
+
+   // Number of parameters in the IN clause of the statement
+   enum { batchSize = 16 };
+
+   std::vector<SampleBlockID> missing;
+   for (auto id : ids)
+      // Skip silent blocks, which have no rows
+      if (id > 0 && !mCache.Contains(id))
+         missing.push_back(id);
+   if (missing.size() < 2)
+      // No savings over reading one at a time
+      return;
+
+   // Prepare and cache statement...automatically finalized at DB close
+   sqlite3_stmt *stmt = nullptr;
+   try {
+      stmt = pConnection->Prepare(DBConnection::GetSamplesBatch,
+         "SELECT blockid, samples FROM sampleblocks WHERE blockid IN"
+         " (?1,?2,?3,?4,?5,?6,?7,?8,?9,?10,?11,?12,?13,?14,?15,?16);");
+   }
+   catch ( const TenacityException & ) {
+      return;
+   }
+
+   for (size_t first = 0; first < missing.size(); first += batchSize)
+   {
+      const auto last = std::min(missing.size(), first + batchSize);
+
+      // Unbound parameters are null and match nothing
+      for (auto ii = first; ii < last; ++ii)
+      {
+         if (sqlite3_bind_int64(stmt, 1 + (ii - first), missing[ii]))
+         {
+            wxASSERT_MSG(false, wxT("Binding failed...bug!!!"));
+         }
+      }
+
+      int rc;
+      while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+      {
+         const auto id = sqlite3_column_int64(stmt, 0);
+         const auto src = (const char *) sqlite3_column_blob(stmt, 1);
+         const auto bytes = (size_t) sqlite3_column_bytes(stmt, 1);
+         mCache.Insert(id, std::make_shared< std::vector<char> >(
+            src, src + bytes));
+      }
+
+      if (rc != SQLITE_DONE)
+         wxLogDebug(wxT("SqliteSampleBlockFactory::Prefetch - SQLITE error %s"),
+            sqlite3_errmsg(pConnection->DB()));
+
+      // Clear statement bindings and rewind statement
+      sqlite3_clear_bindings(stmt);
+      sqlite3_reset(stmt);
+
+      if (rc != SQLITE_DONE)
+         break;
+   }
+}
+
 SqliteSampleBlock::SqliteSampleBlock(
    const std::shared_ptr<SqliteSampleBlockFactory> &pFactory)
 :  mpFactory(pFactory)
@@ -314,6 +621,9 @@ SqliteSampleBlock::~SqliteSampleBlock()
       return;
    }
 
+   // Whether or not the row is deleted, nobody can read this block again
+   mpFactory->mCache.Erase(mBlockID);
+
    // See ProjectFileIO::Bypass() for a description of mIO.mBypass
    GuardedCall( [this]{
       if (!mLocked && !Conn()->ShouldBypass())
@@ -377,6 +687,23 @@ size_t SqliteSampleBlock::DoGetSamples(samplePtr dest,
       return numsamples;
    }
 
+   if (auto pData = GetCachedSamples())
+   {
+      // Same clipping and zero-filling as in GetBlob
+      const auto srcsize = SAMPLE_SIZE(mSampleFormat);
+      const auto srcoffset = std::min(sampleoffset * srcsize, pData->size());
+      const auto copied =
+         std::min(numsamples, (pData->size() - srcoffset) / srcsize);
+
+      wxASSERT(destformat == floatSample || destformat == mSampleFormat);
+      CopySamples(pData->data() + srcoffset, mSampleFormat,
+                  dest, destformat, copied);
+      if (copied < numsamples)
+         ClearSamples(dest, destformat, copied, numsamples - copied);
+
+      return numsamples;
+   }
+
    // Prepare and cache statement...automatically finalized at DB close
    sqlite3_stmt *stmt = Conn()->Prepare(DBConnection::GetSamples,
       "SELECT samples FROM sampleblocks WHERE blockid = ?1;");
@@ -389,9 +716,57 @@ size_t SqliteSampleBlock::DoGetSamples(samplePtr dest,
                   numsamples * SAMPLE_SIZE(mSampleFormat)) / SAMPLE_SIZE(mSampleFormat);
 }
 
+SampleSpan SqliteSampleBlock::GetSampleSpan()
+{
+   // The blob pointer from sqlite is valid only until the statement is
+   // reset, so views can be given only into the cache
+   if (IsSilent())
+      return {};
+   try {
+      if (auto pData = GetCachedSamples())
+         return { pData, pData->data(),
+            pData->size() / SAMPLE_SIZE(mSampleFormat), mSampleFormat };
+   }
+   catch ( const TenacityException & ) {
+   }
+   return {};
+}
+
+SampleBlockCache::Data SqliteSampleBlock::GetCachedSamples()
+{
+   auto &cache = mpFactory->mCache;
+   if (!cache.Enabled())
+      return {};
+
+   if (auto pData = cache.Find(mBlockID))
+      return pData;
+
+   if (!mValid)
+   {
+      Load(mBlockID);
+   }
+
+   auto pData = std::make_shared< std::vector<char> >(mSampleBytes);
+
+   // Prepare and cache statement...automatically finalized at DB close
+   sqlite3_stmt *stmt = Conn()->Prepare(DBConnection::GetSamples,
+      "SELECT samples FROM sampleblocks WHERE blockid = ?1;");
+   GetBlob(pData->data(), mSampleFormat, stmt, mSampleFormat, 0, mSampleBytes);
+
+   cache.Insert(mBlockID, pData);
+   return pData;
+}
+
 void SqliteSampleBlock::SetSamples(constSamplePtr src,
                                    size_t numsamples,
                                    sampleFormat srcformat)
+{
+   Commit( PrepareSamples(src, numsamples, srcformat) );
+}
+
+auto SqliteSampleBlock::PrepareSamples(constSamplePtr src,
+                                       size_t numsamples,
+                                       sampleFormat srcformat) -> Sizes
 {
    auto sizes = SetSizes(numsamples, srcformat);
    mSamples.reinit(mSampleBytes);
@@ -399,7 +774,7 @@ void SqliteSampleBlock::SetSamples(constSamplePtr src,
 
    CalcSummary( sizes );
 
-   Commit( sizes );
+   return sizes;
 }
 
 bool SqliteSampleBlock::GetSummary256(float *dest,
@@ -860,12 +1235,13 @@ void SqliteSampleBlock::CalcSummary(Sizes sizes)
    int sumLen = (mSampleCount + 255) / 256;
    int summaries = 256;
 
+   // Where vectorized kernels are available, they fill each triple with
+   // the minimum, maximum and sum of squares, finished in the loop below
+   const bool vectorized = SampleFormatSIMD::SummarizeGroups(
+      samples, mSampleCount, 256, summary256);
+
    for (int i = 0; i < sumLen; ++i)
    {
-      min = samples[i * 256];
-      max = samples[i * 256];
-      sumsq = min * min;
-
       int jcount = 256;
       if (jcount > mSampleCount - i * 256)
       {
@@ -873,18 +1249,31 @@ void SqliteSampleBlock::CalcSummary(Sizes sizes)
          fraction = 1.0 - (jcount / 256.0);
       }
 
-      for (int j = 1; j < jcount; ++j)
+      if (vectorized)
       {
-         float f1 = samples[i * 256 + j];
-         sumsq += f1 * f1;
+         min = summary256[i * fields];
+         max = summary256[i * fields + 1];
+         sumsq = summary256[i * fields + 2];
+      }
+      else
+      {
+         min = samples[i * 256];
+         max = samples[i * 256];
+         sumsq = min * min;
 
-         if (f1 < min)
+         for (int j = 1; j < jcount; ++j)
          {
-            min = f1;
-         }
-         else if (f1 > max)
-         {
-            max = f1;
+            float f1 = samples[i * 256 + j];
+            sumsq += f1 * f1;
+
+            if (f1 < min)
+            {
+               min = f1;
+            }
+            else if (f1 > max)
+            {
+               max = f1;
+            }
          }
       }
 
@@ -0,0 +1,112 @@
+/**********************************************************************
+
+  Tenacity: A Digital Audio Editor
+
+  @file SummaryPyramid.cpp
+
+**********************************************************************/
+#include "SummaryPyramid.h"
+
+#include <algorithm>
+
+#include "SampleBlock.h"
+#include "Sequence.h"
+
+namespace {
+
+SummaryPyramid::Summary Combine(
+   const SummaryPyramid::Summary &a, const SummaryPyramid::Summary &b)
+{
+   return {
+      std::min(a.min, b.min),
+      std::max(a.max, b.max),
+      a.sumsq + b.sumsq,
+      a.samples + b.samples
+   };
+}
+
+}
+
+void SummaryPyramid::Invalidate(size_t fromBlock)
+{
+   std::lock_guard<std::mutex> lock{ mMutex };
+   mValid = std::min(mValid, fromBlock);
+}
+
+void SummaryPyramid::Update(const BlockArray &blocks, bool mayThrow)
+{
+   const auto nBlocks = blocks.size();
+   if (mValid == nBlocks && !mLevels.empty() && mLevels[0].size() == nBlocks)
+      return;
+   mValid = std::min(mValid, nBlocks);
+
+   if (mLevels.empty())
+      mLevels.emplace_back();
+
+   // Level 0 from the summaries stored with the blocks
+   auto &leaves = mLevels[0];
+   leaves.resize(nBlocks);
+   // The first block whose summary could not be read
+   auto failed = nBlocks;
+   for (auto b = mValid; b < nBlocks; ++b) {
+      const auto &sb = *blocks[b].sb;
+      MinMaxRMS results;
+      try {
+         results = sb.GetMinMaxRMS();
+      }
+      catch (...) {
+         // mValid is unchanged, so the nodes will be computed again
+         if (mayThrow)
+            throw;
+         failed = std::min(failed, b);
+      }
+      const double samples = sb.GetSampleCount();
+      leaves[b] = { results.min, results.max,
+         double(results.RMS) * results.RMS * samples, samples };
+   }
+
+   // Each level above, from the first node that covers a changed block
+   size_t level = 1;
+   auto first = mValid;
+   for (auto size = nBlocks; size > 1; ++level) {
+      size = (size + 1) / 2;
+      first /= 2;
+      if (mLevels.size() == level)
+         mLevels.emplace_back();
+      const auto &below = mLevels[level - 1];
+      auto &nodes = mLevels[level];
+      nodes.resize(size);
+      for (auto ii = first; ii < size; ++ii)
+         nodes[ii] = (2 * ii + 1 < below.size())
+            ? Combine(below[2 * ii], below[2 * ii + 1])
+            : below[2 * ii];
+   }
+   mLevels.resize(level);
+
+   // Don't keep nodes made without a block's summary
+   mValid = failed;
+}
+
+auto SummaryPyramid::Summarize(
+   const BlockArray &blocks, size_t b0, size_t b1, bool mayThrow) -> Summary
+{
+   std::lock_guard<std::mutex> lock{ mMutex };
+   Update(blocks, mayThrow);
+
+   // Climb the levels, taking the nodes at the ends of the range that
+   // their parents would overrun
+   Summary result{ 0, 0, 0, 0 };
+   bool first = true;
+   const auto take = [&](const Summary &summary){
+      result = first ? summary : Combine(result, summary);
+      first = false;
+   };
+   for (size_t level = 0; b0 < b1; ++level, b0 /= 2, b1 /= 2) {
+      const auto &nodes = mLevels[level];
+      if (b0 & 1)
+         take(nodes[b0++]);
+      if (b1 & 1)
+         take(nodes[--b1]);
+   }
+   return result;
+}
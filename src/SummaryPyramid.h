@@ -0,0 +1,64 @@
+/**********************************************************************
+
+  Tenacity: A Digital Audio Editor
+
+  @file SummaryPyramid.h
+
+  Min, max and RMS of any run of whole blocks of a Sequence
+
+**********************************************************************/
+#ifndef __TENACITY_SUMMARY_PYRAMID__
+#define __TENACITY_SUMMARY_PYRAMID__
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+class BlockArray;
+
+//! Levels of summaries above the whole-block summaries of a Sequence
+/*!
+ Level 0 summarizes each block, from the minimum, maximum and RMS that each
+ sample block already stores, and each node of level k + 1 summarizes two
+ adjacent nodes of level k.  So any run of blocks is summarized by combining
+ at most two nodes of each level, without reading any sample data.
+
+ The Sequence calls Invalidate() when it changes its blocks, and Summarize()
+ recomputes only the nodes above the changed blocks.  Appending blocks costs
+ logarithmic time; other edits cost time in proportion to the blocks after
+ the first changed one.
+ */
+class SummaryPyramid
+{
+public:
+   struct Summary
+   {
+      float min;
+      float max;
+      double sumsq;
+      double samples;
+   };
+
+   //! Forget the summaries of the blocks from this index on
+   void Invalidate(size_t fromBlock);
+
+   //! Summary of blocks [b0, b1), which must be a nonempty range of blocks
+   /*! If not mayThrow, a block whose summary can't be read counts as zeroes,
+    as for display, and is read again next time */
+   Summary Summarize(
+      const BlockArray &blocks, size_t b0, size_t b1, bool mayThrow);
+
+private:
+   void Update(const BlockArray &blocks, bool mayThrow);
+
+   //! mLevels[0] has one node per block, and each level above half as many
+   std::vector<std::vector<Summary>> mLevels;
+   //! Number of blocks whose nodes, and those above them, are up to date
+   size_t mValid{ 0 };
+
+   //! The Sequence invalidates while editing, maybe in a worker thread,
+   //! and summarizes while drawing
+   std::mutex mMutex;
+};
+
+#endif
@@ -66,6 +66,8 @@ It handles initialization and termination by subclassing wxApp.
 #include <lib-files/TenacityLogger.h>
 #include <lib-math/FFT.h>
 #include <lib-preferences/FileConfig.h>
+#include <lib-preferences/Prefs.h>
+#include <lib-utility/TaskScheduler.h>
 
 #include "AboutDialog.h"
 #include "ActiveProject.h"
@@ -1106,6 +1108,12 @@ bool TenacityApp::InitPart2()
       Sequence::SetMaxDiskBlockSize(lval);
    }
 
+   // Fix the threads of the shared task scheduler before anything uses it;
+   // zero means one per hardware thread
+   static IntSetting WorkerThreads{ L"/Performance/WorkerThreads", 0 };
+   const auto workerThreads = WorkerThreads.Read();
+   TaskScheduler::SetThreadBudget(workerThreads > 0 ? workerThreads : 0);
+
    // Make sure the temp dir isn't locked by another process.
    {
       auto key =
@@ -276,6 +276,33 @@ bool UndoManager::RedoAvailable()
    return (current < (int)stack.size() - 1);
 }
 
+//! Copy the tracks for undo history, sharing what did not change with prior
+static std::shared_ptr<TrackList> CopyTracks(
+   const TrackList &tracks, const TrackList *prior)
+{
+   // Copies get new track ids, so pair tracks with the prior state by
+   // position.  That is only a guess at what to compare:  contents are shared
+   // only where they are equal.
+   std::vector<const Track *> priorTracks;
+   if (prior)
+      for (auto t : *prior)
+         priorTracks.push_back(t.get());
+
+   auto tracksCopy = TrackList::Create( nullptr );
+   size_t ii = 0;
+   for (auto t : tracks) {
+      if ( t->GetId() == TrackId{} )
+         // Don't copy a pending added track
+         continue;
+      tracksCopy->Add(ii < priorTracks.size()
+         ? t->SharingDuplicate(*priorTracks[ii])
+         : t->Duplicate());
+      ++ii;
+   }
+
+   return tracksCopy;
+}
+
 void UndoManager::ModifyState(const TrackList * l,
                               const SelectedRegion &selectedRegion,
                               const std::shared_ptr<Tags> &tags)
@@ -285,17 +312,8 @@ void UndoManager::ModifyState(const TrackList * l,
    }
 
 //   SonifyBeginModifyState();
-   // Delete current -- not necessary, but let's reclaim space early
-   stack[current]->state.tracks.reset();
-
-   // Duplicate
-   auto tracksCopy = TrackList::Create( nullptr );
-   for (auto t : *l) {
-      if ( t->GetId() == TrackId{} )
-         // Don't copy a pending added track
-         continue;
-      tracksCopy->Add(t->Duplicate());
-   }
+   // Duplicate, sharing what did not change with the state being replaced
+   auto tracksCopy = CopyTracks(*l, stack[current]->state.tracks.get());
 
    // Replace
    stack[current]->state.tracks = std::move(tracksCopy);
@@ -342,13 +360,9 @@ void UndoManager::PushState(const TrackList * l,
       return;
    }
 
-   auto tracksCopy = TrackList::Create( nullptr );
-   for (auto t : *l) {
-      if ( t->GetId() == TrackId{} )
-         // Don't copy a pending added track
-         continue;
-      tracksCopy->Add(t->Duplicate());
-   }
+   // Duplicate, sharing what did not change with the current state
+   auto tracksCopy = CopyTracks(*l,
+      current >= 0 ? stack[current]->state.tracks.get() : nullptr);
 
    mayConsolidate = true;
 
@@ -8,9 +8,10 @@
 
   After each operation, call UndoManager's PushState, pass it
   the entire track hierarchy.  The UndoManager makes a duplicate
-  of every single track using its Duplicate method, which should
-  increment reference counts.  If we were not at the top of
-  the stack when this is called, DELETE above first.
+  of every single track using its SharingDuplicate method, which
+  shares with the current state whatever did not change, such as
+  unedited clips.  If we were not at the top of the stack when this
+  is called, DELETE above first.
 
   If a minor change is made, for example changing the visual
   display of a track or changing the selection, you can call
@@ -23,7 +23,12 @@
 
 
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <list>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 #include <wx/log.h>
 
@@ -32,6 +37,7 @@
 #include <lib-exceptions/UserException.h>
 #include <lib-math/Resample.h>
 #include <lib-preferences/Prefs.h>
+#include <lib-utility/TaskScheduler.h>
 
 #include "Sequence.h"
 #include "Spectrum.h"
@@ -207,8 +213,38 @@ WaveClip::WaveClip(const WaveClip& orig,
 }
 
 
+namespace {
+//! Discard cached spectrogram tiles of a clip
+void ForgetSpectrogramTiles(const WaveClip *clip);
+}
+
 WaveClip::~WaveClip()
 {
+   // Another clip may later have the same address
+   ForgetSpectrogramTiles(this);
+}
+
+bool WaveClip::SameContents(const WaveClip &other) const
+{
+   // Appended samples not yet flushed are not copied, so never compare equal
+   if (mSequenceOffset != other.mSequenceOffset ||
+       mTrimLeft != other.mTrimLeft ||
+       mTrimRight != other.mTrimRight ||
+       mRate != other.mRate ||
+       mColourIndex != other.mColourIndex ||
+       mName != other.mName ||
+       mIsPlaceholder != other.mIsPlaceholder ||
+       mAppendBufferLen > 0 || other.mAppendBufferLen > 0 ||
+       !mSequence->SameContents(*other.mSequence) ||
+       !mEnvelope->SameContents(*other.mEnvelope) ||
+       mCutLines.size() != other.mCutLines.size())
+      return false;
+
+   for (size_t ii = 0; ii < mCutLines.size(); ++ii)
+      if (!mCutLines[ii]->SameContents(*other.mCutLines[ii]))
+         return false;
+
+   return true;
 }
 
 bool WaveClip::GetSamples(samplePtr buffer, sampleFormat format,
@@ -433,14 +469,14 @@ bool WaveClip::GetWaveDisplay(WaveDisplay &display, double t0,
       if (a < p1) {
          sampleFormat seqFormat = mSequence->GetSampleFormat();
          bool didUpdate = false;
+         // Recording may enlarge the buffer meanwhile
+         std::lock_guard<std::mutex> locker{ mAppendMutex };
          for(auto i = a; i < p1; i++) {
             auto left = std::max(sampleCount{ 0 },
                                  where[i] - numSamples);
             auto right = std::min(sampleCount{ mAppendBufferLen },
                                   where[i + 1] - numSamples);
 
-            //wxCriticalSectionLocker locker(mAppendCriticalSection);
-
             if (right > left) {
                Floats b;
                float *pb{};
@@ -933,6 +969,288 @@ void SpecCache::Populate
    }
 }
 
+namespace {
+
+//! Spectrogram columns are computed and cached in tiles of this many
+enum : size_t { SpectrogramTileColumns = 128 };
+
+//! Megabytes of spectrogram tiles to keep for all clips; 0 disables tiles
+IntSetting SpectrogramCacheSize{ L"/Performance/SpectrogramCacheSize", 256 };
+
+///\brief Identifies a tile of spectrogram columns of a clip
+/*! Besides what SpecCache::Matches() compares, with the zoom compared
+    exactly, this includes the clip's position and trims, which decide what
+    the columns near its edges read from the track. */
+struct SpecTileKey
+{
+   const WaveClip *clip;
+   int dirty;
+   double offset, leftTrim, rightTrim;
+   double pps;
+   int rate;
+   int algorithm;
+   int windowType;
+   size_t windowSize;
+   size_t zeroPaddingFactor;
+   int frequencyGain;
+   //! Column of the first in the tile is index * SpectrogramTileColumns,
+   //! where column zero is at the start of the clip's sequence
+   long long index;
+
+   bool operator == (const SpecTileKey &other) const
+   {
+      return clip == other.clip && dirty == other.dirty &&
+         offset == other.offset &&
+         leftTrim == other.leftTrim && rightTrim == other.rightTrim &&
+         pps == other.pps && rate == other.rate &&
+         algorithm == other.algorithm && windowType == other.windowType &&
+         windowSize == other.windowSize &&
+         zeroPaddingFactor == other.zeroPaddingFactor &&
+         frequencyGain == other.frequencyGain &&
+         index == other.index;
+   }
+};
+
+struct SpecTileKeyHash
+{
+   size_t operator () (const SpecTileKey &key) const
+   {
+      size_t result = std::hash<const void*>{}(key.clip);
+      const auto combine = [&](size_t value) {
+         result ^= value + 0x9e3779b9 + (result << 6) + (result >> 2);
+      };
+      combine(std::hash<int>{}(key.dirty));
+      combine(std::hash<double>{}(key.pps));
+      combine(std::hash<size_t>{}(key.windowSize));
+      combine(std::hash<long long>{}(key.index));
+      return result;
+   }
+};
+
+struct SpecTile
+{
+   //! SpectrogramTileColumns columns of settings.NBins() values
+   std::vector<float> freq;
+   //! Sample positions of the columns, and one past the last
+   std::vector<sampleCount> where;
+
+   size_t Bytes() const
+   {
+      return freq.size() * sizeof(float) + where.size() * sizeof(sampleCount);
+   }
+};
+
+///\brief Size-bounded cache of spectrogram tiles of all clips, discarding
+/// the least recently used first
+/*! Scrolling back and forth, or zooming between a few levels, finds the
+    columns computed before.  All methods are thread-safe. */
+class SpecTileCache
+{
+public:
+   using Tile = std::shared_ptr<const SpecTile>;
+
+   static SpecTileCache &Get()
+   {
+      static SpecTileCache instance{
+         std::max(0, SpectrogramCacheSize.Read()) * size_t(1024 * 1024) };
+      return instance;
+   }
+
+   bool Enabled() const
+   {
+      std::lock_guard<std::mutex> guard{ mMutex };
+      return mBudget > 0;
+   }
+
+   Tile Find(const SpecTileKey &key)
+   {
+      std::lock_guard<std::mutex> guard{ mMutex };
+      auto iter = mIndex.find(key);
+      if (iter == mIndex.end())
+         return {};
+      // Move to the front, without invalidating iterators
+      mList.splice(mList.begin(), mList, iter->second);
+      return iter->second->second;
+   }
+
+   void Insert(const SpecTileKey &key, Tile tile)
+   {
+      std::lock_guard<std::mutex> guard{ mMutex };
+      if (!tile || tile->Bytes() > mBudget || mIndex.count(key))
+         return;
+      mBytes += tile->Bytes();
+      mList.emplace_front(key, std::move(tile));
+      mIndex.emplace(key, mList.begin());
+      while (mBytes > mBudget) {
+         auto &last = mList.back();
+         mBytes -= last.second->Bytes();
+         mIndex.erase(last.first);
+         mList.pop_back();
+      }
+   }
+
+   //! Discard all tiles of a clip
+   void Erase(const WaveClip *clip)
+   {
+      std::lock_guard<std::mutex> guard{ mMutex };
+      for (auto iter = mList.begin(); iter != mList.end();) {
+         if (iter->first.clip == clip) {
+            mBytes -= iter->second->Bytes();
+            mIndex.erase(iter->first);
+            iter = mList.erase(iter);
+         }
+         else
+            ++iter;
+      }
+   }
+
+private:
+   explicit SpecTileCache(size_t budget) : mBudget{ budget } {}
+
+   mutable std::mutex mMutex;
+
+   //! Most recently used at the front
+   using List = std::list< std::pair< SpecTileKey, Tile > >;
+   List mList;
+   std::unordered_map< SpecTileKey, List::iterator, SpecTileKeyHash > mIndex;
+
+   const size_t mBudget;
+   size_t mBytes{ 0 };
+};
+
+void ForgetSpectrogramTiles(const WaveClip *clip)
+{
+   SpecTileCache::Get().Erase(clip);
+}
+
+}
+
+bool WaveClip::GetSpectrogramFromTiles(WaveTrackCache &waveTrackCache,
+                              const float *& spectrogram,
+                              const sampleCount *& where,
+                              size_t numPixels,
+                              double t0, double pixelsPerSecond) const
+{
+   const WaveTrack *const track = waveTrackCache.GetTrack().get();
+   const SpectrogramSettings &settings = track->GetSpectrogramSettings();
+   // Windows and FFT tables are shared by the threads below
+   settings.CacheWindows();
+
+   const auto nBins = settings.NBins();
+   const size_t tileColumns = SpectrogramTileColumns;
+   const double samplesPerPixel = mRate / pixelsPerSecond;
+
+   // Snap the first pixel to the nearest column of the tiling; this
+   // is at most half a pixel from t0, as findCorrection() allows
+   const auto x0 =
+      static_cast<long long>(floor(0.5 + t0 * pixelsPerSecond));
+   const auto floorDiv = [&](long long column) {
+      return column >= 0
+         ? column / (long long)tileColumns
+         : -((-column + (long long)tileColumns - 1) / (long long)tileColumns);
+   };
+   const auto firstTile = floorDiv(x0);
+   const auto lastTile = floorDiv(x0 + (long long)numPixels);
+
+   SpecTileKey key{ this, mDirty,
+      GetSequenceStartTime(), GetTrimLeft(), GetTrimRight(),
+      pixelsPerSecond, mRate,
+      static_cast<int>(settings.algorithm), settings.windowType,
+      settings.WindowSize(), settings.ZeroPaddingFactor(),
+      settings.frequencyGain,
+      0 };
+
+   auto &cache = SpecTileCache::Get();
+   std::vector<SpecTileCache::Tile> tiles;
+   std::vector<std::pair<long long, std::shared_ptr<SpecTile>>> missing;
+   for (auto index = firstTile; index <= lastTile; ++index) {
+      key.index = index;
+      tiles.push_back(cache.Find(key));
+      if (!tiles.back()) {
+         auto tile = std::make_shared<SpecTile>();
+         tile->freq.resize(tileColumns * nBins);
+         tile->where.resize(tileColumns + 1);
+         // As fillWhere() does, offsetting the display 1/2 sample to the
+         // left to properly center response of the FFT
+         const double w0 = 1.0 + index * (double)tileColumns * samplesPerPixel;
+         for (size_t x = 0; x <= tileColumns; ++x)
+            tile->where[x] = sampleCount(floor(w0 + double(x) * samplesPerPixel));
+         missing.emplace_back(index - firstTile, std::move(tile));
+      }
+   }
+
+   if (!missing.empty()) {
+      const auto numSamples = GetSequenceSamplesCount();
+      const auto offset = GetSequenceStartTime();
+      const auto fftLen = settings.GetFFTLength();
+      std::vector<float> gainFactors;
+      if (settings.algorithm != SpectrogramSettings::algPitchEAC)
+         ComputeSpectrogramGainFactors(
+            fftLen, mRate, settings.frequencyGain, gainFactors);
+
+      // Compute the missing tiles on the task scheduler, each task with its own
+      // reader of the track, as the OpenMP loop in SpecCache::Populate()
+      // does.  The track does not change while this thread waits.
+      std::atomic<size_t> next{ 0 };
+      const auto work = [&] {
+         WaveTrackCache reader{ waveTrackCache.GetTrack() };
+         std::vector<float> scratch(fftLen);
+         for (size_t ii; (ii = next++) < missing.size();) {
+            auto &tile = *missing[ii].second;
+            SpecCache columns;
+            columns.len = tileColumns;
+            columns.where = tile.where;
+            for (size_t x = 0; x < tileColumns; ++x)
+               columns.CalculateOneSpectrum(
+                  settings, reader, (int)x, numSamples,
+                  offset, mRate, pixelsPerSecond,
+                  0, (int)tileColumns,
+                  gainFactors, scratch.data(), tile.freq.data());
+         }
+      };
+      const auto nThreads = std::min<size_t>(missing.size(),
+         TaskScheduler::Get().GetThreadCount() + 1);
+      {
+         // Someone is looking at the view, so go before batch work
+         TaskGroup tasks{ TaskGroup::Lane::Interactive };
+         for (size_t ii = 1; ii < nThreads; ++ii)
+            tasks.Run(work);
+         work();
+         tasks.Wait();
+      }
+
+      for (auto &pair : missing) {
+         key.index = firstTile + pair.first;
+         cache.Insert(key, pair.second);
+         tiles[pair.first] = std::move(pair.second);
+      }
+   }
+
+   // Assemble the view in mSpecCache, giving up memory after zooming out
+   if (mSpecCache->freq.capacity() > 2.1 * numPixels * nBins)
+      mSpecCache = std::make_unique<SpecCache>();
+   mSpecCache->Grow(numPixels, settings, pixelsPerSecond, t0);
+   mSpecCache->leftTrim = GetTrimLeft();
+   mSpecCache->rightTrim = GetTrimRight();
+   for (size_t x = 0; x <= numPixels; ++x) {
+      const auto column = x0 + (long long)x - firstTile * (long long)tileColumns;
+      const auto &tile = *tiles[column / tileColumns];
+      const auto tileX = column % tileColumns;
+      mSpecCache->where[x] = tile.where[tileX];
+      if (x < numPixels)
+         std::copy(&tile.freq[nBins * tileX], &tile.freq[nBins * (tileX + 1)],
+            &mSpecCache->freq[nBins * x]);
+   }
+   // Be careful to make the first value non-negative
+   mSpecCache->where[0] = std::max<sampleCount>(0, mSpecCache->where[0]);
+
+   mSpecCache->dirty = mDirty;
+   spectrogram = &mSpecCache->freq[0];
+   where = &mSpecCache->where[0];
+
+   return true;
+}
+
 bool WaveClip::GetSpectrogram(WaveTrackCache &waveTrackCache,
                               const float *& spectrogram,
                               const sampleCount *& where,
@@ -963,6 +1281,11 @@ bool WaveClip::GetSpectrogram(WaveTrackCache &waveTrackCache,
       return false;  //hit cache completely
    }
 
+   if (settings.algorithm != SpectrogramSettings::algReassignment &&
+       SpecTileCache::Get().Enabled())
+      return GetSpectrogramFromTiles(waveTrackCache, spectrogram, where,
+         numPixels, t0, pixelsPerSecond);
+
    // Caching is not implemented for reassignment, unless for
    // a complete hit, because of the complications of time reassignment
    if (settings.algorithm == SpectrogramSettings::algReassignment)
@@ -1135,8 +1458,10 @@ bool WaveClip::Append(constSamplePtr buffer, sampleFormat format,
    auto blockSize = mSequence->GetIdealAppendLen();
    sampleFormat seqFormat = mSequence->GetSampleFormat();
 
-   if (!mAppendBuffer.ptr())
+   if (!mAppendBuffer.ptr()) {
       mAppendBuffer.Allocate(maxBlockSize, seqFormat);
+      mAppendBufferSize = maxBlockSize;
+   }
 
    auto cleanup = finally( [&] {
       // use No-fail-guarantee
@@ -1145,7 +1470,8 @@ bool WaveClip::Append(constSamplePtr buffer, sampleFormat format,
    } );
 
    for(;;) {
-      if (mAppendBufferLen >= blockSize) {
+      // (More than one block may remain after AppendToBuffer())
+      while (mAppendBufferLen >= blockSize) {
          // flush some previously appended contents
          // use Strong-guarantee
          mSequence->Append(mAppendBuffer.ptr(), seqFormat, blockSize);
@@ -1181,6 +1507,51 @@ bool WaveClip::Append(constSamplePtr buffer, sampleFormat format,
    return result;
 }
 
+/*! @excsafety{Partial}
+ -- If memory runs out while enlarging the append buffer, its contents may be
+ lost, but no content already flushed is lost. */
+void WaveClip::AppendToBuffer(constSamplePtr buffer, sampleFormat format,
+                              size_t len, unsigned int stride)
+{
+   const auto seqFormat = mSequence->GetSampleFormat();
+   const auto sampleSize = SAMPLE_SIZE(seqFormat);
+
+   const auto needed = mAppendBufferLen + len;
+   if (!mAppendBuffer.ptr() || needed > mAppendBufferSize) {
+      // Grow geometrically, keeping the contents, while the display waits
+      std::lock_guard<std::mutex> locker{ mAppendMutex };
+      const auto size = std::max({ needed,
+         2 * mAppendBufferSize, mSequence->GetMaxBlockSize() });
+      SampleBuffer saved(mAppendBufferLen, seqFormat);
+      if (mAppendBufferLen > 0) {
+         if (!saved.ptr())
+            throw std::bad_alloc{};
+         memcpy(saved.ptr(), mAppendBuffer.ptr(),
+            mAppendBufferLen * sampleSize);
+      }
+      if (!mAppendBuffer.Allocate(size, seqFormat).ptr()) {
+         mAppendBufferLen = 0;
+         mAppendBufferSize = 0;
+         throw std::bad_alloc{};
+      }
+      mAppendBufferSize = size;
+      if (mAppendBufferLen > 0)
+         memcpy(mAppendBuffer.ptr(), saved.ptr(),
+            mAppendBufferLen * sampleSize);
+   }
+
+   CopySamples(buffer, format,
+               mAppendBuffer.ptr() + mAppendBufferLen * sampleSize,
+               seqFormat,
+               len,
+               gHighQualityDither,
+               stride);
+   mAppendBufferLen += len;
+
+   UpdateEnvelopeTrackLen();
+   MarkChanged();
+}
+
 /*! @excsafety{Mixed} */
 /*! @excsafety{No-fail} -- The clip will be in a flushed state. */
 /*! @excsafety{Partial}
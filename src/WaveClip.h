@@ -21,6 +21,7 @@
 
 #include <vector>
 #include <functional>
+#include <mutex>
 
 class BlockArray;
 class Envelope;
@@ -195,6 +196,9 @@ public:
 
    virtual ~WaveClip();
 
+   //! Whether a copy of this clip, with its cutlines, would equal other
+   bool SameContents(const WaveClip &other) const;
+
    void ConvertToSampleFormat(sampleFormat format,
       const std::function<void(size_t)> & progressReport = {});
 
@@ -319,6 +323,12 @@ public:
    /// Flush must be called after last Append
    void Flush();
 
+   //! Like Append(), but leave all samples in the append buffer, enlarging it
+   /*! AppendBatch::Store() then stores the full blocks, as Append() would
+    have, and Flush() must still be called after the last append */
+   void AppendToBuffer(constSamplePtr buffer, sampleFormat format,
+               size_t len, unsigned int stride);
+
    /// This name is consistent with WaveTrack::Clear. It performs a "Cut"
    /// operation (but without putting the cut audio to the clipboard)
    void Clear(double t0, double t1);
@@ -407,6 +417,14 @@ public:
    mutable std::unique_ptr<SpecPxCache> mSpecPxCache;
 
 protected:
+   //! GetSpectrogram() by way of tiles of columns shared among views
+   /*! @pre t0 already includes the left trim */
+   bool GetSpectrogramFromTiles(WaveTrackCache &cache,
+                       const float *& spectrogram,
+                       const sampleCount *& where,
+                       size_t numPixels,
+                       double t0, double pixelsPerSecond) const;
+
    /// This name is consistent with WaveTrack::Clear. It performs a "Cut"
    /// operation (but without putting the cut audio to the clipboard)
    void ClearSequence(double t0, double t1);
@@ -428,6 +446,11 @@ protected:
    mutable std::unique_ptr<SpecCache> mSpecCache;
    SampleBuffer  mAppendBuffer {};
    size_t        mAppendBufferLen { 0 };
+   //! Capacity of mAppendBuffer, which AppendToBuffer() may enlarge
+   size_t        mAppendBufferSize { 0 };
+   //! Held by AppendToBuffer() on the recording thread while it enlarges
+   //! mAppendBuffer, and by GetWaveDisplay() while it reads that buffer
+   mutable std::mutex mAppendMutex;
 
    // Cut Lines are nothing more than ordinary wave clips, with the
    // offset relative to the start of the clip.
@@ -437,6 +460,8 @@ protected:
    bool mIsPlaceholder { false };
 
 private:
+   friend class AppendBatch;
+
    wxString mName;
 };
 
@@ -38,14 +38,19 @@ from the project that will own the track.
 #include <cfloat>
 #include <cmath>
 #include <algorithm>
+#include <condition_variable>
+#include <mutex>
 #include <optional>
+#include <unordered_map>
 
 // Tenacity libraries
 #include <lib-exceptions/InconsistencyException.h>
 #include <lib-math/float_cast.h>
 #include <lib-preferences/Prefs.h>
+#include <lib-utility/TaskScheduler.h>
 
 #include "Envelope.h"
+#include "SampleBlock.h"
 #include "Sequence.h"
 
 #include "Project.h"
@@ -151,7 +156,12 @@ WaveTrack::WaveTrack( const SampleBlockFactoryPtr &pFactory,
    mLastdBRange = -1;
 }
 
-WaveTrack::WaveTrack(const WaveTrack &orig):
+WaveTrack::WaveTrack(const WaveTrack &orig)
+   : WaveTrack(orig, nullptr)
+{
+}
+
+WaveTrack::WaveTrack(const WaveTrack &orig, const WaveTrack *pPrior):
    PlayableTrack(orig)
    , mpFactory( orig.mpFactory )
    , mpSpectrumSettings(orig.mpSpectrumSettings
@@ -170,9 +180,31 @@ WaveTrack::WaveTrack(const WaveTrack &orig):
 
    Init(orig);
 
+   // Index the clips of the prior copy by first sample block, to find those
+   // that can be shared rather than copied again
+   const auto firstBlock = [](const WaveClip &clip) -> const SampleBlock * {
+      auto &blocks = clip.GetSequence()->GetBlockArray();
+      return blocks.empty() ? nullptr : blocks.front().sb.get();
+   };
+   std::unordered_multimap<const SampleBlock *, WaveClipHolder> priorClips;
+   if (pPrior)
+      for (const auto &clip : pPrior->mClips)
+         priorClips.emplace(firstBlock(*clip), clip);
+
    for (const auto &clip : orig.mClips)
-      mClips.push_back
-         ( std::make_unique<WaveClip>( *clip, mpFactory, true ) );
+   {
+      auto range = priorClips.equal_range(firstBlock(*clip));
+      auto match = std::find_if(range.first, range.second,
+         [&](const auto &pair){ return clip->SameContents(*pair.second); });
+      if (match != range.second)
+      {
+         mClips.push_back(match->second);
+         priorClips.erase(match);
+      }
+      else
+         mClips.push_back
+            ( std::make_unique<WaveClip>( *clip, mpFactory, true ) );
+   }
 }
 
 // Copy the track metadata but not the contents.
@@ -452,6 +484,14 @@ Track::Holder WaveTrack::Clone() const
    return std::make_shared<WaveTrack>( *this );
 }
 
+Track::Holder WaveTrack::SharingClone(const Track &prior) const
+{
+   if (auto pPrior = track_cast<const WaveTrack *>(&prior))
+      // The constructor is private, so std::make_shared cannot use it
+      return std::shared_ptr<WaveTrack>{ safenew WaveTrack(*this, pPrior) };
+   return Clone();
+}
+
 wxString WaveTrack::MakeClipCopyName(const wxString& originalName) const
 {
    auto name = originalName;
@@ -1764,6 +1804,15 @@ bool WaveTrack::Append(constSamplePtr buffer, sampleFormat format,
    return RightmostOrNewClip()->Append(buffer, format, len, stride);
 }
 
+/*! @excsafety{Partial} -- No content already flushed is lost. */
+WaveClip *WaveTrack::AppendToBuffer(constSamplePtr buffer, sampleFormat format,
+                       size_t len, unsigned int stride /* = 1 */)
+{
+   const auto pClip = RightmostOrNewClip();
+   pClip->AppendToBuffer(buffer, format, len, stride);
+   return pClip;
+}
+
 sampleCount WaveTrack::GetBlockStart(sampleCount s) const
 {
    for (const auto &clip : mClips)
@@ -2191,6 +2240,18 @@ bool WaveTrack::Get(samplePtr buffer, sampleFormat format,
    return result;
 }
 
+SampleSpan WaveTrack::GetFloatSpan(sampleCount start, size_t len) const
+{
+   for (const auto &clip: mClips)
+   {
+      if (start >= clip->GetPlayStartSample() &&
+          start + len <= clip->GetPlayEndSample())
+         return clip->GetSequence()->GetSpan(
+            floatSample, clip->ToSequenceSamples(start), len);
+   }
+   return {};
+}
+
 /*! @excsafety{Weak} */
 void WaveTrack::Set(constSamplePtr buffer, sampleFormat format,
                     sampleCount start, size_t len)
@@ -2737,8 +2798,78 @@ void WaveTrack::ClearWaveCaches()
       clip->ClearWaveCache();
 }
 
+//! Ring of buffers filled on the task scheduler for one WaveTrackCache
+struct WaveTrackCache::ReadAhead
+{
+   enum class State { Free, Pending, Busy, Ready };
+   struct Slot {
+      Floats data;
+      sampleCount start{ 0 };
+      size_t len{ 0 };
+      //! Only the reading thread touches data while Busy
+      State state{ State::Free };
+   };
+
+   ReadAhead(const std::shared_ptr<const WaveTrack> &pTrack,
+      size_t depth, size_t bufferSize)
+      : pTrack{ pTrack }
+      , slots( depth )
+   {
+      for (auto &slot : slots)
+         slot.data = Floats{ bufferSize };
+   }
+
+   //! Called in a worker thread
+   void Load(size_t iSlot)
+   {
+      std::unique_lock<std::mutex> lock{ mutex };
+      auto &slot = slots[iSlot];
+      // The slot may have been taken, or already loaded by another job
+      if (slot.state != State::Pending)
+         return;
+      slot.state = State::Busy;
+      const auto start = slot.start;
+      const auto len = slot.len;
+      const auto buffer = slot.data.get();
+      lock.unlock();
+
+      bool success = false;
+      try {
+         success = pTrack->GetFloats(buffer, start, len, fillZero, false);
+      }
+      catch (...) {
+         // The synchronous read will report it
+      }
+
+      lock.lock();
+      slot.state = success ? State::Ready : State::Free;
+      loaded.notify_all();
+   }
+
+   //! Skip the reads not yet started, and wait for those in progress, so
+   //! that the track may change
+   void Stop()
+   {
+      std::unique_lock<std::mutex> lock{ mutex };
+      for (auto &slot : slots)
+         if (slot.state == State::Pending)
+            slot.state = State::Free;
+      loaded.wait(lock, [this]{
+         return std::none_of(slots.begin(), slots.end(),
+            [](const Slot &slot){ return slot.state == State::Busy; });
+      });
+   }
+
+   const std::shared_ptr<const WaveTrack> pTrack;
+   std::mutex mutex;
+   std::condition_variable loaded;
+   std::vector<Slot> slots;
+   ReadAheadStatistics statistics;
+};
+
 WaveTrackCache::~WaveTrackCache()
 {
+   SetReadAhead(0);
 }
 
 void WaveTrackCache::SetTrack(const std::shared_ptr<const WaveTrack> &pTrack)
@@ -2755,9 +2886,145 @@ void WaveTrackCache::SetTrack(const std::shared_ptr<const WaveTrack> &pTrack)
       }
       else
          Free();
+      const auto depth = mpReadAhead ? mpReadAhead->slots.size() : 0;
       mPTrack = pTrack;
       mNValidBuffers = 0;
+      // Orphan any jobs for the previous track
+      SetReadAhead(0);
+      SetReadAhead(depth);
+   }
+}
+
+void WaveTrackCache::SetReadAhead(size_t depth)
+{
+   if (mpReadAhead && (depth == 0 || !mPTrack ||
+       mpReadAhead->slots.size() != depth)) {
+      mpReadAhead->Stop();
+      mpReadAhead.reset();
    }
+   if (depth > 0 && mPTrack && !mpReadAhead)
+      mpReadAhead = std::make_shared<ReadAhead>(mPTrack, depth, mBufferSize);
+}
+
+auto WaveTrackCache::GetReadAheadStatistics() const -> ReadAheadStatistics
+{
+   if (!mpReadAhead)
+      return {};
+   std::lock_guard<std::mutex> guard{ mpReadAhead->mutex };
+   return mpReadAhead->statistics;
+}
+
+bool WaveTrackCache::Fill(
+   Buffer &buffer, sampleCount start, size_t len, bool mayThrow)
+{
+   buffer.ResetView();
+
+   if (mpReadAhead) {
+      auto &readAhead = *mpReadAhead;
+      std::lock_guard<std::mutex> guard{ readAhead.mutex };
+      for (auto &slot : readAhead.slots) {
+         if (slot.state == ReadAhead::State::Ready &&
+             slot.start == start && slot.len == len) {
+            // Exchange storage; the slot gets our stale buffer to reuse
+            buffer.data.swap(slot.data);
+            slot.state = ReadAhead::State::Free;
+            buffer.start = start;
+            buffer.len = len;
+            ++readAhead.statistics.hits;
+            return true;
+         }
+      }
+      ++readAhead.statistics.misses;
+   }
+
+   // Otherwise view the samples in place, if they lie in one block
+   if (auto span = mPTrack->GetFloatSpan(start, len)) {
+      buffer.view = reinterpret_cast<const float*>(span.data);
+      buffer.viewOwner = std::move(span.owner);
+      buffer.start = start;
+      buffer.len = len;
+      return true;
+   }
+
+   if (!mPTrack->GetFloats(buffer.data.get(), start, len, fillZero, mayThrow))
+      return false;
+   buffer.start = start;
+   buffer.len = len;
+   return true;
+}
+
+void WaveTrackCache::ScheduleReadAhead(bool backwards)
+{
+   auto &readAhead = *mpReadAhead;
+   const auto depth = readAhead.slots.size();
+
+   // Find the blocks adjacent to the cached ones, stopping at clip edges
+   std::vector< std::pair<sampleCount, size_t> > wanted;
+   if (mNValidBuffers > 0 && !backwards) {
+      auto pos = mBuffers[mNValidBuffers - 1].end();
+      while (wanted.size() < depth) {
+         const auto start = mPTrack->GetBlockStart(pos);
+         if (start != pos)
+            break;
+         const auto len = mPTrack->GetBestBlockSize(start);
+         wanted.emplace_back(start, len);
+         pos = start + len;
+      }
+   }
+   else if (mNValidBuffers > 0) {
+      auto pos = mBuffers[0].start;
+      while (wanted.size() < depth && pos > 0) {
+         const auto start = mPTrack->GetBlockStart(pos - 1);
+         if (start < 0)
+            break;
+         const auto len = mPTrack->GetBestBlockSize(start);
+         if (start + len != pos)
+            break;
+         wanted.emplace_back(start, len);
+         pos = start;
+      }
+   }
+
+   const auto isWanted = [&](const ReadAhead::Slot &slot){
+      return wanted.end() != std::find(wanted.begin(), wanted.end(),
+         std::make_pair(slot.start, slot.len));
+   };
+
+   std::vector<size_t> jobs;
+   {
+      std::lock_guard<std::mutex> guard{ readAhead.mutex };
+      auto &slots = readAhead.slots;
+      for (const auto &block : wanted) {
+         auto present = std::find_if(slots.begin(), slots.end(),
+            [&](const ReadAhead::Slot &slot){
+               return slot.state != ReadAhead::State::Free &&
+                  slot.start == block.first && slot.len == block.second;
+            });
+         if (present != slots.end())
+            continue;
+         // Recycle a slot that is not wanted and not being read
+         auto recycled = std::find_if(slots.begin(), slots.end(),
+            [&](const ReadAhead::Slot &slot){
+               return slot.state == ReadAhead::State::Free ||
+                  (slot.state != ReadAhead::State::Busy && !isWanted(slot));
+            });
+         if (recycled == slots.end())
+            break;
+         recycled->start = block.first;
+         recycled->len = block.second;
+         recycled->state = ReadAhead::State::Pending;
+         jobs.push_back(recycled - slots.begin());
+      }
+   }
+
+   // Playback waits for these, so they go before batch work.  No TaskGroup
+   // waits for them:  Stop() skips those not yet started
+   std::weak_ptr<ReadAhead> wReadAhead = mpReadAhead;
+   for (auto iSlot : jobs)
+      TaskScheduler::Get().Submit([wReadAhead, iSlot]{
+         if (auto pReadAhead = wReadAhead.lock())
+            pReadAhead->Load(iSlot);
+      }, TaskScheduler::Lane::Interactive);
 }
 
 const float *WaveTrackCache::GetFloats(
@@ -2806,18 +3073,18 @@ const float *WaveTrackCache::GetFloats(
          mNValidBuffers = 0;
       }
 
+      const bool backwards = start < mLastStart;
+      mLastStart = start;
+      const bool refilled = fillFirst || fillSecond;
+
       // Refill buffers as needed
       if (fillFirst) {
          const auto start0 = mPTrack->GetBlockStart(start);
          if (start0 >= 0) {
             const auto len0 = mPTrack->GetBestBlockSize(start0);
             wxASSERT(len0 <= mBufferSize);
-            if (!mPTrack->GetFloats(
-                  mBuffers[0].data.get(), start0, len0,
-                  fillZero, mayThrow))
+            if (!Fill(mBuffers[0], start0, len0, mayThrow))
                return nullptr;
-            mBuffers[0].start = start0;
-            mBuffers[0].len = len0;
             if (!fillSecond &&
                 mBuffers[0].end() != mBuffers[1].start)
                fillSecond = true;
@@ -2840,16 +3107,18 @@ const float *WaveTrackCache::GetFloats(
             if (start1 == end0) {
                const auto len1 = mPTrack->GetBestBlockSize(start1);
                wxASSERT(len1 <= mBufferSize);
-               if (!mPTrack->GetFloats(mBuffers[1].data.get(), start1, len1, fillZero, mayThrow))
+               if (!Fill(mBuffers[1], start1, len1, mayThrow))
                   return nullptr;
-               mBuffers[1].start = start1;
-               mBuffers[1].len = len1;
                mNValidBuffers = 2;
             }
          }
       }
       wxASSERT(mNValidBuffers < 2 || mBuffers[0].end() == mBuffers[1].start);
 
+      // Only crossing into new blocks changes what should be read ahead
+      if (mpReadAhead && refilled)
+         ScheduleReadAhead(backwards);
+
       samplePtr buffer = nullptr; // will point into mOverlapBuffer
       auto remaining = len;
 
@@ -2890,7 +3159,7 @@ const float *WaveTrackCache::GetFloats(
             // All is contiguous already.  We can completely avoid copying
             // leni is nonnegative, therefore start falls within mBuffers[ii],
             // so starti is bounded between 0 and buffer length
-            return mBuffers[ii].data.get() + starti.as_size_t() ;
+            return mBuffers[ii].ptr() + starti.as_size_t() ;
          }
          else if (leni > 0) {
             // leni is nonnegative, therefore start falls within mBuffers[ii]
@@ -2902,7 +3171,7 @@ const float *WaveTrackCache::GetFloats(
             // leni is positive and not more than remaining
             const size_t size = sizeof(float) * leni.as_size_t();
             // starti is less than mBuffers[ii].len and nonnegative
-            memcpy(buffer, mBuffers[ii].data.get() + starti.as_size_t(), size);
+            memcpy(buffer, mBuffers[ii].ptr() + starti.as_size_t(), size);
             wxASSERT( leni <= remaining );
             remaining -= leni.as_size_t();
             start += leni;
@@ -34,6 +34,7 @@ class TimeWarper;
 
 class Sequence;
 class WaveClip;
+struct SampleSpan;
 
 // Array of pointers that assume ownership
 using WaveClipHolder = std::shared_ptr< WaveClip >;
@@ -87,9 +88,13 @@ public:
    // settings
    void Reinit(const WaveTrack &orig);
 private:
+   //! Copy orig, but share the clips of pPrior (if not null) that are the same
+   WaveTrack(const WaveTrack &orig, const WaveTrack *pPrior);
+
    void Init(const WaveTrack &orig);
 
    Track::Holder Clone() const override;
+   Track::Holder SharingClone(const Track &prior) const override;
 
    friend class WaveTrackFactory;
 
@@ -244,6 +249,11 @@ private:
    /// Flush must be called after last Append
    void Flush();
 
+   //! Like Append(), but leave the storing of full blocks to AppendBatch
+   /*! @return the clip to pass to AppendBatch::Store() */
+   WaveClip *AppendToBuffer(constSamplePtr buffer, sampleFormat format,
+               size_t len, unsigned int stride=1);
+
    ///Invalidates all clips' wavecaches.  Careful, This may not be threadsafe.
    void ClearWaveCaches();
 
@@ -291,6 +301,11 @@ private:
       // contiguous range.
       sampleCount * pNumWithinClips = nullptr) const;
 
+   //! View of float samples without copying, if they lie within one
+   //! sample block of one clip; else an empty span
+   /*! @copydetails WaveTrack::GetFloats() */
+   SampleSpan GetFloatSpan(sampleCount start, size_t len) const;
+
    void Set(constSamplePtr buffer, sampleFormat format,
                    sampleCount start, size_t len);
 
@@ -654,6 +669,7 @@ public:
    {
       SetTrack(pTrack);
    }
+   //! Waits for the reads ahead in progress
    ~WaveTrackCache();
 
    const std::shared_ptr<const WaveTrack>& GetTrack() const { return mPTrack; }
@@ -665,6 +681,19 @@ public:
    */
    const float *GetFloats(sampleCount start, size_t len, bool mayThrow);
 
+   struct ReadAheadStatistics {
+      size_t hits = 0;   //!< Blocks taken from the read-ahead ring
+      size_t misses = 0; //!< Blocks read synchronously in GetFloats()
+   };
+
+   //! Prefetch blocks beyond those last fetched, in the direction of access
+   /*! Up to depth blocks are read by background threads into a ring of
+    buffers, from which GetFloats() takes them when it would otherwise read
+    the track.  Zero, the default, disables read-ahead.  Changing the depth
+    waits for the reads in progress, so that the track may then change. */
+   void SetReadAhead(size_t depth);
+   ReadAheadStatistics GetReadAheadStatistics() const;
+
 private:
    void Free();
 
@@ -672,24 +701,41 @@ private:
       Floats data;
       sampleCount start;
       sampleCount len;
+      //! If not null, samples are viewed in storage instead of copied to data
+      const float *view{};
+      std::shared_ptr<const void> viewOwner;
 
       Buffer() : start(0), len(0) {}
-      void Free() { data.reset(); start = 0; len = 0; }
+      void Free() { data.reset(); start = 0; len = 0; ResetView(); }
+      void ResetView() { view = nullptr; viewOwner.reset(); }
       sampleCount end() const { return start + len; }
+      const float *ptr() const { return view ? view : data.get(); }
 
       void swap ( Buffer &other )
       {
          data .swap ( other.data );
          std::swap( start, other.start );
          std::swap( len, other.len );
+         std::swap( view, other.view );
+         viewOwner .swap ( other.viewOwner );
       }
    };
 
+   //! Read one block into buffer, or take it from the read-ahead ring
+   bool Fill(Buffer &buffer, sampleCount start, size_t len, bool mayThrow);
+   //! Request read-ahead of the blocks next after the valid buffers
+   void ScheduleReadAhead(bool backwards);
+
    std::shared_ptr<const WaveTrack> mPTrack;
    size_t mBufferSize;
    Buffer mBuffers[2];
    GrowableSampleBuffer mOverlapBuffer;
    int mNValidBuffers;
+
+   struct ReadAhead;
+   //! Shared with read-ahead jobs, which hold it weakly
+   std::shared_ptr<ReadAhead> mpReadAhead;
+   sampleCount mLastStart{ 0 };
 };
 
 #include <unordered_set>
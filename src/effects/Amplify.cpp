@@ -132,6 +132,30 @@ size_t EffectAmplify::ProcessBlock(float **inBlock, float **outBlock, size_t blo
 
    return blockLen;
 }
+
+// Amplify is not offered as a realtime effect, but its stateless processor
+// serves for processing tracks in parallel
+
+bool EffectAmplify::RealtimeInitialize()
+{
+   SetBlockSize(512);
+
+   return true;
+}
+
+size_t EffectAmplify::RealtimeProcess(int WXUNUSED(group),
+                                           float **inbuf,
+                                           float **outbuf,
+                                           size_t numSamples)
+{
+   return ProcessBlock(inbuf, outbuf, numSamples);
+}
+
+bool EffectAmplify::SupportsParallelProcessing()
+{
+   return true;
+}
+
 bool EffectAmplify::DefineParams( ShuttleParams & S ){
    S.SHUTTLE_PARAM( mRatio, Ratio );
    if (!IsBatchProcessing())
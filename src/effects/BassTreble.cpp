@@ -176,6 +176,12 @@ size_t EffectBassTreble::RealtimeProcess(int group,
 {
    return InstanceProcess(mSlaves[group], inbuf, outbuf, numSamples);
 }
+
+bool EffectBassTreble::SupportsParallelProcessing()
+{
+   // Processors share only the parameters
+   return true;
+}
 bool EffectBassTreble::DefineParams( ShuttleParams & S ){
    S.SHUTTLE_PARAM( mBass, Bass );
    S.SHUTTLE_PARAM( mTreble, Treble );
@@ -67,6 +67,7 @@ public:
                                float **inbuf,
                                float **outbuf,
                                size_t numSamples) override;
+   bool SupportsParallelProcessing() override;
    bool DefineParams( ShuttleParams & S ) override;
 
 
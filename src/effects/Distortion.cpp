@@ -275,6 +275,12 @@ size_t EffectDistortion::RealtimeProcess(int group,
 
    return InstanceProcess(mSlaves[group], inbuf, outbuf, numSamples);
 }
+
+bool EffectDistortion::SupportsParallelProcessing()
+{
+   // Processors share only the parameters
+   return true;
+}
 bool EffectDistortion::DefineParams( ShuttleParams & S ){
    S.SHUTTLE_ENUM_PARAM( mParams.mTableChoiceIndx, TableTypeIndx,
       kTableTypeStrings, nTableTypes );
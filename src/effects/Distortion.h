@@ -89,6 +89,7 @@ public:
                                float **inbuf,
                                float **outbuf,
                                size_t numSamples) override;
+   bool SupportsParallelProcessing() override;
    bool DefineParams( ShuttleParams & S ) override;
 
    // Effect implementation
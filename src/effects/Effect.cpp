@@ -26,7 +26,9 @@
 
 // Tenacity libraries
 #include <lib-files/wxFileNameWrapper.h>
+#include <lib-preferences/Prefs.h>
 #include <lib-screen-geometry/ViewInfo.h>
+#include <lib-utility/TaskScheduler.h>
 
 #include "../AudioIO.h"
 #include "widgets/wxWidgetsBasicUI.h"
@@ -47,6 +49,7 @@
 #include "../widgets/NumericTextCtrl.h"
 #include "../widgets/AudacityMessageBox.h"
 
+#include <atomic>
 #include <unordered_map>
 
 // Effect application counter
@@ -465,6 +468,16 @@ bool Effect::RealtimeProcessEnd() noexcept
    return true;
 }
 
+bool Effect::SupportsParallelProcessing()
+{
+   if (mClient)
+   {
+      return mClient->SupportsParallelProcessing();
+   }
+
+   return false;
+}
+
 int Effect::ShowClientInterface(
    wxWindow &parent, wxDialog &dialog, bool forceModal)
 {
@@ -1184,8 +1197,25 @@ bool Effect::Process()
    return bGoodResult;
 }
 
+//! Number of threads for effects that SupportsParallelProcessing(); 0 means
+//! as many as the task scheduler has
+static IntSetting EffectThreads{ L"/Performance/EffectThreads", 0 };
+
+unsigned Effect::ParallelEffectThreads()
+{
+   const auto threads = EffectThreads.Read();
+   if (threads > 0)
+      return threads;
+   return TaskScheduler::Get().GetThreadCount();
+}
+
 bool Effect::ProcessPass()
 {
+   if (GetType() == EffectTypeProcess && SupportsParallelProcessing() &&
+       ParallelEffectThreads() > 1 &&
+       (mNumAudioIn > 1 ? mNumGroups : mNumTracks) > 1)
+      return ProcessParallelPass();
+
    bool bGoodResult = true;
    bool isGenerator = GetType() == EffectTypeGenerate;
 
@@ -1332,6 +1362,169 @@ bool Effect::ProcessPass()
    return bGoodResult;
 }
 
+// The groups of channels are given to worker threads in batches of one group
+// per thread, each group with its own realtime processor.  The workers read
+// and process the next chunk of every group in the batch, then this thread
+// writes them, because sample blocks may be made only here.
+bool Effect::ProcessParallelPass()
+{
+   struct Group {
+      WaveTrack *left{}, *right{};
+      unsigned numChannels{ 0 };
+      sampleCount start, len, done;
+   };
+   std::vector<Group> groups;
+
+   const bool multichannel = mNumAudioIn > 1;
+   auto range = multichannel
+      ? mOutputTracks->Leaders()
+      : mOutputTracks->Any();
+   range.Visit(
+      [&](WaveTrack *left, const Track::Fallthrough &fallthrough) {
+         if (!left->GetSelected())
+            return fallthrough();
+
+         // Group the channels as ProcessPass() does
+         Group group;
+         group.left = left;
+         for (auto channel :
+              TrackList::Channels(left).StartingWith(left)) {
+            ++group.numChannels;
+
+            if (! multichannel)
+               break;
+
+            if (group.numChannels == 2) {
+               // TODO: more-than-two-channels
+               group.right = channel;
+               break;
+            }
+         }
+
+         GetBounds(*left, group.right, &group.start, &group.len);
+         groups.push_back(group);
+      },
+      [&](Track *t) {
+         if (SyncLock::IsSyncLockSelected(t))
+            t->SyncLockAdjust(mT1, mT0 + mDuration);
+      }
+   );
+
+   if (!RealtimeInitialize())
+      return false;
+   auto cleanup = finally( [&] { RealtimeFinalize(); } );
+
+   sampleCount total = 0;
+   for (auto &group : groups) {
+      if (!RealtimeAddProcessor(group.numChannels, group.left->GetRate()))
+         return false;
+      total += group.len;
+   }
+
+   // Chunks are at least as long as the longest sample block, so that
+   // Set() rereads few partly covered blocks, and are whole processing blocks
+   const auto blockSize = std::max<size_t>(mBlockSize, 1);
+   size_t chunk = 1;
+   for (auto &group : groups)
+      chunk = std::max(chunk, group.left->GetMaxBlockSize());
+   chunk = ((chunk + (blockSize - 1)) / blockSize) * blockSize;
+
+   // Buffers of each thread, always as many as the client expects
+   const auto nThreads = std::min<size_t>(ParallelEffectThreads(), groups.size());
+   struct Buffers {
+      FloatBuffers in, out;
+      ArrayOf<float *> inPos, outPos;
+      size_t count{ 0 };
+   };
+   std::vector<Buffers> buffers(nThreads);
+   for (auto &buffer : buffers) {
+      buffer.in.reinit(mNumAudioIn, chunk, true);
+      buffer.out.reinit(mNumAudioOut, chunk);
+      buffer.inPos.reinit(mNumAudioIn);
+      buffer.outPos.reinit(mNumAudioOut);
+   }
+
+   // Read and process the next chunk of one group, on any thread
+   const auto processChunk = [&](size_t iGroup, Buffers &buffer) {
+      auto &group = groups[iGroup];
+      const auto count = limitSampleBufferSize(chunk, group.len - group.done);
+      buffer.count = count;
+      if (count == 0)
+         return;
+
+      const auto pos = group.start + group.done;
+      group.left->GetFloats(buffer.in[0].get(), pos, count);
+      if (group.right)
+         group.right->GetFloats(buffer.in[1].get(), pos, count);
+      else if (mNumAudioIn > 1)
+         // This thread's previous group might have been stereo
+         std::fill(buffer.in[1].get(), buffer.in[1].get() + count, 0.0f);
+
+      for (size_t offset = 0; offset < count; offset += blockSize) {
+         for (size_t i = 0; i < mNumAudioIn; i++)
+            buffer.inPos[i] = buffer.in[i].get() + offset;
+         for (size_t i = 0; i < mNumAudioOut; i++)
+            buffer.outPos[i] = buffer.out[i].get() + offset;
+         RealtimeProcess(static_cast<int>(iGroup),
+            buffer.inPos.get(), buffer.outPos.get(),
+            std::min(blockSize, count - offset));
+      }
+   };
+
+   sampleCount done = 0;
+   for (size_t first = 0; first < groups.size(); first += nThreads) {
+      const auto last = std::min(groups.size(), first + nThreads);
+
+      for (bool more = true; more;) {
+         std::atomic<bool> failed{ false };
+         TaskGroup tasks;
+         tasks.ParallelFor(last - first, [&](size_t ii) {
+            if (failed)
+               return;
+            try {
+               processChunk(first + ii, buffers[ii]);
+            }
+            catch (const TenacityException &) {
+               // Pass this along to our application-level handler
+               failed = true;
+               throw;
+            }
+            catch (...) {
+               // As in ProcessTrack(), other exceptions just fail
+               failed = true;
+            }
+         });
+         if (failed)
+            return false;
+
+         more = false;
+         for (auto ii = first; ii < last; ++ii) {
+            auto &group = groups[ii];
+            const auto &buffer = buffers[ii - first];
+            if (buffer.count == 0)
+               continue;
+
+            const auto pos = group.start + group.done;
+            const auto chans = std::min<unsigned>(mNumAudioOut, group.numChannels);
+            group.left->Set((samplePtr) buffer.out[0].get(),
+               floatSample, pos, buffer.count);
+            if (group.right)
+               group.right->Set((samplePtr) buffer.out[chans >= 2 ? 1 : 0].get(),
+                  floatSample, pos, buffer.count);
+
+            group.done += buffer.count;
+            done += buffer.count;
+            more = more || group.done < group.len;
+         }
+
+         if (total > 0 && TotalProgress(done.as_double() / total.as_double()))
+            return false;
+      }
+   }
+
+   return true;
+}
+
 bool Effect::ProcessTrack(int count,
                           ChannelNames map,
                           WaveTrack *left,
@@ -154,6 +154,7 @@ class TENACITY_DLL_API Effect /* not final */ : public wxEvtHandler,
                                        float **outbuf,
                                        size_t numSamples) override;
    bool RealtimeProcessEnd() noexcept override;
+   bool SupportsParallelProcessing() override;
 
    int ShowClientInterface(
       wxWindow &parent, wxDialog &dialog, bool forceModal = false) override;
@@ -306,6 +307,10 @@ protected:
    // (when doing stereo groups at a time)
    bool TrackGroupProgress(int whichGroup, double frac, const TranslatableString & = {});
 
+   // Number of threads that effects processing in parallel should use,
+   // from the /Performance/EffectThreads preference
+   static unsigned ParallelEffectThreads();
+
    int GetNumWaveTracks() { return mNumTracks; }
    int GetNumWaveGroups() { return mNumGroups; }
 
@@ -465,6 +470,9 @@ protected:
                      ArrayOf< float * > &inBufPos,
                      ArrayOf< float *> &outBufPos);
 
+   // Driver for client effects that SupportsParallelProcessing()
+   bool ProcessParallelPass();
+
  //
  // private data
  //
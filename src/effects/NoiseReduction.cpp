@@ -46,6 +46,7 @@
 // Tenacity libraries
 #include <lib-math/RealFFTf.h>
 #include <lib-preferences/Prefs.h>
+#include <lib-utility/TaskScheduler.h>
 
 #include "../shuttle/ShuttleGui.h"
 #include "../widgets/HelpSystem.h"
@@ -55,6 +56,7 @@
 #include "../widgets/valnum.h"
 
 #include <algorithm>
+#include <atomic>
 #include <vector>
 #include <cmath>
 
@@ -278,6 +280,36 @@ private:
                    int count, WaveTrack *track,
                    sampleCount start, sampleCount len);
 
+   // A stretch of a track reduced independently of its neighbors.  Positions
+   // are relative to the start of the selection.
+   struct Segment
+   {
+      // Input begins early enough that the history windows have forgotten
+      // the zero padding by outputStart, and ends late enough that output
+      // through outputEnd is complete, or else at the end of the selection
+      sampleCount inputStart, inputEnd;
+      sampleCount outputStart, outputEnd;
+      // Whether input reaches the end of the selection, so that the
+      // history must be flushed to complete the output
+      bool inputAtEnd;
+      FloatVector output;
+   };
+
+   // Number of steps in each segment of ProcessSegments()
+   size_t SegmentSteps() const;
+   // Reduce noise in consecutive segments of the selection concurrently,
+   // appending the results to outputTrack in order
+   bool ProcessSegments(EffectNoiseReduction &effect,
+                        Statistics &statistics,
+                        int count, const WaveTrack &track,
+                        WaveTrack &outputTrack,
+                        sampleCount start, sampleCount len,
+                        size_t nThreads);
+   // Called on a worker thread with a worker of its own
+   void ProcessSegment(Statistics &statistics,
+                       const WaveTrack &track, sampleCount start,
+                       Segment &segment);
+
    void StartNewTrack();
    void ProcessSamples(Statistics &statistics,
       WaveTrack *outputTrack, size_t len, float *buffer);
@@ -292,6 +324,11 @@ private:
 
 private:
 
+   const Settings &mSettings;
+#ifdef EXPERIMENTAL_SPECTRAL_EDITING
+   const double mF0, mF1;
+#endif
+
    const bool mDoProfile;
 
    const double mSampleRate;
@@ -332,6 +369,13 @@ private:
    unsigned  mNWindowsToExamine;
    unsigned  mCenter;
    unsigned  mHistoryLen;
+   // Steps after which the gains no longer depend on what preceded them
+   unsigned  mWarmUpSteps;
+
+   // When reducing a segment, output goes here instead of to a track,
+   // less the first mSegmentSkip steps of warm-up
+   FloatVector *mSegmentOutput{};
+   sampleCount  mSegmentSkip{ 0 };
 
    struct Record
    {
@@ -758,7 +802,12 @@ EffectNoiseReduction::Worker::Worker
 , double f0, double f1
 #endif
 )
-: mDoProfile(settings.mDoProfile)
+: mSettings(settings)
+#ifdef EXPERIMENTAL_SPECTRAL_EDITING
+, mF0(f0), mF1(f1)
+#endif
+
+, mDoProfile(settings.mDoProfile)
 
 , mSampleRate(sampleRate)
 
@@ -829,6 +878,12 @@ EffectNoiseReduction::Worker::Worker
       mHistoryLen = std::max(mNWindowsToExamine, mCenter + nAttackBlocks);
    }
 
+   // The queue and the overlap buffer hold the last mHistoryLen and
+   // mStepsPerWindow windows; the release carried into them from earlier
+   // windows falls to mNoiseAttenFactor within nReleaseBlocks, and twice
+   // that leaves ample margin for rounding in the repeated products
+   mWarmUpSteps = mHistoryLen + mStepsPerWindow + 2 * nReleaseBlocks + 2;
+
    mQueue.resize(mHistoryLen);
    for (unsigned ii = 0; ii < mHistoryLen; ++ii)
       mQueue[ii] = std::make_unique<Record>(mSpectrumSize);
@@ -1305,7 +1360,11 @@ void EffectNoiseReduction::Worker::ReduceNoise
       float *buffer = &mOutOverlapBuffer[0];
       if (mOutStepCount >= 0) {
          // Output the first portion of the overlap buffer, they're done
-         outputTrack->Append((samplePtr)buffer, floatSample, mStepSize);
+         if (!mSegmentOutput)
+            outputTrack->Append((samplePtr)buffer, floatSample, mStepSize);
+         else if (mOutStepCount >= mSegmentSkip)
+            mSegmentOutput->insert(mSegmentOutput->end(),
+               buffer, buffer + mStepSize);
       }
 
       // Shift the remainder over.
@@ -1327,37 +1386,45 @@ bool EffectNoiseReduction::Worker::ProcessOne
    if(!mDoProfile)
       outputTrack = track->EmptyCopy();
 
-   auto bufferSize = track->GetMaxBlockSize();
-   FloatVector buffer(bufferSize);
-
    bool bLoopSuccess = true;
-   auto samplePos = start;
-   while (bLoopSuccess && samplePos < start + len) {
-      //Get a blockSize of samples (smaller than the size of the buffer)
-      const auto blockSize = limitSampleBufferSize(
-         track->GetBestBlockSize(samplePos),
-         start + len - samplePos
-      );
+   const auto nThreads =
+      mDoProfile ? 1 : EffectNoiseReduction::ParallelEffectThreads();
+   if (nThreads > 1 &&
+       len > sampleCount{ 2 * SegmentSteps() * mStepSize })
+      bLoopSuccess = ProcessSegments(effect, statistics, count,
+         *track, *outputTrack, start, len, nThreads);
+   else {
+      auto bufferSize = track->GetMaxBlockSize();
+      FloatVector buffer(bufferSize);
+
+      auto samplePos = start;
+      while (bLoopSuccess && samplePos < start + len) {
+         //Get a blockSize of samples (smaller than the size of the buffer)
+         const auto blockSize = limitSampleBufferSize(
+            track->GetBestBlockSize(samplePos),
+            start + len - samplePos
+         );
 
-      //Get the samples from the track and put them in the buffer
-      track->GetFloats(&buffer[0], samplePos, blockSize);
-      samplePos += blockSize;
+         //Get the samples from the track and put them in the buffer
+         track->GetFloats(&buffer[0], samplePos, blockSize);
+         samplePos += blockSize;
 
-      mInSampleCount += blockSize;
-      ProcessSamples(statistics, outputTrack.get(), blockSize, &buffer[0]);
+         mInSampleCount += blockSize;
+         ProcessSamples(statistics, outputTrack.get(), blockSize, &buffer[0]);
 
-      // Update the Progress meter, let user cancel
-      bLoopSuccess = 
-         !effect.TrackProgress(count,
-                               ( samplePos - start ).as_double() /
-                               len.as_double() );
-   }
+         // Update the Progress meter, let user cancel
+         bLoopSuccess = 
+            !effect.TrackProgress(count,
+                                  ( samplePos - start ).as_double() /
+                                  len.as_double() );
+      }
 
-   if (bLoopSuccess) {
-      if (mDoProfile)
-         FinishTrackStatistics(statistics);
-      else
-         FinishTrack(statistics, &*outputTrack);
+      if (bLoopSuccess) {
+         if (mDoProfile)
+            FinishTrackStatistics(statistics);
+         else
+            FinishTrack(statistics, &*outputTrack);
+      }
    }
 
    if (bLoopSuccess && !mDoProfile) {
@@ -1376,6 +1443,127 @@ bool EffectNoiseReduction::Worker::ProcessOne
    return bLoopSuccess;
 }
 
+size_t EffectNoiseReduction::Worker::SegmentSteps() const
+{
+   // About a million samples, but long enough that warm-up and look-ahead
+   // add little to the work
+   const size_t overhead = mWarmUpSteps + mHistoryLen + mStepsPerWindow;
+   return std::max<size_t>((1 << 20) / mStepSize, 16 * overhead);
+}
+
+bool EffectNoiseReduction::Worker::ProcessSegments
+(EffectNoiseReduction &effect, Statistics &statistics,
+ int count, const WaveTrack &track, WaveTrack &outputTrack,
+ sampleCount start, sampleCount len, size_t nThreads)
+{
+   // Segments begin on step boundaries, so that their windows line up
+   // with those of one pass over the whole selection.  Then the output of
+   // each, after its warm-up, is the same as that pass would give, and the
+   // segments join without any crossfade.
+   const sampleCount segmentLen{ SegmentSteps() * mStepSize };
+   const sampleCount warmUp{ mWarmUpSteps * mStepSize };
+   const sampleCount lookAhead{
+      (mHistoryLen + mStepsPerWindow) * mStepSize };
+
+   // Each thread needs its own FFT buffers and history
+   std::vector<std::unique_ptr<Worker>> workers(nThreads);
+   for (auto &pWorker : workers)
+      pWorker = std::make_unique<Worker>(mSettings, mSampleRate
+#ifdef EXPERIMENTAL_SPECTRAL_EDITING
+         , mF0, mF1
+#endif
+      );
+   std::vector<Segment> segments(nThreads);
+
+   for (sampleCount first = 0; first < len;
+        first += segmentLen * (long long)nThreads) {
+      size_t nSegments = 0;
+      for (; nSegments < nThreads; ++nSegments) {
+         auto &segment = segments[nSegments];
+         segment.outputStart = first + segmentLen * (long long)nSegments;
+         if (segment.outputStart >= len)
+            break;
+         segment.outputEnd = std::min(len, segment.outputStart + segmentLen);
+         segment.inputStart =
+            std::max<sampleCount>(0, segment.outputStart - warmUp);
+         segment.inputEnd = std::min(len, segment.outputEnd + lookAhead);
+         segment.inputAtEnd = (segment.inputEnd == len);
+         segment.output.clear();
+      }
+
+      std::atomic<bool> failed{ false };
+      TaskGroup tasks;
+      tasks.ParallelFor(nSegments, [&](size_t ii) {
+         if (failed)
+            return;
+         try {
+            workers[ii]->ProcessSegment(
+               statistics, track, start, segments[ii]);
+         }
+         catch (const TenacityException &) {
+            // Pass this along to our application-level handler
+            failed = true;
+            throw;
+         }
+         catch (...) {
+            failed = true;
+         }
+      });
+      if (failed)
+         return false;
+
+      // Only this thread makes sample blocks
+      for (size_t ii = 0; ii < nSegments; ++ii) {
+         const auto &segment = segments[ii];
+         outputTrack.Append((samplePtr)segment.output.data(),
+            floatSample, segment.output.size());
+      }
+
+      const auto done = segments[nSegments - 1].outputEnd;
+      if (effect.TrackProgress(count, done.as_double() / len.as_double()))
+         return false;
+   }
+
+   return true;
+}
+
+void EffectNoiseReduction::Worker::ProcessSegment
+(Statistics &statistics, const WaveTrack &track, sampleCount start,
+ Segment &segment)
+{
+   StartNewTrack();
+   mSegmentOutput = &segment.output;
+   mSegmentSkip =
+      (segment.outputStart - segment.inputStart).as_long_long() / mStepSize;
+   auto cleanup = finally( [&] { mSegmentOutput = nullptr; } );
+
+   const auto outputLen =
+      (segment.outputEnd - segment.outputStart).as_size_t();
+   segment.output.reserve(outputLen + mStepSize);
+
+   FloatVector buffer(track.GetMaxBlockSize());
+   auto samplePos = start + segment.inputStart;
+   const auto end = start + segment.inputEnd;
+   while (samplePos < end) {
+      const auto blockSize = limitSampleBufferSize(
+         track.GetBestBlockSize(samplePos), end - samplePos);
+      track.GetFloats(&buffer[0], samplePos, blockSize);
+      samplePos += blockSize;
+
+      mInSampleCount += blockSize;
+      ProcessSamples(statistics, nullptr, blockSize, &buffer[0]);
+   }
+
+   // Segments whose input reaches the end of the selection, including any
+   // that end sooner than the look-ahead before it, flush the history as
+   // ProcessOne() would
+   if (segment.inputAtEnd)
+      FinishTrack(statistics, nullptr);
+
+   wxASSERT(segment.output.size() >= outputLen);
+   segment.output.resize(outputLen);
+}
+
 //----------------------------------------------------------------------------
 // EffectNoiseReduction::Dialog
 //----------------------------------------------------------------------------
@@ -195,6 +195,7 @@ size_t EffectPhaser::RealtimeProcess(int group,
 
    return InstanceProcess(mSlaves[group], inbuf, outbuf, numSamples);
 }
+
 bool EffectPhaser::DefineParams( ShuttleParams & S ){
    S.SHUTTLE_PARAM( mStages,    Stages );
    S.SHUTTLE_PARAM( mDryWet,    DryWet );
@@ -17,6 +17,7 @@
 #include <lib-project/Project.h>
 #include <lib-utility/MemoryX.h>
 
+#include <algorithm>
 #include <atomic>
 #include <memory>
 #include <chrono>
@@ -44,10 +45,6 @@ const RealtimeEffectManager &RealtimeEffectManager::Get(const TenacityProject &p
 RealtimeEffectManager::RealtimeEffectManager(TenacityProject &project)
    : mProject(project)
 {
-   // Allocate our vectors. We set their capacity to a size of '2', enough to
-   // process stero audio data.
-   mInputBuffers.reserve(2);
-   mOutputBuffers.reserve(2);
 }
 
 RealtimeEffectManager::~RealtimeEffectManager()
@@ -109,7 +106,8 @@ void RealtimeEffectManager::RealtimeRemoveEffect(EffectProcessor &effect)
       mStates.erase(found);
 }
 
-void RealtimeEffectManager::RealtimeInitialize(double rate)
+void RealtimeEffectManager::RealtimeInitialize(
+   double rate, unsigned chans, size_t blockSize)
 {
    // The audio thread should not be running yet, but protect anyway
    SuspensionScope scope{ &mProject };
@@ -118,6 +116,11 @@ void RealtimeEffectManager::RealtimeInitialize(double rate)
    mRealtimeChans.clear();
    mRealtimeRates.clear();
 
+   // Allocate buffers for the most that processing will need
+   mBlockSize = blockSize;
+   mOutputStorage.clear();
+   ReserveBuffers(chans);
+
    // RealtimeAdd/RemoveEffect() needs to know when we're active so it can
    // initialize newly added effects
    mActive = true;
@@ -131,6 +134,8 @@ void RealtimeEffectManager::RealtimeInitialize(double rate)
 
 void RealtimeEffectManager::RealtimeAddProcessor(int group, unsigned chans, float rate)
 {
+   ReserveBuffers(chans);
+
    for (auto &state : mStates)
       state->RealtimeAddProcessor(group, chans, rate);
 
@@ -215,14 +220,24 @@ void RealtimeEffectManager::RealtimeResumeOne( EffectProcessor &effect )
       (*found)->RealtimeResume();
 }
 
+void RealtimeEffectManager::ReserveBuffers(unsigned chans)
+{
+   if (chans > mInputBuffers.size()) {
+      mInputBuffers.resize(chans);
+      mOutputBuffers.resize(chans);
+   }
+   if (chans > mOutputStorage.size())
+      mOutputStorage.resize(chans);
+   for (auto &storage : mOutputStorage)
+      if (storage.size() < mBlockSize)
+         storage.resize(mBlockSize);
+}
+
 //
 // This will be called in a different thread than the main GUI thread.
 //
 void RealtimeEffectManager::RealtimeProcessStart()
 {
-   // Protect ourselves from the main thread
-   LockGuard lock(mLock);
-
    // Can be suspended because of the audio stream being paused or because effects
    // have been suspended.
    if (!mSuspended)
@@ -242,9 +257,6 @@ size_t RealtimeEffectManager::RealtimeProcess(int group, unsigned chans, float *
 {
    using namespace std::chrono;
 
-   // Protect ourselves from the main thread
-   LockGuard lock(mLock);
-
    // Can be suspended because of the audio stream being paused or because effects
    // have been suspended, so allow the samples to pass as-is.
    if (mSuspended || mStates.empty())
@@ -252,30 +264,25 @@ size_t RealtimeEffectManager::RealtimeProcess(int group, unsigned chans, float *
       return numSamples;
    }
 
-   // AK: If we have more channels than our input and output bufffers'
-   // capacities, increase their capacities when necessary.
-   if (mInputBuffers.capacity() < chans)
+   // The buffers were allocated for the channels and block size given
+   // before the stream started.  Pass more than that through unprocessed,
+   // rather than allocate here
+   if (chans > mOutputStorage.size() || numSamples > mBlockSize)
    {
-      mInputBuffers.reserve(chans);
-   } else if (mOutputBuffers.capacity() < chans)
-   {
-      mOutputBuffers.reserve(chans);
+      RealtimeChecks::NoteBypass();
+      return numSamples;
    }
 
    // Remember when we started so we can calculate the amount of latency we
    // are introducing
    auto start = steady_clock::now();
 
-   // Allocate the in/out buffer arrays
-   // GP: temporary fix until we convert Effect
-   AutoAllocator<float>  floatAllocator;
-
-   // And populate the input with the buffers we've been given while allocating
-   // NEW output buffers
+   // And populate the input with the buffers we've been given, and the
+   // output with our own
    for (unsigned int i = 0; i < chans; i++)
    {
       mInputBuffers[i] = buffers[i];
-      mOutputBuffers[i] = floatAllocator.Allocate(true, numSamples);
+      mOutputBuffers[i] = mOutputStorage[i].data();
    }
 
    // Now call each effect in the chain while swapping buffer pointers to feed the
@@ -323,9 +330,6 @@ size_t RealtimeEffectManager::RealtimeProcess(int group, unsigned chans, float *
 //
 void RealtimeEffectManager::RealtimeProcessEnd() noexcept
 {
-   // Protect ourselves from the main thread
-   LockGuard lock(mLock);
-
    // Can be suspended because of the audio stream being paused or because effects
    // have been suspended.
    if (!mSuspended)
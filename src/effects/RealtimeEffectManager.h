@@ -19,6 +19,7 @@
 #include <chrono>
 
 #include "ClientData.h"
+#include "../RealtimeChecks.h"
 
 class TenacityProject;
 class EffectProcessor;
@@ -42,7 +43,10 @@ public:
    bool RealtimeIsSuspended() const noexcept;
    void RealtimeAddEffect(EffectProcessor &effect);
    void RealtimeRemoveEffect(EffectProcessor &effect);
-   void RealtimeInitialize(double rate);
+   //! chans and blockSize are the most channels and samples per channel that
+   //! each call to ProcessScope::Process() will pass, so buffers for that are
+   //! allocated now and not while processing
+   void RealtimeInitialize(double rate, unsigned chans, size_t blockSize);
    void RealtimeAddProcessor(int group, unsigned chans, float rate);
    void RealtimeFinalize();
    void RealtimeSuspend();
@@ -83,58 +87,79 @@ public:
    };
 
    //! Object whose lifetime encompasses one block of processing in one thread
+   /*! It only tries the lock that protects the effects from the main thread.
+    While the main thread holds it, to change the effects, the block passes
+    through unprocessed rather than making the audio thread wait, which
+    RealtimeChecks counts. */
    class ProcessScope {
    public:
       explicit ProcessScope(TenacityProject *pProject)
-         : mpProject{ pProject }
       {
-         if (mpProject)
-            Get(*mpProject).RealtimeProcessStart();
+         if (pProject) {
+            auto &manager = Get(*pProject);
+            mLock = std::unique_lock<std::mutex>{
+               manager.mLock, std::try_to_lock };
+            if (mLock.owns_lock()) {
+               mpManager = &manager;
+               manager.RealtimeProcessStart();
+            }
+            else
+               RealtimeChecks::NoteBypass();
+         }
       }
       ProcessScope( ProcessScope &&other )
-         : mpProject{ other.mpProject }
+         : mLock{ std::move(other.mLock) }
+         , mpManager{ other.mpManager }
       {
-         other.mpProject = nullptr;
+         other.mpManager = nullptr;
       }
       ProcessScope& operator=( ProcessScope &&other )
       {
-         auto pProject = other.mpProject;
-         other.mpProject = nullptr;
-         mpProject = pProject;
+         auto pManager = other.mpManager;
+         other.mpManager = nullptr;
+         mLock = std::move(other.mLock);
+         mpManager = pManager;
          return *this;
       }
       ~ProcessScope()
       {
-         if (mpProject)
-            Get(*mpProject).RealtimeProcessEnd();
+         if (mpManager)
+            mpManager->RealtimeProcessEnd();
       }
 
       size_t Process( int group,
          unsigned chans, float **buffers, size_t numSamples)
       {
-         if (mpProject)
-            return Get(*mpProject)
-               .RealtimeProcess(group, chans, buffers, numSamples);
+         if (mpManager)
+            return mpManager->RealtimeProcess(group, chans, buffers, numSamples);
          else
             return numSamples; // consider them trivially processed
       }
 
    private:
-      TenacityProject *mpProject = nullptr;
+      std::unique_lock<std::mutex> mLock;
+      RealtimeEffectManager *mpManager = nullptr;
    };
 
 private:
+   // These are called only with mLock held by a ProcessScope
    void RealtimeProcessStart();
    size_t RealtimeProcess(int group, unsigned chans, float **buffers, size_t numSamples);
    void RealtimeProcessEnd() noexcept;
 
+   //! Make the buffers hold at least chans channels of mBlockSize samples
+   void ReserveBuffers(unsigned chans);
+
    RealtimeEffectManager(const RealtimeEffectManager&) = delete;
    RealtimeEffectManager &operator=(const RealtimeEffectManager&) = delete;
 
-   // Input and output buffers. Note that their capacity is equal to the number
-   // of channels being processed.
+   // Input and output buffers. Note that their size is equal to the most
+   // channels being processed.
    std::vector<float*> mInputBuffers;
    std::vector<float*> mOutputBuffers;
+   //! Storage for the output buffers, allocated before processing starts
+   std::vector<std::vector<float>> mOutputStorage;
+   size_t mBlockSize{ 0 };
 
    TenacityProject &mProject;
 
@@ -1064,6 +1064,13 @@ bool LadspaEffect::RealtimeProcessEnd() noexcept
    return true;
 }
 
+bool LadspaEffect::SupportsParallelProcessing()
+{
+   // All instances write output controls, including the latency, to the
+   // same array, so run them at once only if there are none
+   return mLatencyPort < 0 && mNumOutputControls == 0;
+}
+
 int LadspaEffect::ShowClientInterface(
    wxWindow &parent, wxDialog &dialog, bool forceModal)
 {
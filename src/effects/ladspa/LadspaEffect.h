@@ -106,6 +106,7 @@ public:
                                        float **outbuf,
                                        size_t numSamples) override;
    bool RealtimeProcessEnd() noexcept override;
+   bool SupportsParallelProcessing() override;
 
    int ShowClientInterface(
       wxWindow &parent, wxDialog &dialog, bool forceModal) override;
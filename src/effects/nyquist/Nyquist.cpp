@@ -79,6 +79,7 @@ effects from this one class.
 #include "../../tracks/playabletrack/wavetrack/ui/WaveTrackViewConstants.h"
 #include "../../widgets/NumericTextCtrl.h"
 #include "../../widgets/ProgressDialog.h"
+#include "../../AppendBatch.h"
 
 #ifndef nyx_returns_start_and_end_time
 #error You need to update lib-src/libnyquist
@@ -108,6 +109,11 @@ enum
 // Protect Nyquist from selections greater than 2^31 samples (bug 439)
 #define NYQ_MAX_LEN (std::numeric_limits<long>::max())
 
+//! Blocks of input to read ahead of the get callback
+static constexpr size_t NyquistReadAheadBlocks = 2;
+//! Blocks of output from the put callback to store together
+static constexpr size_t OutputStoreBlocks = 4;
+
 #define UNINITIALIZED_CONTROL ((double)99999999.99)
 
 static const wxChar *KEY_Command = wxT("Command");
@@ -138,6 +144,8 @@ END_EVENT_TABLE()
 NyquistEffect::NyquistEffect(const wxString &fName)
 {
    mOutputTrack[0] = mOutputTrack[1] = nullptr;
+   mOutputClip[0] = mOutputClip[1] = nullptr;
+   mOutputPending[0] = mOutputPending[1] = 0;
 
    mAction = XO("Applying Nyquist Effect...");
    mIsPrompt = false;
@@ -1402,14 +1410,19 @@ bool NyquistEffect::ProcessOne()
       cmd += mCmd;
    }
 
-   // Put the fetch buffers in a clean initial state
-   for (size_t i = 0; i < mCurNumChannels; i++)
-      mCurBuffer[i].reset();
+   // Fetch for the get callback through caches that read the blocks ahead
+   for (size_t i = 0; i < mCurNumChannels; i++) {
+      mCurCache[i] = std::make_unique<WaveTrackCache>(
+         mCurTrack[i]->SharedPointer<const WaveTrack>());
+      mCurCache[i]->SetReadAhead(NyquistReadAheadBlocks);
+   }
 
-   // Guarantee release of memory when done
+   // Guarantee release of memory, and of the tracks by read-ahead, when done
    auto cleanup = finally( [&] {
       for (size_t i = 0; i < mCurNumChannels; i++)
-         mCurBuffer[i].reset();
+         mCurCache[i].reset();
+      mAppendBatch.reset();
+      mOutputClip[0] = mOutputClip[1] = nullptr;
    } );
 
    // Evaluate the expression, which may invoke the get callback, but often does
@@ -1574,11 +1587,10 @@ bool NyquistEffect::ProcessOne()
 
       outputTrack[i] = mCurTrack[i]->EmptyCopy();
       outputTrack[i]->SetRate( rate );
-
-      // Clean the initial buffer states again for the get callbacks
-      // -- is this really needed?
-      mCurBuffer[i].reset();
+      mOutputClip[i] = nullptr;
+      mOutputPending[i] = 0;
    }
+   mAppendBatch = std::make_unique<AppendBatch>();
 
    // Now fully evaluate the sound
    int success;
@@ -1588,6 +1600,10 @@ bool NyquistEffect::ProcessOne()
       success = nyx_get_audio(StaticPutCallback, (void *)this);
    }
 
+   // Stop reading ahead before the input tracks change
+   for (size_t i = 0; i < mCurNumChannels; i++)
+      mCurCache[i].reset();
+
    // See if GetCallback found read errors
    {
       auto pException = mpException;
@@ -1599,6 +1615,7 @@ bool NyquistEffect::ProcessOne()
    if (!success)
       return false;
 
+   StoreOutput();
    for (int i = 0; i < outChannels; i++) {
       outputTrack[i]->Flush();
       mOutputTime = outputTrack[i]->GetEndTime();
@@ -2440,45 +2457,17 @@ int NyquistEffect::StaticGetCallback(float *buffer, int channel,
 int NyquistEffect::GetCallback(float *buffer, int ch,
                                int64_t start, int64_t len, int64_t WXUNUSED(totlen))
 {
-   if (mCurBuffer[ch]) {
-      if ((mCurStart[ch] + start) < mCurBufferStart[ch] ||
-          (mCurStart[ch] + start)+len >
-          mCurBufferStart[ch]+mCurBufferLen[ch]) {
-         mCurBuffer[ch].reset();
-      }
+   // The cache reuses its buffers, and reads the next blocks meanwhile
+   const float *samples;
+   try {
+      samples = mCurCache[ch]->GetFloats(mCurStart[ch] + start, len, true);
    }
-
-   if (!mCurBuffer[ch]) {
-      mCurBufferStart[ch] = (mCurStart[ch] + start);
-      mCurBufferLen[ch] = mCurTrack[ch]->GetBestBlockSize(mCurBufferStart[ch]);
-
-      if (mCurBufferLen[ch] < (size_t) len) {
-         mCurBufferLen[ch] = mCurTrack[ch]->GetIdealBlockSize();
-      }
-
-      mCurBufferLen[ch] =
-         limitSampleBufferSize( mCurBufferLen[ch],
-                                mCurStart[ch] + mCurLen - mCurBufferStart[ch] );
-
-      // C++20
-      // mCurBuffer[ch] = std::make_unique_for_overwrite(mCurBufferLen[ch]);
-      mCurBuffer[ch] = Buffer{ safenew float[ mCurBufferLen[ch] ] };
-      try {
-         mCurTrack[ch]->GetFloats( mCurBuffer[ch].get(),
-            mCurBufferStart[ch], mCurBufferLen[ch]);
-      }
-      catch ( ... ) {
-         // Save the exception object for re-throw when out of the library
-         mpException = std::current_exception();
-         return -1;
-      }
+   catch ( ... ) {
+      // Save the exception object for re-throw when out of the library
+      mpException = std::current_exception();
+      return -1;
    }
-
-   // We have guaranteed above that this is nonnegative and bounded by
-   // mCurBufferLen[ch]:
-   auto offset = ( mCurStart[ch] + start - mCurBufferStart[ch] ).as_size_t();
-   const void *src = &mCurBuffer[ch][offset];
-   std::memcpy(buffer, src, len * sizeof(float));
+   std::memcpy(buffer, samples, len * sizeof(float));
 
    if (ch == 0) {
       double progress = mScale *
@@ -2521,12 +2510,30 @@ int NyquistEffect::PutCallback(float *buffer, int channel,
          }
       }
 
-      mOutputTrack[channel]->Append((samplePtr)buffer, floatSample, len);
+      // Nyquist puts small pieces; store them a few blocks at a time, so
+      // that the summaries of the blocks are computed together
+      mOutputClip[channel] = mOutputTrack[channel]->AppendToBuffer(
+         (samplePtr)buffer, floatSample, len);
+      mOutputPending[channel] += len;
+      if (mOutputPending[channel] >=
+          OutputStoreBlocks * mOutputTrack[channel]->GetMaxBlockSize())
+         StoreOutput();
 
       return 0; // success
    }, MakeSimpleGuard( -1 ) ); // translate all exceptions into failure
 }
 
+void NyquistEffect::StoreOutput()
+{
+   std::vector<WaveClip *> clips;
+   for (size_t i = 0; i < 2; i++) {
+      if (mOutputClip[i])
+         clips.push_back(mOutputClip[i]);
+      mOutputPending[i] = 0;
+   }
+   mAppendBatch->Store(clips);
+}
+
 void NyquistEffect::StaticOutputCallback(int c, void *This)
 {
    ((NyquistEffect *)This)->OutputCallback(c);
@@ -16,6 +16,9 @@
 
 #include "nyx.h"
 
+class AppendBatch;
+class WaveClip;
+class WaveTrackCache;
 class wxArrayString;
 class wxFileName;
 class wxCheckBox;
@@ -159,6 +162,8 @@ private:
                    int64_t start, int64_t len, int64_t totlen);
    int PutCallback(float *buffer, int channel,
                    int64_t start, int64_t len, int64_t totlen);
+   //! Store the full blocks appended to the output tracks
+   void StoreOutput();
    void OutputCallback(int c);
    void OSCallback();
 
@@ -269,12 +274,15 @@ private:
    double            mProgressTot;
    double            mScale;
 
-   using Buffer = std::unique_ptr<float[]>;
-   Buffer            mCurBuffer[2];
-   sampleCount       mCurBufferStart[2];
-   size_t            mCurBufferLen[2];
+   //! Fetch the input channels for the get callback
+   std::unique_ptr<WaveTrackCache> mCurCache[2];
 
    WaveTrack        *mOutputTrack[2];
+   //! Clips of the output tracks with samples not yet stored in blocks
+   WaveClip         *mOutputClip[2];
+   //! Samples put in each output clip since its blocks were last stored
+   size_t            mOutputPending[2];
+   std::unique_ptr<AppendBatch> mAppendBatch;
 
    wxArrayString     mCategories;
 
@@ -1164,24 +1164,21 @@ ProgressResult ExportFFmpeg::Export(TenacityProject *project,
                  .Format( ExportFFmpegOptions::fmts[mSubFormat].description ) );
       auto &progress = *pDialog;
 
-      while (updateResult == ProgressResult::Success) {
-         auto pcmNumSamples = mixer->Process(pcmBufferSize);
-
-         if (pcmNumSamples == 0)
-            break;
-
-         short *pcmBuffer = (short *)mixer->GetBuffer();
+      updateResult = MixAndEncode(*mixer,
+         channels, pcmBufferSize, true, int16Sample,
+         [&](const MixedBlock &block) {
+         const auto pcmNumSamples = block.len;
+         short *pcmBuffer = (short *)block.GetBuffer();
 
          if (!EncodeAudioFrame(
             pcmBuffer, (pcmNumSamples)*sizeof(int16_t)*mChannels)) {
             // All errors should already have been reported.
             //ShowDiskFullExportErrorDialog(mName);
-            updateResult = ProgressResult::Cancelled;
-            break;
+            return ProgressResult::Cancelled;
          }
 
-         updateResult = progress.Update(mixer->MixGetCurrentTime() - t0, t1 - t0);
-      }
+         return progress.Update(block.time - t0, t1 - t0);
+      });
    }
 
    if ( updateResult != ProgressResult::Cancelled )
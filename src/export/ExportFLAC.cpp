@@ -226,12 +226,51 @@ public:
                const Tags *metadata = NULL,
                int subformat = 0) override;
 
-private:
+   std::unique_ptr<ExportTask> MakeExportTask(TenacityProject &project,
+               WaveTrackConstArray tracks,
+               unsigned channels,
+               const wxFileNameWrapper &fName,
+               double t0,
+               double t1,
+               MixerSpec *mixerSpec = NULL,
+               const Tags *metadata = NULL,
+               int subformat = 0) override;
+};
+
+//----------------------------------------------------------------------------
+
+class FLACExportTask final : public ExportTask
+{
+public:
+   FLACExportTask(TenacityProject &project,
+      WaveTrackConstArray tracks, unsigned numChannels,
+      const wxFileNameWrapper &fName, double t0, double t1,
+      MixerSpec *mixerSpec, const Tags &metadata)
+      : ExportTask{ std::move(tracks),
+         Mixer::WarpOptions{ TrackList::Get(project) }, mixerSpec }
+      , mRate{ ProjectRate::Get(project).GetRate() }
+      , mNumChannels{ numChannels }
+      , mFName{ fName }
+      , mT0{ t0 }
+      , mT1{ t1 }
+      , mMetadata{ metadata }
+      , mBitDepthPref{ FLACBitDepth.Read() }
+   {
+      FLACLevel.Read().ToLong( &mLevelPref );
+   }
 
-   bool GetMetadata(TenacityProject *project, const Tags *tags);
+   ProgressResult Run(const ProgressCallback &progress) override;
 
-   // Should this be a stack variable instead in Export?
-   FLAC__StreamMetadataHandle mMetadata;
+private:
+   static FLAC__StreamMetadataHandle MakeMetadata(const Tags &tags);
+
+   const double mRate;
+   const unsigned mNumChannels;
+   const wxFileNameWrapper mFName;
+   const double mT0, mT1;
+   const Tags mMetadata;
+   const wxString mBitDepthPref;
+   long mLevelPref{ 5 };
 };
 
 //----------------------------------------------------------------------------
@@ -256,18 +295,48 @@ ProgressResult ExportFLAC::Export(TenacityProject *project,
                         double t1,
                         MixerSpec *mixerSpec,
                         const Tags *metadata,
-                        int WXUNUSED(subformat))
+                        int subformat)
 {
-   double    rate    = ProjectRate::Get(*project).GetRate();
    const auto &tracks = TrackList::Get( *project );
+   auto task = MakeExportTask(*project, ExportedTracks(tracks, selectionOnly),
+      numChannels, fName, t0, t1, mixerSpec, metadata, subformat);
+   return RunExportTask(*task, pDialog, fName,
+      selectionOnly
+         ? XO("Exporting the selected audio as FLAC")
+         : XO("Exporting the audio as FLAC"),
+      t0, t1);
+}
+
+std::unique_ptr<ExportTask> ExportFLAC::MakeExportTask(
+                        TenacityProject &project,
+                        WaveTrackConstArray tracks,
+                        unsigned numChannels,
+                        const wxFileNameWrapper &fName,
+                        double t0,
+                        double t1,
+                        MixerSpec *mixerSpec,
+                        const Tags *metadata,
+                        int WXUNUSED(subformat))
+{
+   // Retrieve tags if needed
+   if (metadata == NULL)
+      metadata = &Tags::Get( project );
+
+   return std::make_unique<FLACExportTask>(project, std::move(tracks),
+      numChannels, fName, t0, t1, mixerSpec, *metadata);
+}
+
+ProgressResult FLACExportTask::Run(const ProgressCallback &progress)
+{
+   const auto rate = mRate;
+   const auto numChannels = mNumChannels;
+   const auto &fName = mFName;
+   const auto t0 = mT0, t1 = mT1;
 
    wxLogNull logNo;            // temporarily disable wxWidgets error messages
    auto updateResult = ProgressResult::Success;
 
-   long levelPref;
-   FLACLevel.Read().ToLong( &levelPref );
-
-   auto bitDepthPref = FLACBitDepth.Read();
+   auto levelPref = mLevelPref;
 
    FLAC::Encoder::File encoder;
 
@@ -279,26 +348,22 @@ ProgressResult ExportFLAC::Export(TenacityProject *project,
    encoder.set_channels(numChannels) &&
    encoder.set_sample_rate(lrint(rate));
 
-   // See note in GetMetadata() about a bug in libflac++ 1.1.2
-   if (success && !GetMetadata(project, metadata)) {
+   // See note in MakeMetadata() about a bug in libflac++ 1.1.2
+   FLAC__StreamMetadataHandle metadata;
+   if (success && !(metadata = MakeMetadata(mMetadata)))
       // TODO: more precise message
-      ShowExportErrorDialog("FLAC:283");
-      return ProgressResult::Cancelled;
-   }
+      return Fail(ProgressResult::Cancelled,
+         []{ ShowExportErrorDialog("FLAC:283"); });
 
-   if (success && mMetadata) {
+   if (success && metadata) {
       // set_metadata expects an array of pointers to metadata and a size.
       // The size is 1.
-      FLAC__StreamMetadata *p = mMetadata.get();
+      FLAC__StreamMetadata *p = metadata.get();
       success = encoder.set_metadata(&p, 1);
    }
 
-   auto cleanup1 = finally( [&] {
-      mMetadata.reset(); // need this?
-   } );
-
    sampleFormat format;
-   if (bitDepthPref == wxT("24")) {
+   if (mBitDepthPref == wxT("24")) {
       format = int24Sample;
       success = success && encoder.set_bits_per_sample(24);
    } else { //convert float to 16 bits
@@ -335,8 +400,8 @@ ProgressResult ExportFLAC::Export(TenacityProject *project,
 
    if (!success) {
       // TODO: more precise message
-      ShowExportErrorDialog("FLAC:336");
-      return ProgressResult::Cancelled;
+      return Fail(ProgressResult::Cancelled,
+         []{ ShowExportErrorDialog("FLAC:336"); });
    }
 
 #ifdef LEGACY_FLAC
@@ -345,8 +410,9 @@ ProgressResult ExportFLAC::Export(TenacityProject *project,
    wxFFile f;     // will be closed when it goes out of scope
    const auto path = fName.GetFullPath();
    if (!f.Open(path, wxT("w+b"))) {
-      AudacityMessageBox( XO("FLAC export couldn't open %s").Format( path ) );
-      return ProgressResult::Cancelled;
+      return Fail(ProgressResult::Cancelled, [path]{
+         AudacityMessageBox( XO("FLAC export couldn't open %s").Format( path ) );
+      });
    }
 
    // Even though there is an init() method that takes a filename, use the one that
@@ -354,14 +420,15 @@ ProgressResult ExportFLAC::Export(TenacityProject *project,
    // libflac can't (under Windows).
    int status = encoder.init(f.fp());
    if (status != FLAC__STREAM_ENCODER_INIT_STATUS_OK) {
-      AudacityMessageBox(
-         XO("FLAC encoder failed to initialize\nStatus: %d")
-            .Format( status ) );
-      return ProgressResult::Cancelled;
+      return Fail(ProgressResult::Cancelled, [status]{
+         AudacityMessageBox(
+            XO("FLAC encoder failed to initialize\nStatus: %d")
+               .Format( status ) );
+      });
    }
 #endif
 
-   mMetadata.reset();
+   metadata.reset();
 
    auto cleanup2 = finally( [&] {
       if (!(updateResult == ProgressResult::Success ||
@@ -373,27 +440,18 @@ ProgressResult ExportFLAC::Export(TenacityProject *project,
       }
    } );
 
-   auto mixer = CreateMixer(tracks, selectionOnly,
-                            t0, t1,
+   auto mixer = CreateMixer(t0, t1,
                             numChannels, SAMPLES_PER_RUN, false,
-                            rate, format, mixerSpec);
+                            rate, format);
 
    ArraysOf<FLAC__int32> tmpsmplbuf{ numChannels, SAMPLES_PER_RUN, true };
 
-   InitProgress( pDialog, fName,
-      selectionOnly
-         ? XO("Exporting the selected audio as FLAC")
-         : XO("Exporting the audio as FLAC") );
-   auto &progress = *pDialog;
-
-   while (updateResult == ProgressResult::Success) {
-      auto samplesThisRun = mixer->Process(SAMPLES_PER_RUN);
-      if (samplesThisRun == 0) { //stop encoding
-         break;
-      }
-      else {
+   updateResult = ExportPlugin::MixAndEncode(*mixer,
+      numChannels, SAMPLES_PER_RUN, false, format,
+      [&](const MixedBlock &block) {
+         const auto samplesThisRun = block.len;
          for (size_t i = 0; i < numChannels; i++) {
-            auto mixed = mixer->GetBuffer(i);
+            auto mixed = block.GetBuffer(i);
             if (format == int24Sample) {
                for (decltype(samplesThisRun) j = 0; j < samplesThisRun; j++) {
                   tmpsmplbuf[i][j] = ((const int *)mixed)[j];
@@ -409,15 +467,11 @@ ProgressResult ExportFLAC::Export(TenacityProject *project,
                reinterpret_cast<FLAC__int32**>( tmpsmplbuf.get() ),
                samplesThisRun) ) {
             // TODO: more precise message
-            ShowDiskFullExportErrorDialog(fName);
-            updateResult = ProgressResult::Cancelled;
-            break;
+            return Fail(ProgressResult::Cancelled,
+               [fName]{ ShowDiskFullExportErrorDialog(fName); });
          }
-         if (updateResult == ProgressResult::Success)
-            updateResult =
-               progress.Update(mixer->MixGetCurrentTime() - t0, t1 - t0);
-      }
-   }
+         return progress(block.time - t0);
+      });
 
    if (updateResult == ProgressResult::Success ||
        updateResult == ProgressResult::Stopped) {
@@ -447,16 +501,13 @@ void ExportFLAC::OptionsCreate(ShuttleGui &S, int format)
 //      expects that array to be valid until the stream is initialized.
 //
 //      This has been fixed in 1.1.4.
-bool ExportFLAC::GetMetadata(TenacityProject *project, const Tags *tags)
+FLAC__StreamMetadataHandle FLACExportTask::MakeMetadata(const Tags &tags)
 {
-   // Retrieve tags if needed
-   if (tags == NULL)
-      tags = &Tags::Get( *project );
-
-   mMetadata.reset(::FLAC__metadata_object_new(FLAC__METADATA_TYPE_VORBIS_COMMENT));
+   FLAC__StreamMetadataHandle metadata{
+      ::FLAC__metadata_object_new(FLAC__METADATA_TYPE_VORBIS_COMMENT) };
 
    wxString n;
-   for (const auto &pair : tags->GetRange()) {
+   for (const auto &pair : tags.GetRange()) {
       n = pair.first;
       const auto &v = pair.second;
       if (n == TAG_YEAR) {
@@ -468,23 +519,23 @@ bool ExportFLAC::GetMetadata(TenacityProject *project, const Tags *tags)
          n = wxT("COMMENT");
          FLAC::Metadata::VorbisComment::Entry entry(n.mb_str(wxConvUTF8),
                                                     v.mb_str(wxConvUTF8));
-         if (! ::FLAC__metadata_object_vorbiscomment_append_comment(mMetadata.get(),
+         if (! ::FLAC__metadata_object_vorbiscomment_append_comment(metadata.get(),
                                                               entry.get_entry(),
                                                               true) ) {
-            return false;
+            return {};
          }
          n = wxT("DESCRIPTION");
       }
       FLAC::Metadata::VorbisComment::Entry entry(n.mb_str(wxConvUTF8),
                                                  v.mb_str(wxConvUTF8));
-      if (! ::FLAC__metadata_object_vorbiscomment_append_comment(mMetadata.get(),
+      if (! ::FLAC__metadata_object_vorbiscomment_append_comment(metadata.get(),
                                                            entry.get_entry(),
                                                            true) ) {
-         return false;
+         return {};
       }
    }
 
-   return true;
+   return metadata;
 }
 
 static Exporter::RegisteredExportPlugin sRegisteredPlugin{ "FLAC",
@@ -318,13 +318,11 @@ ProgressResult ExportMP2::Export(TenacityProject *project,
                  .Format( bitrate ) );
       auto &progress = *pDialog;
 
-      while (updateResult == ProgressResult::Success) {
-         auto pcmNumSamples = mixer->Process(pcmBufferSize);
-
-         if (pcmNumSamples == 0)
-            break;
-
-         short *pcmBuffer = (short *)mixer->GetBuffer();
+      updateResult = MixAndEncode(*mixer,
+         stereo ? 2 : 1, pcmBufferSize, true, int16Sample,
+         [&](const MixedBlock &block) {
+         const auto pcmNumSamples = block.len;
+         short *pcmBuffer = (short *)block.GetBuffer();
 
          int mp2BufferNumBytes = twolame_encode_buffer_interleaved(
             encodeOptions,
@@ -336,8 +334,7 @@ ProgressResult ExportMP2::Export(TenacityProject *project,
          if (mp2BufferNumBytes < 0) {
             // TODO: more precise message
             ShowExportErrorDialog("MP2:339");
-            updateResult = ProgressResult::Cancelled;
-            break;
+            return ProgressResult::Cancelled;
          }
 
          if ( outFile.Write(mp2Buffer.get(), mp2BufferNumBytes).GetLastError() ) {
@@ -346,10 +343,15 @@ ProgressResult ExportMP2::Export(TenacityProject *project,
             return ProgressResult::Cancelled;
          }
 
-         updateResult = progress.Update(mixer->MixGetCurrentTime() - t0, t1 - t0);
-      }
+         return progress.Update(block.time - t0, t1 - t0);
+      });
    }
 
+   // Errors were already reported; don't write to the file again
+   if ( updateResult != ProgressResult::Success &&
+        updateResult != ProgressResult::Stopped )
+      return updateResult;
+
    int mp2BufferNumBytes = twolame_encode_flush(
       encodeOptions,
       mp2Buffer.get(),
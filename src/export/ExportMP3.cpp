@@ -1089,14 +1089,11 @@ ProgressResult ExportMP3::Export(TenacityProject *project,
       InitProgress( pDialog, fName, title );
       auto &progress = *pDialog;
 
-      while (updateResult == ProgressResult::Success) {
-         auto blockLen = mixer->Process(inSamples);
-
-         if (blockLen == 0) {
-            break;
-         }
-
-         float *mixed = (float *)mixer->GetBuffer();
+      updateResult = MixAndEncode(*mixer,
+         channels, inSamples, true, floatSample,
+         [&](const MixedBlock &block) {
+         const auto blockLen = block.len;
+         float *mixed = (float *)block.GetBuffer();
 
          if ((int)blockLen < inSamples) {
             if (channels > 1) {
@@ -1119,19 +1116,17 @@ ProgressResult ExportMP3::Export(TenacityProject *project,
             auto msg = XO("Error %ld returned from MP3 encoder")
                .Format( bytes );
             AudacityMessageBox( msg );
-            updateResult = ProgressResult::Cancelled;
-            break;
+            return ProgressResult::Cancelled;
          }
 
          if (bytes > (int)outFile.Write(buffer.get(), bytes)) {
             // TODO: more precise message
             ShowDiskFullExportErrorDialog(fName);
-            updateResult = ProgressResult::Cancelled;
-            break;
+            return ProgressResult::Cancelled;
          }
 
-         updateResult = progress.Update(mixer->MixGetCurrentTime() - t0, t1 - t0);
-      }
+         return progress.Update(block.time - t0, t1 - t0);
+      });
    }
 
    if ( updateResult == ProgressResult::Success ||
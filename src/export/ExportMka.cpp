@@ -637,40 +637,11 @@ ProgressResult ExportMka::Export(TenacityProject *project,
 #endif
 
         ClusterMuxer::MuxerTime prevTime{0, 0, TIMESTAMP_UNIT, rate};
-        while (updateResult == ProgressResult::Success)
+        updateResult = MixAndEncode(*mixer,
+            numChannels, SAMPLES_PER_RUN, outInterleaved, format,
+            [&](const MixedBlock &block)
         {
-            auto samplesThisRun = mixer->Process(SAMPLES_PER_RUN);
-            if (samplesThisRun == 0)
-            {
-#ifdef USE_LIBFLAC
-                if (bitDepthPref == wxT("flac16") || bitDepthPref == wxT("flac24"))
-                {
-                    if (!Muxer)
-                    {
-                        Muxer = std::make_unique<ClusterMuxer>(FileSegment, MyTrack1, AllCues, prevTime);
-                    }
-                    encoder.finish();
-#if 0 // doesn't work and is not necessary
-                    if (encoder.hasNewCodecPrivate())
-                    {
-                        const auto & buf = encoder.GetInitBuffer();
-                        KaxCodecPrivate &replacePrivate = GetChild<KaxCodecPrivate>(MyTrack1);
-                        if (buf.size() && replacePrivate.GetSize())
-                        {
-                            replacePrivate.CopyBuffer(buf.data(), buf.size());
-                            MyTracks.OverwriteData(mka_file);
-                        }
-                    }
-#endif
-                }
-#endif
-                if (Muxer)
-                {
-                    prevTime = Muxer->Finish(mka_file, MetaSeek);
-                    Muxer = nullptr;
-                }
-                break; //finished
-            }
+            const auto samplesThisRun = block.len;
 
             if (!Muxer)
             {
@@ -682,7 +653,7 @@ ProgressResult ExportMka::Export(TenacityProject *project,
             {
                 for (size_t i = 0; i < numChannels; i++)
                 {
-                    auto mixed = mixer->GetBuffer(i);
+                    auto mixed = block.GetBuffer(i);
                     if (format == int24Sample) {
                         for (decltype(samplesThisRun) j = 0; j < samplesThisRun; j++)
                             splitBuff[i][j] = ((const int *)mixed)[j];
@@ -702,7 +673,7 @@ ProgressResult ExportMka::Export(TenacityProject *project,
             else
 #endif
             {
-                auto mixed = mixer->GetBuffer();
+                auto mixed = block.GetBuffer();
                 DataBuffer *dataBuff = new DataBuffer((binary*)mixed, samplesThisRun * bytesPerSample, nullptr, true);
                 if (Muxer->AddBuffer(*dataBuff, samplesThisRun))
                 {
@@ -711,7 +682,38 @@ ProgressResult ExportMka::Export(TenacityProject *project,
                 }
             }
 
-            updateResult = progress.Update(mixer->MixGetCurrentTime() - t0, t1 - t0);
+            return progress.Update(block.time - t0, t1 - t0);
+        });
+
+        if (updateResult == ProgressResult::Success)
+        {
+#ifdef USE_LIBFLAC
+            if (bitDepthPref == wxT("flac16") || bitDepthPref == wxT("flac24"))
+            {
+                if (!Muxer)
+                {
+                    Muxer = std::make_unique<ClusterMuxer>(FileSegment, MyTrack1, AllCues, prevTime);
+                }
+                encoder.finish();
+#if 0 // doesn't work and is not necessary
+                if (encoder.hasNewCodecPrivate())
+                {
+                    const auto & buf = encoder.GetInitBuffer();
+                    KaxCodecPrivate &replacePrivate = GetChild<KaxCodecPrivate>(MyTrack1);
+                    if (buf.size() && replacePrivate.GetSize())
+                    {
+                        replacePrivate.CopyBuffer(buf.data(), buf.size());
+                        MyTracks.OverwriteData(mka_file);
+                    }
+                }
+#endif
+            }
+#endif
+            if (Muxer)
+            {
+                prevTime = Muxer->Finish(mka_file, MetaSeek);
+                Muxer = nullptr;
+            }
         }
 
         // add cues
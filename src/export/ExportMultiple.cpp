@@ -38,9 +38,14 @@
 #include <wx/textctrl.h>
 #include <wx/textdlg.h>
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
 // Tenacity libraries
 #include <lib-files/FileNames.h>
 #include <lib-preferences/Prefs.h>
+#include <lib-utility/TaskScheduler.h>
 
 #include "LabelTrack.h"
 #include "Project.h"
@@ -77,6 +82,77 @@ namespace {
     * this isn't done anywhere else in Audacity, presumably for a reason?, so
     * I'm stuck with wxArrays, which are much harder, as well as non-standard.
     */
+
+//! Files to export at once on the task scheduler; 0 means one per batch
+//! worker of the scheduler, because the main thread only shows progress; and
+//! 1 exports one file at a time as before
+IntSetting ExportThreads{ L"/Performance/ExportThreads", 0 };
+
+unsigned ExportThreadCount()
+{
+   const auto threads = ExportThreads.Read();
+   if (threads > 0)
+      return threads;
+   return TaskScheduler::Get().GetThreadCount();
+}
+
+/** \brief Choose the path to export to
+ *
+ * If overwriting, moves any existing file aside to backup; else makes the
+ * name unique among existing files and those in reserved */
+wxString PrepareDestination(const wxFileName &inName, bool overwrite,
+   wxFileName &backup, const FilePaths &reserved = {})
+{
+   wxFileName name = inName;
+   if (overwrite) {
+      backup.Assign(name);
+
+      int suffix = 0;
+      do {
+         backup.SetName(name.GetName() +
+                           wxString::Format(wxT("%d"), suffix));
+         ++suffix;
+      }
+      while (backup.FileExists());
+      ::wxRenameFile(inName.GetFullPath(), backup.GetFullPath());
+   }
+   else {
+      int i = 2;
+      wxString base(name.GetName());
+      while (name.FileExists() ||
+         reserved.Index(name.GetFullPath(), wxFileName::IsCaseSensitive())
+            != wxNOT_FOUND) {
+         name.SetName(wxString::Format(wxT("%s-%d"), base, i++));
+      }
+   }
+   return name.GetFullPath();
+}
+
+//! After an export, remove the backup or restore it, or remove any partial file
+void FinishDestination(const wxString &fullPath, const wxFileName &backup,
+   GenericUI::ProgressResult result)
+{
+   using ProgressResult = GenericUI::ProgressResult;
+   bool ok =
+      result == ProgressResult::Stopped ||
+      result == ProgressResult::Success;
+   if (backup.IsOk()) {
+      if ( ok )
+         // Remove backup
+         ::wxRemoveFile(backup.GetFullPath());
+      else {
+         // Restore original
+         if (::wxFileExists(fullPath))
+            ::wxRemoveFile(fullPath);
+         ::wxRenameFile(backup.GetFullPath(), fullPath);
+      }
+   }
+   else {
+      if ( ! ok && ::wxFileExists(fullPath) )
+         // Remove any new, and only partially written, file.
+         ::wxRemoveFile(fullPath);
+   }
+}
 }
 
 /* define our dynamic array of export settings */
@@ -869,6 +945,18 @@ ProgressResult ExportMultipleDialog::ExportMultipleByLabel(bool byName,
    }
 
    auto ok = ProgressResult::Success;   // did it work?
+
+   {
+      std::vector<FileToExport> files;
+      const auto tracks = ExportPlugin::ExportedTracks(*mTracks, false);
+      for (const auto &kit : exportSettings)
+         if (!kit.destfile.GetName().empty())
+            files.push_back({ tracks, channels, kit.destfile,
+               kit.t0, kit.t1, &kit.filetags });
+      if (ExportConcurrently(files, ok))
+         return ok;
+   }
+
    int count = 0; // count the number of successful runs
    ExportKit activeSetting;  // pointer to the settings in use for this export
    /* Go round again and do the exporting (so this run is slow but
@@ -1012,6 +1100,24 @@ ProgressResult ExportMultipleDialog::ExportMultipleByTrack(bool byName,
    }
    // end of user-interactive data gathering loop, start of export processing
    // loop
+   {
+      std::vector<FileToExport> files;
+      size_t ii = 0;
+      for (auto tr : mTracks->Leaders<WaveTrack>() - 
+         (anySolo ? &WaveTrack::GetNotSolo : &WaveTrack::GetMute)) {
+         const auto &kit = exportSettings[ii++];
+         if (kit.destfile.GetName().empty())
+            continue;
+         WaveTrackConstArray tracks;
+         for (auto channel : TrackList::Channels(tr))
+            tracks.push_back(channel->SharedPointer<const WaveTrack>());
+         files.push_back({ std::move(tracks), kit.channels, kit.destfile,
+            kit.t0, kit.t1, &kit.filetags });
+      }
+      if (ExportConcurrently(files, ok))
+         return ok;
+   }
+
    int count = 0; // count the number of successful runs
    ExportKit activeSetting;  // pointer to the settings in use for this export
    std::unique_ptr<ProgressDialog> pDialog;
@@ -1067,8 +1173,6 @@ ProgressResult ExportMultipleDialog::DoExport(std::unique_ptr<ProgressDialog> &p
                               double t1,
                               const Tags &tags)
 {
-   wxFileName name;
-
    wxLogDebug(wxT("Doing multiple Export: File name \"%s\""), (inName.GetFullName()));
    wxLogDebug(wxT("Channels: %i, Start: %lf, End: %lf "), channels, t0, t1);
    if (selectedOnly)
@@ -1077,50 +1181,13 @@ ProgressResult ExportMultipleDialog::DoExport(std::unique_ptr<ProgressDialog> &p
       wxLogDebug(wxT("Whole Project"));
 
    wxFileName backup;
-   if (mOverwrite->GetValue()) {
-      name = inName;
-      backup.Assign(name);
-
-      int suffix = 0;
-      do {
-         backup.SetName(name.GetName() +
-                           wxString::Format(wxT("%d"), suffix));
-         ++suffix;
-      }
-      while (backup.FileExists());
-      ::wxRenameFile(inName.GetFullPath(), backup.GetFullPath());
-   }
-   else {
-      name = inName;
-      int i = 2;
-      wxString base(name.GetName());
-      while (name.FileExists()) {
-         name.SetName(wxString::Format(wxT("%s-%d"), base, i++));
-      }
-   }
+   const wxString fullPath{
+      PrepareDestination(inName, mOverwrite->GetValue(), backup) };
 
    ProgressResult success = ProgressResult::Cancelled;
-   const wxString fullPath{name.GetFullPath()};
 
    auto cleanup = finally( [&] {
-      bool ok =
-         success == ProgressResult::Stopped ||
-         success == ProgressResult::Success;
-      if (backup.IsOk()) {
-         if ( ok )
-            // Remove backup
-            ::wxRemoveFile(backup.GetFullPath());
-         else {
-            // Restore original
-            ::wxRemoveFile(fullPath);
-            ::wxRenameFile(backup.GetFullPath(), fullPath);
-         }
-      }
-      else {
-         if ( ! ok )
-            // Remove any new, and only partially written, file.
-            ::wxRemoveFile(fullPath);
-      }
+      FinishDestination(fullPath, backup, success);
    } );
 
    // Call the format export routine
@@ -1145,6 +1212,120 @@ ProgressResult ExportMultipleDialog::DoExport(std::unique_ptr<ProgressDialog> &p
    return success;
 }
 
+bool ExportMultipleDialog::ExportConcurrently(
+   const std::vector<FileToExport> &files, ProgressResult &result)
+{
+   const auto nThreads = std::min<size_t>(ExportThreadCount(), files.size());
+   if (nThreads <= 1)
+      return false;
+
+   const auto pPlugin = mPlugins[mPluginIndex];
+   struct Job {
+      std::unique_ptr<ExportTask> task;
+      wxString fullPath;
+      wxFileName backup;
+      double duration{ 0 };
+      std::atomic<double> done{ 0 };
+      ProgressResult result{ ProgressResult::Cancelled };
+      std::exception_ptr exception;
+   };
+   ArrayOf<Job> jobs{ files.size() };
+   for (size_t ii = 0; ii < files.size(); ++ii) {
+      const auto &file = files[ii];
+      auto task = pPlugin->MakeExportTask(*mProject, file.tracks,
+         file.channels, file.name, file.t0, file.t1,
+         NULL, file.tags, mSubFormatIndex);
+      if (!task) {
+         // The format needs its own user interface
+         wxASSERT(ii == 0);
+         return false;
+      }
+      // The files, not the mixers, share the threads
+      task->SetMixerThreads(1);
+      jobs[ii].task = std::move(task);
+      jobs[ii].duration = std::max(0.0, file.t1 - file.t0);
+   }
+
+   // Choose all names now, in order, so that they do not depend on timing
+   FilePaths reserved;
+   for (size_t ii = 0; ii < files.size(); ++ii) {
+      auto &job = jobs[ii];
+      job.fullPath = PrepareDestination(files[ii].name, mOverwrite->GetValue(),
+         job.backup, reserved);
+      reserved.push_back(job.fullPath);
+   }
+
+   // Becomes Stopped or Cancelled when the user presses a button
+   std::atomic<ProgressResult> interruption{ ProgressResult::Success };
+   std::atomic<size_t> next{ 0 };
+   auto work = [&]{
+      for (size_t ii; (ii = next++) < files.size();) {
+         if (interruption != ProgressResult::Success)
+            break;
+         auto &job = jobs[ii];
+         try {
+            job.result = job.task->Run([&](double done){
+               job.done = done;
+               return interruption.load();
+            });
+         }
+         catch (...) {
+            job.exception = std::current_exception();
+            job.result = ProgressResult::Failed;
+         }
+         job.done = job.duration;
+      }
+   };
+   TaskGroup tasks;
+   for (size_t ii = 0; ii < nThreads; ++ii)
+      tasks.Run(work);
+
+   double total = 0;
+   for (size_t ii = 0; ii < files.size(); ++ii)
+      total += jobs[ii].duration;
+   {
+      ProgressDialog progress{ XO("Export Multiple"),
+         XO("Exporting %lld files").Format( (long long) files.size() ) };
+      // Tasks see the interruption themselves, so never cancel the group,
+      // which would skip files that no task has begun
+      tasks.Wait([&]{
+         double done = 0;
+         for (size_t ii = 0; ii < files.size(); ++ii)
+            done += std::min(jobs[ii].done.load(), jobs[ii].duration);
+         auto update = progress.Update(done, total);
+         if (update != ProgressResult::Success)
+            interruption = update;
+         return true;
+      });
+   }
+
+   // Account for the files in order
+   result = ProgressResult::Success;
+   std::exception_ptr exception;
+   for (size_t ii = 0; ii < files.size(); ++ii) {
+      auto &job = jobs[ii];
+      FinishDestination(job.fullPath, job.backup, job.result);
+      if (job.result == ProgressResult::Success ||
+          job.result == ProgressResult::Stopped)
+         mExported.push_back(job.fullPath);
+      else if (result == ProgressResult::Success) {
+         // Plug-ins return Cancelled too for errors that they report
+         result = job.result;
+         exception = job.exception;
+         job.task->ReportError();
+      }
+   }
+   if (interruption != ProgressResult::Success)
+      result = interruption;
+
+   Refresh();
+   Update();
+
+   if (exception)
+      std::rethrow_exception(exception);
+   return true;
+}
+
 wxString ExportMultipleDialog::MakeFileName(const wxString &input)
 {
    wxString newname = input; // name we are generating
@@ -83,6 +83,28 @@ private:
                  double t0,
                  double t1,
                  const Tags &tags);
+
+   //! What ExportConcurrently() needs to know about each file
+   struct FileToExport {
+      WaveTrackConstArray tracks;   /**< The tracks to mix */
+      unsigned channels;
+      wxFileNameWrapper name;
+      double t0;
+      double t1;
+      const Tags *tags;
+   };
+
+   /** \brief Export several files at once, each on a worker thread
+    *
+    * Files that fail do not stop the others.  Files are named, listed as
+    * exported, and the first failure reported, in the given order, however
+    * the threads finish.
+    * @return false, having done nothing, if export is configured for one
+    * thread, or the format can't export without user interface; else true,
+    * with the overall result in result */
+   bool ExportConcurrently(const std::vector<FileToExport> &files,
+                 ProgressResult &result);
+
    /** \brief Takes an arbitrary text string and converts it to a form that can
     * be used as a file name, if necessary prompting the user to edit the file
     * name produced */
@@ -290,24 +290,25 @@ ProgressResult ExportOGG::Export(TenacityProject *project,
             : XO("Exporting the audio as Ogg Vorbis") );
       auto &progress = *pDialog;
 
-      while (updateResult == ProgressResult::Success && !eos) {
+      // Give the encoder one run of samples, or with null, the end of them,
+      // and write what pages are ready
+      auto encode = [&](const MixedBlock *pMixed) {
          float **vorbis_buffer = vorbis_analysis_buffer(&dsp, SAMPLES_PER_RUN);
-         auto samplesThisRun = mixer->Process(SAMPLES_PER_RUN);
 
          int err;
-         if (samplesThisRun == 0) {
+         if (!pMixed) {
             // Tell the library that we wrote 0 bytes - signalling the end.
             err = vorbis_analysis_wrote(&dsp, 0);
          }
          else {
 
             for (size_t i = 0; i < numChannels; i++) {
-               float *temp = (float *)mixer->GetBuffer(i);
-               memcpy(vorbis_buffer[i], temp, sizeof(float)*SAMPLES_PER_RUN);
+               float *temp = (float *)pMixed->GetBuffer(i);
+               memcpy(vorbis_buffer[i], temp, sizeof(float)*pMixed->len);
             }
 
             // tell the encoder how many samples we have
-            err = vorbis_analysis_wrote(&dsp, samplesThisRun);
+            err = vorbis_analysis_wrote(&dsp, pMixed->len);
          }
 
          // I don't understand what this call does, so here is the comment
@@ -353,13 +354,27 @@ ProgressResult ExportOGG::Export(TenacityProject *project,
          }
 
          if (err) {
-            updateResult = ProgressResult::Cancelled;
             // TODO: more precise message
             ShowExportErrorDialog("OGG:355");
-            break;
+            return ProgressResult::Cancelled;
          }
-
-         updateResult = progress.Update(mixer->MixGetCurrentTime() - t0, t1 - t0);
+         return ProgressResult::Success;
+      };
+
+      updateResult = MixAndEncode(*mixer,
+         numChannels, SAMPLES_PER_RUN, false, floatSample,
+         [&](const MixedBlock &mixed) {
+            auto result = encode(&mixed);
+            if (result == ProgressResult::Success)
+               result = progress.Update(mixed.time - t0, t1 - t0);
+            return result;
+         });
+
+      if (updateResult == ProgressResult::Success ||
+          updateResult == ProgressResult::Stopped) {
+         auto result = encode(nullptr);
+         if (result != ProgressResult::Success)
+            updateResult = result;
       }
    }
 
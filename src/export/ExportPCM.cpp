@@ -399,20 +399,61 @@ public:
                          MixerSpec *mixerSpec = NULL,
                          const Tags *metadata = NULL,
                          int subformat = 0) override;
+   std::unique_ptr<ExportTask> MakeExportTask(TenacityProject &project,
+                         WaveTrackConstArray tracks,
+                         unsigned channels,
+                         const wxFileNameWrapper &fName,
+                         double t0,
+                         double t1,
+                         MixerSpec *mixerSpec = NULL,
+                         const Tags *metadata = NULL,
+                         int subformat = 0) override;
    // optional
    wxString GetFormat(int index) override;
    FileExtension GetExtension(int index) override;
    unsigned GetMaxChannels(int index) override;
 
 private:
-   void ReportTooBigError(wxWindow * pParent);
-   ArrayOf<char> AdjustString(const wxString & wxStr, int sf_format);
-   bool AddStrings(TenacityProject *project, SNDFILE *sf, const Tags *tags, int sf_format);
-   bool AddID3Chunk(
+   friend class PCMExportTask;
+
+   static int ExportFormat(int subformat);
+   static void ReportTooBigError(wxWindow * pParent);
+   static ArrayOf<char> AdjustString(const wxString & wxStr, int sf_format);
+   static bool AddStrings(TenacityProject *project, SNDFILE *sf, const Tags *tags, int sf_format);
+   static bool AddID3Chunk(
       const wxFileNameWrapper &fName, const Tags *tags, int sf_format);
 
 };
 
+class PCMExportTask final : public ExportTask
+{
+public:
+   PCMExportTask(TenacityProject &project,
+      WaveTrackConstArray tracks, unsigned numChannels,
+      const wxFileNameWrapper &fName, double t0, double t1,
+      MixerSpec *mixerSpec, const Tags &metadata, int sf_format)
+      : ExportTask{ std::move(tracks),
+         Mixer::WarpOptions{ TrackList::Get(project) }, mixerSpec }
+      , mRate{ ProjectRate::Get(project).GetRate() }
+      , mNumChannels{ numChannels }
+      , mFName{ fName }
+      , mT0{ t0 }
+      , mT1{ t1 }
+      , mMetadata{ metadata }
+      , mSfFormat{ sf_format }
+   {}
+
+   ProgressResult Run(const ProgressCallback &progress) override;
+
+private:
+   const double mRate;
+   const unsigned mNumChannels;
+   const wxFileNameWrapper mFName;
+   const double mT0, mT1;
+   const Tags mMetadata;
+   const int mSfFormat;
+};
+
 ExportPCM::ExportPCM()
    : ExportPlugin()
 {
@@ -476,9 +517,42 @@ ProgressResult ExportPCM::Export(TenacityProject *project,
                                  const Tags *metadata,
                                  int subformat)
 {
-   double rate = ProjectRate::Get( *project ).GetRate();
    const auto &tracks = TrackList::Get( *project );
+   auto task = MakeExportTask(*project, ExportedTracks(tracks, selectionOnly),
+      numChannels, fName, t0, t1, mixerSpec, metadata, subformat);
+
+   const auto fileFormat = ExportFormat(subformat) & SF_FORMAT_TYPEMASK;
+   const auto formatStr = SFCall<wxString>(sf_header_name, fileFormat);
+   return RunExportTask(*task, pDialog, fName,
+      (selectionOnly
+         ? XO("Exporting the selected audio as %s")
+         : XO("Exporting the audio as %s"))
+         .Format( formatStr ),
+      t0, t1);
+}
 
+std::unique_ptr<ExportTask> ExportPCM::MakeExportTask(
+                                 TenacityProject &project,
+                                 WaveTrackConstArray tracks,
+                                 unsigned numChannels,
+                                 const wxFileNameWrapper &fName,
+                                 double t0,
+                                 double t1,
+                                 MixerSpec *mixerSpec,
+                                 const Tags *metadata,
+                                 int subformat)
+{
+   // Retrieve tags if not given a set
+   if (metadata == NULL)
+      metadata = &Tags::Get( project );
+
+   return std::make_unique<PCMExportTask>(project, std::move(tracks),
+      numChannels, fName, t0, t1, mixerSpec, *metadata,
+      ExportFormat(subformat));
+}
+
+int ExportPCM::ExportFormat(int subformat)
+{
    // Set a default in case the settings aren't found
    int sf_format;
 
@@ -513,6 +587,18 @@ ProgressResult ExportPCM::Export(TenacityProject *project,
       sf_format |= SF_FORMAT_PCM_16;
    }
 
+   return sf_format;
+}
+
+ProgressResult PCMExportTask::Run(const ProgressCallback &progress)
+{
+   const auto rate = mRate;
+   const auto numChannels = mNumChannels;
+   const auto &fName = mFName;
+   const auto t0 = mT0, t1 = mT1;
+   const auto sf_format = mSfFormat;
+   const auto metadata = &mMetadata;
+
    int fileFormat = sf_format & SF_FORMAT_TYPEMASK;
    
    auto updateResult = ProgressResult::Success;
@@ -520,15 +606,9 @@ ProgressResult ExportPCM::Export(TenacityProject *project,
       wxFile f;   // will be closed when it goes out of scope
       SFFile       sf; // wraps f
 
-      wxString     formatStr;
       SF_INFO      info;
       //int          err;
 
-      //This whole operation should not occur while a file is being loaded on OD,
-      //(we are worried about reading from a file being written to,) so we block.
-      //Furthermore, we need to do this because libsndfile is not threadsafe.
-      formatStr = SFCall<wxString>(sf_header_name, fileFormat);
-
       // Use libsndfile to export file
 
       info.samplerate = (unsigned int)(rate + 0.5);
@@ -541,14 +621,15 @@ ProgressResult ExportPCM::Export(TenacityProject *project,
       // Bug 46.  Trap here, as sndfile.c does not trap it properly.
       if( (numChannels != 1) && ((sf_format & SF_FORMAT_SUBMASK) == SF_FORMAT_GSM610) )
       {
-         AudacityMessageBox( XO("GSM 6.10 requires mono") );
-         return ProgressResult::Cancelled;
+         return Fail(ProgressResult::Cancelled,
+            []{ AudacityMessageBox( XO("GSM 6.10 requires mono") ); });
       }
 
       if (sf_format == SF_FORMAT_WAVEX + SF_FORMAT_GSM610) {
-         AudacityMessageBox(
-            XO("WAVEX and GSM 6.10 formats are not compatible") );
-         return ProgressResult::Cancelled;
+         return Fail(ProgressResult::Cancelled, []{
+            AudacityMessageBox(
+               XO("WAVEX and GSM 6.10 formats are not compatible") );
+         });
       }
 
       // If we can't export exactly the format they requested,
@@ -560,8 +641,9 @@ ProgressResult ExportPCM::Export(TenacityProject *project,
       if (!sf_format_check(&info))
          info.format = (info.format & SF_FORMAT_TYPEMASK);
       if (!sf_format_check(&info)) {
-         AudacityMessageBox( XO("Cannot export audio in this format.") );
-         return ProgressResult::Cancelled;
+         return Fail(ProgressResult::Cancelled, []{
+            AudacityMessageBox( XO("Cannot export audio in this format.") );
+         });
       }
       const auto path = fName.GetFullPath();
       if (f.Open(path, wxFile::write)) {
@@ -574,18 +656,15 @@ ProgressResult ExportPCM::Export(TenacityProject *project,
       }
 
       if (!sf) {
-         AudacityMessageBox( XO("Cannot export audio to %s").Format( path ) );
-         return ProgressResult::Cancelled;
+         return Fail(ProgressResult::Cancelled, [path]{
+            AudacityMessageBox( XO("Cannot export audio to %s").Format( path ) );
+         });
       }
-      // Retrieve tags if not given a set
-      if (metadata == NULL)
-         metadata = &Tags::Get( *project );
-
       // Install the meta data at the beginning of the file (except for
       // WAV and WAVEX formats)
       if (fileFormat != SF_FORMAT_WAV &&
           fileFormat != SF_FORMAT_WAVEX) {
-         if (!AddStrings(project, sf.get(), metadata, sf_format)) {
+         if (!ExportPCM::AddStrings(nullptr, sf.get(), metadata, sf_format)) {
             return ProgressResult::Cancelled;
          }
       }
@@ -608,53 +687,44 @@ ProgressResult ExportPCM::Export(TenacityProject *project,
          // Test for 4 Gibibytes, rather than 4 Gigabytes
          if( byteCount > 4.295e9)
          {
-            ReportTooBigError( wxTheApp->GetTopWindow() );
-            return ProgressResult::Failed;
+            return Fail(ProgressResult::Failed, []{
+               ExportPCM::ReportTooBigError( wxTheApp->GetTopWindow() );
+            });
          }
       }
       size_t maxBlockLen = 44100 * 5;
 
       {
          std::vector<char> dither;
+         Dither ditherer;
          if ((info.format & SF_FORMAT_SUBMASK) == SF_FORMAT_PCM_24) {
             dither.reserve(maxBlockLen * info.channels * SAMPLE_SIZE(int24Sample));
          }
 
          wxASSERT(info.channels >= 0);
-         auto mixer = CreateMixer(tracks, selectionOnly,
-                                  t0, t1,
+         auto mixer = CreateMixer(t0, t1,
                                   info.channels, maxBlockLen, true,
-                                  rate, format, mixerSpec);
-
-         InitProgress( pDialog, fName,
-            (selectionOnly
-               ? XO("Exporting the selected audio as %s")
-               : XO("Exporting the audio as %s"))
-               .Format( formatStr ) );
-         auto &progress = *pDialog;
+                                  rate, format);
 
-         while (updateResult == ProgressResult::Success) {
+         updateResult = ExportPlugin::MixAndEncode(*mixer,
+            info.channels, maxBlockLen, true, format,
+            [&](const MixedBlock &block) {
             sf_count_t samplesWritten;
-            size_t numSamples = mixer->Process(maxBlockLen);
-
-            if (numSamples == 0)
-               break;
-
-            auto mixed = mixer->GetBuffer();
+            const auto numSamples = block.len;
+            auto mixed = block.GetBuffer();
 
             // Bug 1572: Not ideal, but it does add the desired dither
             if ((info.format & SF_FORMAT_SUBMASK) == SF_FORMAT_PCM_24) {
                for (int c = 0; c < info.channels; ++c) {
-                  CopySamples(
+                  ditherer.Apply(gHighQualityDither,
                      mixed + (c * SAMPLE_SIZE(format)), format,
                      dither.data() + (c * SAMPLE_SIZE(int24Sample)), int24Sample,
-                     numSamples, gHighQualityDither, info.channels, info.channels
+                     numSamples, info.channels, info.channels
                   );
                   // Copy back without dither
                   CopySamples(
                      dither.data() + (c * SAMPLE_SIZE(int24Sample)), int24Sample,
-                     const_cast<samplePtr>(mixed) // PRL fix this!
-                        + (c * SAMPLE_SIZE(format)), format,
+                     mixed + (c * SAMPLE_SIZE(format)), format,
                      numSamples, DitherType::none, info.channels, info.channels);
                }
             }
@@ -681,16 +751,16 @@ ProgressResult ExportPCM::Export(TenacityProject *project,
                // other cases of disk exhaustion.
                // The thrown exception doesn't escape but GuardedCall
                // will enqueue a message.
-               GuardedCall([&fName]{
-                  throw FileException{
-                     FileException::Cause::Write, fName }; });
+               return Fail(ProgressResult::Cancelled, [fName]{
+                  GuardedCall([&fName]{
+                     throw FileException{
+                        FileException::Cause::Write, fName }; });
+               });
 #endif
-               updateResult = ProgressResult::Cancelled;
-               break;
             }
             
-            updateResult = progress.Update(mixer->MixGetCurrentTime() - t0, t1 - t0);
-         }
+            return progress(block.time - t0);
+         });
       }
       
       // Install the WAV metata in a "LIST" chunk at the end of the file
@@ -698,16 +768,16 @@ ProgressResult ExportPCM::Export(TenacityProject *project,
           updateResult == ProgressResult::Stopped) {
          if (fileFormat == SF_FORMAT_WAV ||
              fileFormat == SF_FORMAT_WAVEX) {
-            if (!AddStrings(project, sf.get(), metadata, sf_format)) {
+            if (!ExportPCM::AddStrings(nullptr, sf.get(), metadata, sf_format)) {
                // TODO: more precise message
-               ShowExportErrorDialog("PCM:675");
-               return ProgressResult::Cancelled;
+               return Fail(ProgressResult::Cancelled,
+                  []{ ShowExportErrorDialog("PCM:675"); });
             }
          }
          if (0 != sf.close()) {
             // TODO: more precise message
-            ShowExportErrorDialog("PCM:681");
-            return ProgressResult::Cancelled;
+            return Fail(ProgressResult::Cancelled,
+               []{ ShowExportErrorDialog("PCM:681"); });
          }
       }
    }
@@ -717,10 +787,10 @@ ProgressResult ExportPCM::Export(TenacityProject *project,
       if ((fileFormat == SF_FORMAT_AIFF) ||
           (fileFormat == SF_FORMAT_WAV))
          // Note: file has closed, and gets reopened and closed again here:
-         if (!AddID3Chunk(fName, metadata, sf_format) ) {
+         if (!ExportPCM::AddID3Chunk(fName, metadata, sf_format) ) {
             // TODO: more precise message
-            ShowExportErrorDialog("PCM:694");
-            return ProgressResult::Cancelled;
+            return Fail(ProgressResult::Cancelled,
+               []{ ShowExportErrorDialog("PCM:694"); });
          }
 
    return updateResult;
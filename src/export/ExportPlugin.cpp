@@ -12,12 +12,70 @@
 #include "ExportPlugin.h"
 #include "Export.h"
 
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <mutex>
+
 // Tenacity libraries
 #include <lib-files/wxFileNameWrapper.h>
 #include <lib-track/Track.h>
+#include <lib-utility/TaskScheduler.h>
 
 #include "../WaveTrack.h"
 
+namespace {
+//! How many mixed runs may wait for the encoder in ExportPlugin::MixAndEncode()
+constexpr size_t MixAheadRuns = 3;
+}
+
+
+ExportTask::ExportTask(WaveTrackConstArray tracks,
+   const Mixer::WarpOptions &warpOptions, MixerSpec *mixerSpec)
+    : mTracks{ std::move(tracks) }
+    , mWarpOptions{ warpOptions }
+    , mMixerSpec{ mixerSpec }
+    , mMixerThreads{ Mixer::DefaultThreads() }
+{
+}
+
+ExportTask::~ExportTask()
+{
+}
+
+void ExportTask::ReportError()
+{
+    if (auto report = std::move(mReport)) {
+        mReport = nullptr;
+        report();
+    }
+}
+
+ExportTask::ProgressResult ExportTask::Fail(
+   ProgressResult result, std::function<void()> report)
+{
+    mReport = std::move(report);
+    return result;
+}
+
+std::unique_ptr<Mixer> ExportTask::CreateMixer(
+            double startTime, double stopTime,
+            unsigned numOutChannels, size_t outBufferSize, bool outInterleaved,
+            double outRate, sampleFormat outFormat) const
+{
+    auto mixer = std::make_unique<Mixer>(
+        mTracks,
+        // Throw, to stop exporting, if read fails:
+        true,
+        mWarpOptions,
+        startTime, stopTime,
+        numOutChannels, outBufferSize, outInterleaved,
+        outRate, outFormat,
+        true, mMixerSpec
+    );
+    mixer->SetThreads(mMixerThreads);
+    return mixer;
+}
 
 ExportPlugin::ExportPlugin()
 {
@@ -165,13 +223,16 @@ void ExportPlugin::OptionsCreate(ShuttleGui &S, int WXUNUSED(format))
     S.EndHorizontalLay();
 }
 
-/// Creates a mixer by computing the time warp factor
-std::unique_ptr<Mixer> ExportPlugin::CreateMixer(const TrackList &tracks,
-            bool selectionOnly,
-            double startTime, double stopTime,
-            unsigned numOutChannels, size_t outBufferSize, bool outInterleaved,
-            double outRate, sampleFormat outFormat,
-            MixerSpec *mixerSpec)
+std::unique_ptr<ExportTask> ExportPlugin::MakeExportTask(
+            TenacityProject &, WaveTrackConstArray,
+            unsigned, const wxFileNameWrapper &, double, double,
+            MixerSpec *, const Tags *, int)
+{
+    return nullptr;
+}
+
+WaveTrackConstArray ExportPlugin::ExportedTracks(
+            const TrackList &tracks, bool selectionOnly)
 {
     WaveTrackConstArray inputTracks;
 
@@ -186,10 +247,136 @@ std::unique_ptr<Mixer> ExportPlugin::CreateMixer(const TrackList &tracks,
             pTrack->SharedPointer< const WaveTrack >()
         );
     }
+    return inputTracks;
+}
+
+ExportPlugin::ProgressResult ExportPlugin::MixAndEncode(Mixer &mixer,
+   unsigned numChannels, size_t outBufferSize, bool outInterleaved,
+   sampleFormat outFormat, const Encoder &encode)
+{
+    const unsigned numBuffers = outInterleaved ? 1 : numChannels;
+    const size_t width = outInterleaved ? numChannels : 1;
+    const size_t bufferBytes = outBufferSize * width * SAMPLE_SIZE(outFormat);
+
+    // A ring of runs, each with its own copy of the mixer's buffers
+    ArrayOf<char> storage{ MixAheadRuns * numBuffers * bufferBytes };
+    MixedBlock runs[MixAheadRuns];
+    for (size_t ii = 0; ii < MixAheadRuns; ++ii)
+        for (unsigned jj = 0; jj < numBuffers; ++jj)
+            runs[ii].buffers.push_back(
+                storage.get() + (ii * numBuffers + jj) * bufferBytes);
+
+    // Copies the next run of the mixer into run; false when it is done
+    const auto mix = [&](MixedBlock &run){
+        const auto len = mixer.Process(outBufferSize);
+        if (len == 0)
+            return false;
+        for (unsigned jj = 0; jj < numBuffers; ++jj)
+            memcpy(run.buffers[jj],
+                outInterleaved ? mixer.GetBuffer() : mixer.GetBuffer(jj),
+                len * width * SAMPLE_SIZE(outFormat));
+        run.len = len;
+        run.time = mixer.MixGetCurrentTime();
+        return true;
+    };
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    // Counts of runs mixed and encoded
+    size_t mixed = 0, encoded = 0;
+    // Whether a thread is in the mixer, a task is queued or running, the
+    // mixer is exhausted, or the encoder quit
+    bool mixing = false, queued = false, done = false, stop = false;
+    std::exception_ptr exception;
+
+    // Mix up to limit runs, while there is room and no other thread mixes;
+    // the lock is held on entry and exit
+    const auto mixAhead = [&](std::unique_lock<std::mutex> &lock, size_t limit){
+        for (; limit > 0 && !mixing && !done && !stop &&
+             mixed - encoded < MixAheadRuns; --limit) {
+            mixing = true;
+            auto &run = runs[mixed % MixAheadRuns];
+            lock.unlock();
+            bool more = false;
+            std::exception_ptr error;
+            try {
+                more = mix(run);
+            }
+            catch (...) {
+                error = std::current_exception();
+            }
+            lock.lock();
+            mixing = false;
+            if (more)
+                ++mixed;
+            else {
+                done = true;
+                exception = error;
+            }
+            changed.notify_all();
+        }
+    };
+
+    // A task mixes until the ring is full, then ends, rather than waiting
+    // for room and holding a worker; the encoder queues another as it frees
+    // runs.  If no worker takes it soon, the encoder mixes by itself.
+    TaskGroup tasks;
+    const auto schedule = [&]{
+        if (queued || done || stop)
+            return;
+        queued = true;
+        tasks.Run([&]{
+            std::unique_lock<std::mutex> lock{ mutex };
+            mixAhead(lock, MixAheadRuns);
+            queued = false;
+        });
+    };
+
+    auto result = ProgressResult::Success;
+    {
+        std::unique_lock<std::mutex> lock{ mutex };
+        auto cleanup = finally([&]{
+            if (!lock.owns_lock())
+                lock.lock();
+            stop = true;
+        });
+        schedule();
+        while (result == ProgressResult::Success) {
+            // Wait only while a task is in the mixer, for at most one run
+            changed.wait(lock, [&]{ return mixed > encoded || done || !mixing; });
+            if (mixed == encoded) {
+                if (done)
+                    break;
+                mixAhead(lock, 1);
+                continue;
+            }
+            auto &run = runs[encoded % MixAheadRuns];
+            lock.unlock();
+            result = encode(run);
+            lock.lock();
+            ++encoded;
+            schedule();
+        }
+    }
+    // A task still queued sees stop, and one running finishes its run
+    tasks.Wait();
 
+    if (result == ProgressResult::Success && exception)
+        std::rethrow_exception(exception);
+    return result;
+}
+
+/// Creates a mixer by computing the time warp factor
+std::unique_ptr<Mixer> ExportPlugin::CreateMixer(const TrackList &tracks,
+            bool selectionOnly,
+            double startTime, double stopTime,
+            unsigned numOutChannels, size_t outBufferSize, bool outInterleaved,
+            double outRate, sampleFormat outFormat,
+            MixerSpec *mixerSpec)
+{
     // MB: the stop time should not be warped, this was a bug.
-    return std::make_unique<Mixer>(
-        inputTracks,
+    auto mixer = std::make_unique<Mixer>(
+        ExportedTracks(tracks, selectionOnly),
         // Throw, to stop exporting, if read fails:
         true,
         Mixer::WarpOptions{tracks},
@@ -198,6 +385,27 @@ std::unique_ptr<Mixer> ExportPlugin::CreateMixer(const TrackList &tracks,
         outRate, outFormat,
         true, mixerSpec
     );
+    mixer->SetThreads(Mixer::DefaultThreads());
+    return mixer;
+}
+
+ExportPlugin::ProgressResult ExportPlugin::RunExportTask(ExportTask &task,
+   std::unique_ptr<ProgressDialog> &pDialog,
+   const wxFileNameWrapper &title, const TranslatableString &message,
+   double t0, double t1)
+{
+    // The dialog appears when there is progress to show, so that errors
+    // before that are not reported over an empty one
+    bool started = false;
+    auto result = task.Run([&](double done){
+        if (!started) {
+            InitProgress(pDialog, title, message);
+            started = true;
+        }
+        return pDialog->Update(done, t1 - t0);
+    });
+    task.ReportError();
+    return result;
 }
 
 void ExportPlugin::InitProgress(std::unique_ptr<ProgressDialog> &pDialog,
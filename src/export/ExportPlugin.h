@@ -11,6 +11,7 @@
 
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <vector>
 
@@ -45,6 +46,68 @@ struct TENACITY_DLL_API FormatInfo
     bool mCanMetaData;
 };
 
+//! One run of samples that ExportPlugin::MixAndEncode() mixed
+struct MixedBlock
+{
+   //! The interleaved buffer, or that of one channel, like Mixer::GetBuffer();
+   //! the encoder may overwrite the samples
+   samplePtr GetBuffer(unsigned buffer = 0) const { return buffers[buffer]; }
+
+   std::vector<samplePtr> buffers;
+   //! Number of samples in each channel
+   size_t len{ 0 };
+   //! Mixer::MixGetCurrentTime() at the end of the run, for progress
+   double time{ 0 };
+};
+
+//! The work of one export, which may run on a worker thread
+/*!
+ A plug-in makes it on the main thread, reading preferences and the project
+ there.  Run() then uses neither, nor any user interface, so that several
+ tasks can run at once.  Errors are remembered, and ReportError() shows them
+ afterward on the main thread.
+ */
+class TENACITY_DLL_API ExportTask /* not final */
+{
+public:
+   using ProgressResult = GenericUI::ProgressResult;
+
+   //! Receives the seconds exported so far; returns other than Success to
+   //! stop or cancel the export
+   using ProgressCallback = std::function<ProgressResult(double)>;
+
+   virtual ~ExportTask();
+
+   //! Export, calling back with progress on the same thread
+   /*! @return as for ExportPlugin::Export() */
+   virtual ProgressResult Run(const ProgressCallback &progress) = 0;
+
+   //! Show the user why Run() failed, if it did, just once
+   void ReportError();
+
+   //! How many threads the mixer of Run() may use; default from preferences
+   void SetMixerThreads(unsigned nThreads) { mMixerThreads = nThreads; }
+
+protected:
+   ExportTask(WaveTrackConstArray tracks, const Mixer::WarpOptions &warpOptions,
+      MixerSpec *mixerSpec);
+
+   std::unique_ptr<Mixer> CreateMixer(double startTime, double stopTime,
+      unsigned numOutChannels, size_t outBufferSize, bool outInterleaved,
+      double outRate, sampleFormat outFormat) const;
+
+   //! Remember how to tell the user of an error
+   /*! @return result */
+   ProgressResult Fail(ProgressResult result, std::function<void()> report);
+
+private:
+   const WaveTrackConstArray mTracks;
+   const Mixer::WarpOptions mWarpOptions;
+   MixerSpec *const mMixerSpec;
+   unsigned mMixerThreads;
+   std::function<void()> mReport;
+};
+
 class TENACITY_DLL_API ExportPlugin /* not final */
 {
     public:
@@ -118,6 +181,49 @@ class TENACITY_DLL_API ExportPlugin /* not final */
                                       const Tags *metadata = NULL,
                                       int subformat = 0) = 0;
 
+        /** \brief Make a task doing what Export() does, but without user
+        * interface, so that it may run on another thread
+        *
+        * @param tracks the tracks to mix, which must not change until the
+        * task is destroyed
+        * @param metadata if null, the project's tags are used
+        * @return null if the sub-format does not support tasks, which is the
+        * default
+        */
+        virtual std::unique_ptr<ExportTask> MakeExportTask(
+                                      TenacityProject &project,
+                                      WaveTrackConstArray tracks,
+                                      unsigned channels,
+                                      const wxFileNameWrapper &fName,
+                                      double t0,
+                                      double t1,
+                                      MixerSpec *mixerSpec = NULL,
+                                      const Tags *metadata = NULL,
+                                      int subformat = 0);
+
+        //! Receives each mixed run in turn; returns other than Success to end
+        //! the export
+        using Encoder = std::function<ProgressResult(const MixedBlock &)>;
+
+        /** \brief Mix in tasks of the TaskScheduler while this thread encodes
+        *
+        * The mixer runs a few blocks ahead of the encoder, so that an export
+        * takes as long as the slower of the two, not their sum.  The encoder,
+        * and so any progress dialog it updates, stays on the calling thread,
+        * which also mixes when no task is mixing, as when the workers are
+        * busy; so it never waits longer than one block takes to mix.
+        * @param mixer made with the other arguments
+        * @return the first result of encode other than Success, or Success
+        * when the mixer is done.  Rethrows exceptions of the mixer.
+        */
+        static ProgressResult MixAndEncode(Mixer &mixer,
+                unsigned numChannels, size_t outBufferSize, bool outInterleaved,
+                sampleFormat outFormat, const Encoder &encode);
+
+        //! The audible wave tracks of the list, or only the selected ones
+        static WaveTrackConstArray ExportedTracks(
+                const TrackList &tracks, bool selectionOnly);
+
     protected:
         std::unique_ptr<Mixer> CreateMixer(const TrackList &tracks,
                 bool selectionOnly,
@@ -126,6 +232,12 @@ class TENACITY_DLL_API ExportPlugin /* not final */
                 double outRate, sampleFormat outFormat,
                 MixerSpec *mixerSpec);
 
+    //! Run the task for Export(), showing progress, then report any error
+    static ProgressResult RunExportTask(ExportTask &task,
+            std::unique_ptr<ProgressDialog> &pDialog,
+            const wxFileNameWrapper &title, const TranslatableString &message,
+            double t0, double t1);
+
     // Create or recycle a dialog.
     static void InitProgress(std::unique_ptr<ProgressDialog> &pDialog,
             const TranslatableString &title, const TranslatableString &message);
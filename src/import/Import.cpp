@@ -41,8 +41,11 @@ ImportLOF.cpp, ImportMka.cpp, and ImportAUP.cpp.
 #include <lib-files/FileNames.h>
 #include <lib-preferences/Prefs.h>
 #include <lib-project/Project.h>
+#include <lib-utility/TaskScheduler.h>
 
 #include <algorithm>
+#include <atomic>
+#include <deque>
 #include <unordered_set>
 
 #include <wx/textctrl.h>
@@ -451,46 +454,83 @@ std::unique_ptr<ExtImportItem> Importer::CreateDefaultImportItem()
    return new_item;
 }
 
-// returns number of tracks imported
-bool Importer::Import( TenacityProject &project,
-                     const FilePath &fName,
-                     WaveTrackFactory *trackFactory,
-                     TrackHolders &tracks,
-                     Tags *tags,
-                     LabelHolders &labels,
-                     TranslatableString &errorMessage)
+namespace {
+//! What becomes of a file after one plugin has imported it
+enum class ImportOutcome { Succeeded, Failed, TryNextPlugin };
+
+ImportOutcome JudgeImport(ProgressResult res,
+   const FileExtension &extension, TrackHolders &tracks)
 {
-   TenacityProject *pProj = &project;
-   auto cleanup = valueRestorer( pProj->mbBusyImporting, true );
+   if (res == ProgressResult::Success || res == ProgressResult::Stopped)
+   {
+      // LOF ("list-of-files") has different semantics
+      if (extension.IsSameAs(wxT("lof"), false))
+      {
+         return ImportOutcome::Succeeded;
+      }
 
-   const FileExtension extension{ fName.AfterLast(wxT('.')) };
+      // AUP ("legacy projects") have different semantics
+      if (extension.IsSameAs(wxT("aup"), false))
+      {
+         return ImportOutcome::Succeeded;
+      }
 
-   // Always refuse to import MIDI, even though the FFmpeg plugin pretends to know how (but makes very bad renderings)
-#ifdef USE_MIDI
-   // MIDI files must be imported, not opened
-   if (FileNames::IsMidi(fName)) {
-      errorMessage = XO(
-"\"%s\" \nis a MIDI file, not an audio file. \nTenacity cannot open this type of file for playing, but you can\nedit it by clicking File > Import > MIDI.")
-         .Format( fName );
-      return false;
+      auto end = tracks.end();
+      auto iter = std::remove_if( tracks.begin(), end,
+         std::mem_fn( &NewChannelGroup::empty ) );
+      if ( iter != end ) {
+         // importer shouldn't give us empty groups of channels!
+         wxASSERT(false);
+         // But correct that and proceed anyway
+         tracks.erase( iter, end );
+      }
+      if (tracks.size() > 0)
+      {
+         // success!
+         return ImportOutcome::Succeeded;
+      }
    }
-#endif
 
-   // Bug #2647: Peter has a Word 2000 .doc file that is recognized and imported by FFmpeg.
-   if (wxFileName(fName).GetExt() == wxT("doc")) {
-      errorMessage =
-         XO("\"%s\" \nis a not an audio file. \nTenacity cannot open this type of file.")
-         .Format( fName );
-      return false;
+   if (res == ProgressResult::Cancelled || res == ProgressResult::Failed)
+   {
+      return ImportOutcome::Failed;
    }
 
-   using ImportPluginPtrs = std::vector< ImportPlugin* >;
+   return ImportOutcome::TryNextPlugin;
+}
 
-   // This list is used to call plugins in correct order
-   ImportPluginPtrs importPlugins;
+//! Progress of one file among others imported concurrently
+/*! Records the fraction read, for the main thread to sum up, and answers
+ what the main thread last learned from the one dialog of all the files */
+class SharedImportProgress final : public ImportProgress
+{
+public:
+   SharedImportProgress(std::atomic<double> &fraction,
+      const std::atomic<ProgressResult> &control)
+      : mFraction{ fraction }
+      , mControl{ control }
+   {
+   }
 
-   // This list is used to remember plugins that should have been compatible with the file.
-   ImportPluginPtrs compatiblePlugins;
+private:
+   ProgressResult Report(double current, double total) override
+   {
+      mFraction.store(total > 0 ? std::min(1.0, current / total) : 1.0,
+         std::memory_order_relaxed);
+      return mControl.load(std::memory_order_relaxed);
+   }
+
+   std::atomic<double> &mFraction;
+   const std::atomic<ProgressResult> &mControl;
+};
+}
+
+std::vector< ImportPlugin* > Importer::GetPluginsFor(const FilePath &fName)
+{
+   const FileExtension extension{ fName.AfterLast(wxT('.')) };
+
+   // This list is used to call plugins in correct order
+   std::vector< ImportPlugin* > importPlugins;
 
    // Not implemented (yet?)
    wxString mime_type = wxT("*");
@@ -603,6 +643,50 @@ bool Importer::Import( TenacityProject &project,
       }
    }
 
+   return importPlugins;
+}
+
+// returns number of tracks imported
+bool Importer::Import( TenacityProject &project,
+                     const FilePath &fName,
+                     WaveTrackFactory *trackFactory,
+                     TrackHolders &tracks,
+                     Tags *tags,
+                     LabelHolders &labels,
+                     TranslatableString &errorMessage)
+{
+   TenacityProject *pProj = &project;
+   auto cleanup = valueRestorer( pProj->mbBusyImporting, true );
+
+   const FileExtension extension{ fName.AfterLast(wxT('.')) };
+
+   // Always refuse to import MIDI, even though the FFmpeg plugin pretends to know how (but makes very bad renderings)
+#ifdef USE_MIDI
+   // MIDI files must be imported, not opened
+   if (FileNames::IsMidi(fName)) {
+      errorMessage = XO(
+"\"%s\" \nis a MIDI file, not an audio file. \nTenacity cannot open this type of file for playing, but you can\nedit it by clicking File > Import > MIDI.")
+         .Format( fName );
+      return false;
+   }
+#endif
+
+   // Bug #2647: Peter has a Word 2000 .doc file that is recognized and imported by FFmpeg.
+   if (wxFileName(fName).GetExt() == wxT("doc")) {
+      errorMessage =
+         XO("\"%s\" \nis a not an audio file. \nTenacity cannot open this type of file.")
+         .Format( fName );
+      return false;
+   }
+
+   using ImportPluginPtrs = std::vector< ImportPlugin* >;
+
+   // This list is used to call plugins in correct order
+   const ImportPluginPtrs importPlugins = GetPluginsFor(fName);
+
+   // This list is used to remember plugins that should have been compatible with the file.
+   ImportPluginPtrs compatiblePlugins;
+
    // Try the import plugins, in the permuted sequences just determined
    for (const auto plugin : importPlugins)
    {
@@ -628,39 +712,13 @@ bool Importer::Import( TenacityProject &project,
 
          auto res = inFile->Import(trackFactory, tracks, tags, labels);
 
-         if (res == ProgressResult::Success || res == ProgressResult::Stopped)
-         {
-            // LOF ("list-of-files") has different semantics
-            if (extension.IsSameAs(wxT("lof"), false))
-            {
-               return true;
-            }
-
-            // AUP ("legacy projects") have different semantics
-            if (extension.IsSameAs(wxT("aup"), false))
-            {
-               return true;
-            }
-
-            auto end = tracks.end();
-            auto iter = std::remove_if( tracks.begin(), end,
-               std::mem_fn( &NewChannelGroup::empty ) );
-            if ( iter != end ) {
-               // importer shouldn't give us empty groups of channels!
-               wxASSERT(false);
-               // But correct that and proceed anyway
-               tracks.erase( iter, end );
-            }
-            if (tracks.size() > 0)
-            {
-               // success!
-               return true;
-            }
-         }
-
-         if (res == ProgressResult::Cancelled || res == ProgressResult::Failed)
-         {
+         switch (JudgeImport(res, extension, tracks)) {
+         case ImportOutcome::Succeeded:
+            return true;
+         case ImportOutcome::Failed:
             return false;
+         default:
+            break;
          }
 
          // We could exit here since we had a match on the file extension,
@@ -831,6 +889,135 @@ bool Importer::Import( TenacityProject &project,
    return false;
 }
 
+void Importer::ImportConcurrently(TenacityProject &project,
+   WaveTrackFactory *trackFactory, std::vector<ConcurrentImport> &files)
+{
+   // One file gains nothing, and shows its own dialog in Import()
+   if (files.size() < 2)
+      return;
+
+   auto cleanup = valueRestorer( project.mbBusyImporting, true );
+
+   //! A file opened in this thread, to decode in the task scheduler
+   struct Job {
+      Job(ConcurrentImport &file_, std::unique_ptr<ImportFileHandle> handle_)
+         : file{ file_ }
+         , handle{ std::move(handle_) }
+         // Weigh the files by size, so that the progress moves evenly
+         , weight{ std::max(1.0,
+            static_cast<double>(handle->GetFileUncompressedBytes())) }
+      {
+      }
+
+      ConcurrentImport &file;
+      const std::unique_ptr<ImportFileHandle> handle;
+      const double weight;
+      std::atomic<double> fraction{ 0 };
+      //! Unstarted jobs of a cancelled group count as cancelled
+      ProgressResult result{ ProgressResult::Cancelled };
+   };
+   std::deque<Job> jobs;
+
+   for (auto &file : files) {
+      const auto &fName = file.fileName;
+
+      // Leave files that Import() refuses to it, to explain
+#ifdef USE_MIDI
+      if (FileNames::IsMidi(fName))
+         continue;
+#endif
+      if (wxFileName(fName).GetExt() == wxT("doc"))
+         continue;
+
+      // Open with the first plugin that understands the file, as Import()
+      // would, and choose the streams now, in the main thread
+      for (const auto plugin : GetPluginsFor(fName)) {
+         wxLogMessage(wxT("Opening with %s"),plugin->GetPluginStringID());
+         auto inFile = plugin->Open(fName, &project);
+         if (!inFile || inFile->GetStreamCount() <= 0)
+            continue;
+         if (!inFile->SupportsConcurrentImport())
+            break;
+         wxLogMessage(wxT("Open(%s) succeeded"), fName);
+         if (inFile->GetStreamCount() > 1) {
+            ImportStreamDialog ImportDlg(inFile.get(), NULL, -1, XO("Select stream(s) to import"));
+            if (ImportDlg.ShowModal() == wxID_CANCEL) {
+               file.imported = true;
+               break;
+            }
+         }
+         else
+            inFile->SetStreamUsage(0,TRUE);
+         jobs.emplace_back(file, std::move(inFile));
+         break;
+      }
+   }
+
+   if (jobs.empty())
+      return;
+
+   std::atomic<ProgressResult> control{ ProgressResult::Success };
+   double totalWeight = 0;
+   for (auto &job : jobs) {
+      job.handle->SetProgress(
+         std::make_unique<SharedImportProgress>(job.fraction, control));
+      totalWeight += job.weight;
+   }
+
+   ProgressDialog progress{
+      /* i18n-hint: %d is the number of files being imported together */
+      XO("Importing %d files").Format( static_cast<int>(jobs.size()) ) };
+
+   // Declared last, so that it waits for its tasks before the rest goes
+   TaskGroup group;
+   for (auto &job : jobs)
+      group.Run([&job, trackFactory]{
+         auto &file = job.file;
+         try {
+            job.result = job.handle->Import(trackFactory,
+               file.tracks, file.tags.get(), file.labelTracks);
+         }
+         catch (...) {
+            file.error = std::current_exception();
+         }
+         job.fraction.store(1.0, std::memory_order_relaxed);
+      });
+   group.Wait([&]{
+      double done = 0;
+      for (auto &job : jobs)
+         done += job.weight * job.fraction.load(std::memory_order_relaxed);
+      const auto result = progress.Update(done, totalWeight);
+      if (result != ProgressResult::Success)
+         control = result;
+      // A stop lets each import keep what it has read; a cancel also skips
+      // the files not yet begun
+      return result != ProgressResult::Cancelled;
+   });
+
+   for (auto &job : jobs) {
+      auto &file = job.file;
+      file.imported = true;
+      if (file.error)
+         continue;
+      const FileExtension extension{ file.fileName.AfterLast(wxT('.')) };
+      switch (JudgeImport(job.result, extension, file.tracks)) {
+      case ImportOutcome::Succeeded:
+         file.success = true;
+         break;
+      case ImportOutcome::Failed:
+         break;
+      default:
+         // Another plugin may understand the file, unless the user stopped
+         if (control == ProgressResult::Success) {
+            file.imported = false;
+            file.tracks.clear();
+            file.labelTracks.clear();
+         }
+         break;
+      }
+   }
+}
+
 //-------------------------------------------------------------------------
 // ImportStreamDialog
 //-------------------------------------------------------------------------
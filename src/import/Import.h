@@ -13,6 +13,7 @@
 
 #include "ImportForwards.h"
 #include "Identifier.h"
+#include <exception>
 #include <vector>
 #include <wx/tokenzr.h> // for enum wxStringTokenizerMode
 
@@ -180,7 +181,36 @@ public:
               LabelHolders &labelTracks,
               TranslatableString &errorMessage);
 
+   //! One file given to ImportConcurrently(), and what became of it
+   struct ConcurrentImport {
+      FilePath fileName;
+      //! Receives the tags of the file
+      std::shared_ptr<Tags> tags;
+      TrackHolders tracks;
+      LabelHolders labelTracks;
+      //! If false, the file was left for Import()
+      bool imported{ false };
+      //! Whether the import succeeded; meaningful if imported
+      bool success{ false };
+      //! What the importer threw, for the caller to rethrow in turn
+      std::exception_ptr error;
+   };
+
+   /*!
+    Opens each file in turn, as Import() would, letting the user choose
+    streams, then decodes together in the task scheduler the files whose
+    importers allow it, under one progress dialog.  Cancelling the dialog
+    cancels all of them; stopping it keeps what each has read.  Files that
+    need the main thread, as for lists of files, projects and importers that
+    show dialogs, are left for Import().
+    */
+   void ImportConcurrently(TenacityProject &project,
+      WaveTrackFactory *trackFactory, std::vector<ConcurrentImport> &files);
+
 private:
+   //! The import plugins to try for the file, in order
+   std::vector<ImportPlugin *> GetPluginsFor(const FilePath &fName);
+
    static Importer mInstance;
 
    ExtImportItems mExtImportItems;
@@ -259,6 +259,8 @@ public:
          mStreamContexts[StreamID].Use = Use;
    }
 
+   bool SupportsConcurrentImport() const override { return true; }
+
 private:
    // Construct this member first, so it is destroyed last, so the functions
    // remain loaded while other members are destroyed
@@ -159,6 +159,8 @@ public:
    void SetStreamUsage(wxInt32 WXUNUSED(StreamID), bool WXUNUSED(Use)) override
    {}
 
+   bool SupportsConcurrentImport() const override { return true; }
+
 private:
    sampleFormat          mFormat;
    std::unique_ptr<MyFLACFile> mFile;
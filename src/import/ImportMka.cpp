@@ -151,6 +151,8 @@ public:
 
    void SetStreamUsage(wxInt32 WXUNUSED(StreamID), bool WXUNUSED(Use)) override;
 
+   bool SupportsConcurrentImport() const override { return true; }
+
 private:
     std::unique_ptr<StdIOCallback> mkfile;
     std::unique_ptr<EbmlStream>  stream;
@@ -149,6 +149,8 @@ public:
       }
    }
 
+   bool SupportsConcurrentImport() const override { return true; }
+
 private:
    std::unique_ptr<wxFFile> mFile;
    std::unique_ptr<OggVorbis_File> mVorbisFile;
@@ -46,9 +46,13 @@
 
 // Tenacity libraries
 #include <lib-preferences/Prefs.h>
+#include <lib-utility/MemoryX.h>
+#include <lib-utility/TaskScheduler.h>
 
 #include "../FileFormats.h"
 #include "../shuttle/ShuttleGui.h"
+#include "../SampleBlock.h"
+#include "../WaveClip.h"
 #include "../WaveTrack.h"
 #include "ImportPlugin.h"
 
@@ -107,10 +111,23 @@ public:
    void SetStreamUsage(wxInt32 WXUNUSED(StreamID), bool WXUNUSED(Use)) override
    {}
 
+   bool SupportsConcurrentImport() const override { return true; }
+
 private:
+   using NewChannelGroup = std::vector< std::shared_ptr<WaveTrack> >;
+
+   //! Decode in order, and summarize the decoded stretches in the task
+   //! scheduler
+   ProgressResult ImportPipelined(const SampleBlockFactoryPtr &pFactory,
+      const NewChannelGroup &channels, size_t maxBlock, unsigned nThreads);
+
    SFFile                mFile;
    const SF_INFO         mInfo;
    sampleFormat          mFormat;
+   //! From preferences, read when opened
+   const unsigned        mThreads;
+   //! Read when opened, as import may run outside the main thread
+   const DitherType      mDither;
 };
 
 TranslatableString PCMImportPlugin::GetPluginFormatDescription()
@@ -187,11 +204,29 @@ static Importer::RegisteredImportPlugin registered{ "PCM",
    std::make_unique< PCMImportPlugin >()
 };
 
+namespace {
+
+//! Stretches of a file to summarize at once; 0 means as many as the task
+//! scheduler has threads, and 1 imports on the calling thread only
+IntSetting ImportThreads{ L"/Performance/ImportThreads", 0 };
+
+unsigned ImportThreadCount()
+{
+   const auto threads = ImportThreads.Read();
+   if (threads > 0)
+      return threads;
+   return TaskScheduler::Get().GetThreadCount() + 1;
+}
+
+}
+
 PCMImportFileHandle::PCMImportFileHandle(const FilePath &name,
                                          SFFile &&file, SF_INFO info)
 :  ImportFileHandle(name),
    mFile(std::move(file)),
-   mInfo(info)
+   mInfo(info),
+   mThreads(ImportThreadCount()),
+   mDither(gHighQualityDither)
 {
    wxASSERT(info.channels >= 0);
 
@@ -285,7 +320,135 @@ struct id3_tag_deleter {
 using id3_tag_holder = std::unique_ptr<id3_tag, id3_tag_deleter>;
 #endif
 
-using NewChannelGroup = std::vector< std::shared_ptr<WaveTrack> >;
+namespace {
+
+//! How many decoded stretches of the file to store in one transaction
+constexpr size_t ImportBatchChunks = 8;
+
+//! One prepared block per channel, for one stretch of the file
+struct PreparedChunk {
+   size_t len;
+   std::vector<SampleBlockFactory::PreparedBlockPtr> blocks;
+};
+
+}
+
+/*!
+ The calling thread reads the file and converts the samples to the track
+ format, which must happen in order because dithering has state.  Each time
+ it has decoded nThreads stretches of all channels, a TaskGroup prepares
+ their blocks, computing the summaries, with the calling thread helping.
+ The prepared blocks are stored in batches, so that the database sees one
+ transaction for many blocks.
+ */
+ProgressResult PCMImportFileHandle::ImportPipelined(
+   const SampleBlockFactoryPtr &pFactory,
+   const NewChannelGroup &channels, size_t maxBlock, unsigned nThreads)
+{
+   const auto nChannels = channels.size();
+   const auto trackFormat = mFormat;
+   const auto size = SAMPLE_SIZE(trackFormat);
+   //import 24 bit int as float and have the conversion make it int again
+   const auto readFormat =
+      (mFormat == int16Sample) ? int16Sample : floatSample;
+   const auto fileTotalFrames = (sampleCount)mInfo.frames;
+
+   SampleBuffer srcbuffer{ maxBlock * nChannels, readFormat };
+   if (!srcbuffer.ptr())
+      throw std::bad_alloc{};
+   // Decoded stretches, one channel after another in each, reused
+   std::vector<SampleBuffer> buffers(nThreads);
+   for (auto &buffer : buffers)
+      if (!buffer.Allocate(maxBlock * nChannels, trackFormat).ptr())
+         throw std::bad_alloc{};
+   std::vector<PreparedChunk> chunks(nThreads);
+
+   // Decode the next stretch into buffers[ii]; return its length
+   const auto decode = [&](size_t ii) -> size_t {
+      sf_count_t block;
+      if (readFormat == int16Sample)
+         block = SFCall<sf_count_t>(sf_readf_short, mFile.get(),
+            (short *)srcbuffer.ptr(), maxBlock);
+      else
+         block = SFCall<sf_count_t>(sf_readf_float, mFile.get(),
+            (float *)srcbuffer.ptr(), maxBlock);
+      if (block <= 0 || block > (sf_count_t)maxBlock)
+         return 0;
+
+      const size_t len = block;
+      for (size_t c = 0; c < nChannels; ++c)
+         CopySamples(srcbuffer.ptr() + c * SAMPLE_SIZE(readFormat),
+            readFormat, buffers[ii].ptr() + c * len * size, trackFormat, len,
+            mDither, nChannels, 1);
+      return len;
+   };
+
+   // Blocks of the batch, all channels of each chunk together
+   std::vector<SampleBlockFactory::PreparedBlockPtr> batch;
+   size_t batchChunks = 0;
+   auto store = [&]{
+      if (batch.empty())
+         return;
+      auto blocks = pFactory->CreatePrepared(std::move(batch));
+      batch.clear();
+      batchChunks = 0;
+      for (size_t c = 0; c < nChannels; ++c) {
+         auto clip = channels[c]->RightmostOrNewClip();
+         for (size_t ii = c; ii < blocks.size(); ii += nChannels)
+            clip->AppendSharedBlock(blocks[ii]);
+         clip->UpdateEnvelopeTrackLen();
+         clip->MarkChanged();
+      }
+   };
+
+   sampleCount framescompleted = 0;
+   auto updateResult = ProgressResult::Success;
+   TaskGroup tasks;
+   while (true) {
+      size_t nChunks = 0;
+      for (; nChunks < nThreads; ++nChunks) {
+         const auto len = decode(nChunks);
+         if (len == 0)
+            break;
+         chunks[nChunks].len = len;
+      }
+      if (nChunks == 0)
+         break;
+
+      tasks.ParallelFor(nChunks, [&](size_t ii){
+         auto &chunk = chunks[ii];
+         chunk.blocks.clear();
+         for (size_t c = 0; c < nChannels; ++c)
+            chunk.blocks.push_back(pFactory->Prepare(
+               buffers[ii].ptr() + c * chunk.len * size,
+               chunk.len, trackFormat));
+      });
+
+      for (size_t ii = 0; ii < nChunks; ++ii) {
+         auto &chunk = chunks[ii];
+         framescompleted += chunk.len;
+         for (auto &pBlock : chunk.blocks)
+            batch.push_back(std::move(pBlock));
+         if (++batchChunks >= ImportBatchChunks)
+            store();
+      }
+
+      updateResult = mProgress->Update(
+         framescompleted.as_long_long(),
+         fileTotalFrames.as_long_long()
+      );
+      if (updateResult == ProgressResult::Stopped)
+         // Keep what was decoded, as the serial import does
+         break;
+      if (updateResult != ProgressResult::Success)
+         return updateResult;
+      if (nChunks < nThreads)
+         break;
+   }
+   store();
+
+   return updateResult;
+}
 
 ProgressResult PCMImportFileHandle::Import(WaveTrackFactory *trackFactory,
                                 TrackHolders &outTracks,
@@ -328,60 +491,66 @@ ProgressResult PCMImportFileHandle::Import(WaveTrackFactory *trackFactory,
       if (maxBlock < 1)
          return ProgressResult::Failed;
 
-      SampleBuffer srcbuffer, buffer;
-      wxASSERT(mInfo.channels >= 0);
-      while (NULL == srcbuffer.Allocate(maxBlock * mInfo.channels, mFormat).ptr() ||
-             NULL == buffer.Allocate(maxBlock, mFormat).ptr())
-      {
-         maxBlock /= 2;
-         if (maxBlock < 1)
-            return ProgressResult::Failed;
-      }
+      const auto nThreads = mThreads;
+      if (nThreads > 1)
+         updateResult = ImportPipelined(
+            trackFactory->GetSampleBlockFactory(), channels, maxBlock, nThreads);
+      else {
+         SampleBuffer srcbuffer, buffer;
+         wxASSERT(mInfo.channels >= 0);
+         while (NULL == srcbuffer.Allocate(maxBlock * mInfo.channels, mFormat).ptr() ||
+                NULL == buffer.Allocate(maxBlock, mFormat).ptr())
+         {
+            maxBlock /= 2;
+            if (maxBlock < 1)
+               return ProgressResult::Failed;
+         }
 
-      decltype(fileTotalFrames) framescompleted = 0;
+         decltype(fileTotalFrames) framescompleted = 0;
 
-      long block;
-      do {
-         block = maxBlock;
+         long block;
+         do {
+            block = maxBlock;
 
-         if (mFormat == int16Sample)
-            block = SFCall<sf_count_t>(sf_readf_short, mFile.get(), (short *)srcbuffer.ptr(), block);
-         //import 24 bit int as float and have the append function convert it.  This is how PCMAliasBlockFile worked too.
-         else
-            block = SFCall<sf_count_t>(sf_readf_float, mFile.get(), (float *)srcbuffer.ptr(), block);
+            if (mFormat == int16Sample)
+               block = SFCall<sf_count_t>(sf_readf_short, mFile.get(), (short *)srcbuffer.ptr(), block);
+            //import 24 bit int as float and have the append function convert it.  This is how PCMAliasBlockFile worked too.
+            else
+               block = SFCall<sf_count_t>(sf_readf_float, mFile.get(), (float *)srcbuffer.ptr(), block);
 
-         if(block < 0 || block > (long)maxBlock) {
-            wxASSERT(false);
-            block = maxBlock;
-         }
+            if(block < 0 || block > (long)maxBlock) {
+               wxASSERT(false);
+               block = maxBlock;
+            }
 
-         if (block) {
-            auto iter = channels.begin();
-            for(int c=0; c<mInfo.channels; ++iter, ++c) {
-               if (mFormat==int16Sample) {
-                  for(int j=0; j<block; j++)
-                     ((short *)buffer.ptr())[j] =
-                        ((short *)srcbuffer.ptr())[mInfo.channels*j+c];
-               }
-               else {
-                  for(int j=0; j<block; j++)
-                     ((float *)buffer.ptr())[j] =
-                        ((float *)srcbuffer.ptr())[mInfo.channels*j+c];
-               }
+            if (block) {
+               auto iter = channels.begin();
+               for(int c=0; c<mInfo.channels; ++iter, ++c) {
+                  if (mFormat==int16Sample) {
+                     for(int j=0; j<block; j++)
+                        ((short *)buffer.ptr())[j] =
+                           ((short *)srcbuffer.ptr())[mInfo.channels*j+c];
+                  }
+                  else {
+                     for(int j=0; j<block; j++)
+                        ((float *)buffer.ptr())[j] =
+                           ((float *)srcbuffer.ptr())[mInfo.channels*j+c];
+                  }
 
-               iter->get()->Append(buffer.ptr(), (mFormat == int16Sample)?int16Sample:floatSample, block);
+                  iter->get()->Append(buffer.ptr(), (mFormat == int16Sample)?int16Sample:floatSample, block);
+               }
+               framescompleted += block;
             }
-            framescompleted += block;
-         }
 
-         updateResult = mProgress->Update(
-            framescompleted.as_long_long(),
-            fileTotalFrames.as_long_long()
-         );
-         if (updateResult != ProgressResult::Success)
-            break;
+            updateResult = mProgress->Update(
+               framescompleted.as_long_long(),
+               fileTotalFrames.as_long_long()
+            );
+            if (updateResult != ProgressResult::Success)
+               break;
 
-      } while (block > 0);
+         } while (block > 0);
+      }
    }
 
    if (updateResult == ProgressResult::Failed || updateResult == ProgressResult::Cancelled) {
@@ -33,8 +33,32 @@ bool ImportPlugin::SupportsExtension(const FileExtension &extension)
    return mExtensions.Index(extension, false) != wxNOT_FOUND;
 }
 
+ImportProgress::~ImportProgress() = default;
+
+namespace {
+//! Shows the progress of one file in its own dialog
+class DialogImportProgress final : public ImportProgress
+{
+public:
+   DialogImportProgress(
+      const TranslatableString &title, const TranslatableString &message)
+      : mDialog{ std::make_unique< ProgressDialog >( title, message ) }
+   {
+   }
+
+private:
+   ProgressResult Report(double current, double total) override
+   {
+      return mDialog->Update(current, total);
+   }
+
+   std::unique_ptr<ProgressDialog> mDialog;
+};
+}
+
 ImportFileHandle::ImportFileHandle(const FilePath & filename)
 :  mFilename(filename)
+,  mDefaultFormat(QualitySettings::SampleFormatChoice())
 {
 }
 
@@ -44,18 +68,35 @@ ImportFileHandle::~ImportFileHandle()
 
 void ImportFileHandle::CreateProgress()
 {
+   if (mProgress)
+      return;
+
    wxFileName ff( mFilename );
 
    auto title = XO("Importing %s").Format( GetFileDescription() );
-   mProgress = std::make_unique< ProgressDialog >(
+   mProgress = std::make_unique< DialogImportProgress >(
       title, Verbatim( ff.GetFullName() ) );
 }
 
+void ImportFileHandle::SetProgress(std::unique_ptr<ImportProgress> pProgress)
+{
+   mProgress = std::move(pProgress);
+}
+
+bool ImportFileHandle::SupportsConcurrentImport() const
+{
+   return false;
+}
+
 sampleFormat ImportFileHandle::ChooseFormat(sampleFormat effectiveFormat)
 {
    // Consult user preference
-   auto defaultFormat = QualitySettings::SampleFormatChoice();
+   return ChooseFormat(effectiveFormat, QualitySettings::SampleFormatChoice());
+}
 
+sampleFormat ImportFileHandle::ChooseFormat(
+   sampleFormat effectiveFormat, sampleFormat defaultFormat)
+{
    // Don't choose format narrower than effective or default
    auto format = std::max(effectiveFormat, defaultFormat);
 
@@ -69,5 +110,6 @@ sampleFormat ImportFileHandle::ChooseFormat(sampleFormat effectiveFormat)
 std::shared_ptr<WaveTrack> ImportFileHandle::NewWaveTrack(
    WaveTrackFactory &trackFactory, sampleFormat effectiveFormat, double rate)
 {
-   return trackFactory.NewWaveTrack(ChooseFormat(effectiveFormat), rate);
+   return trackFactory.NewWaveTrack(
+      ChooseFormat(effectiveFormat, mDefaultFormat), rate);
 }
@@ -54,7 +54,6 @@ but little else.
 #include <lib-strings/wxArrayStringEx.h>
 
 class TenacityProject;
-class ProgressDialog;
 namespace GenericUI{ enum class ProgressResult : unsigned; }
 class WaveTrackFactory;
 class Track;
@@ -106,6 +105,26 @@ protected:
 class WaveTrack;
 using TrackHolders = std::vector< std::vector< std::shared_ptr<WaveTrack> > >;
 
+//! Where an importer reports how far it has read, and learns whether to go on
+/*! A progress dialog for the file, or a share of the progress of many files
+ imported together */
+class TENACITY_DLL_API ImportProgress /* not final */
+{
+public:
+   using ProgressResult = GenericUI::ProgressResult;
+
+   virtual ~ImportProgress();
+
+   template<typename Current, typename Total>
+   ProgressResult Update(Current current, Total total)
+   {
+      return Report(static_cast<double>(current), static_cast<double>(total));
+   }
+
+protected:
+   virtual ProgressResult Report(double current, double total) = 0;
+};
+
 class TENACITY_DLL_API ImportFileHandle /* not final */
 {
 public:
@@ -117,8 +136,19 @@ public:
 
    // The importer should call this to create the progress dialog and
    // identify the filename being imported.
+   // It keeps the progress given to SetProgress() instead, if any.
    void CreateProgress();
 
+   //! Report to the given progress, instead of to a dialog of this file
+   void SetProgress(std::unique_ptr<ImportProgress> pProgress);
+
+   //! Whether Import() may be called in a worker thread
+   /*! Open() and the choice of streams still happen in the main thread.
+    Such an Import() must show no dialogs and read no preferences; the
+    tracks of NewWaveTrack() have the format preferred when the file was
+    opened. */
+   virtual bool SupportsConcurrentImport() const;
+
    // This is similar to GetPluginFormatDescription, but if possible the
    // importer will return a more specific description of the
    // specific file that is open.
@@ -159,7 +189,14 @@ protected:
       sampleFormat effectiveFormat, double rate);
 
    FilePath mFilename;
-   std::unique_ptr<ProgressDialog> mProgress;
+   std::unique_ptr<ImportProgress> mProgress;
+
+private:
+   static sampleFormat ChooseFormat(
+      sampleFormat effectiveFormat, sampleFormat defaultFormat);
+
+   //! The preferred sample format, when the file was opened
+   const sampleFormat mDefaultFormat;
 };
 
 
@@ -169,10 +169,10 @@ void DoImport(const CommandContext &context, bool isRaw)
                .AddImportedTracks(fileName, std::move(newTracks), {});
          }
       }
-      else {
-         ProjectFileManager::Get( project ).Import(fileName);
-      }
    }
+
+   if (!isRaw)
+      ProjectFileManager::Get( project ).ImportMany(selectedFiles);
 }
 
 }